@@ -0,0 +1,166 @@
+#include "AnalysisProfiler.h"
+
+#include "llvm/IR/Function.h"
+
+#include <vector>
+
+namespace input_dependency {
+
+namespace {
+
+struct TimerFrame
+{
+    AnalysisProfiler::Phase phase;
+    const llvm::Function* function;
+    AnalysisProfiler::Clock::time_point start;
+    uint64_t childrenNs;
+    // inclusive time of a phase nested into the same phase of the same function is already measured by outer timer
+    bool recursive;
+    uint64_t counters[AnalysisProfiler::COUNTERS_COUNT];
+};
+
+// timers of a thread, innermost last
+thread_local std::vector<TimerFrame> timer_frames;
+
+}
+
+void AnalysisProfiler::ProfileData::merge(const ProfileData& data)
+{
+    for (unsigned i = 0; i < PHASES_COUNT; ++i) {
+        phases[i].inclusiveNs += data.phases[i].inclusiveNs;
+        phases[i].selfNs += data.phases[i].selfNs;
+        phases[i].calls += data.phases[i].calls;
+    }
+    for (unsigned i = 0; i < COUNTERS_COUNT; ++i) {
+        counters[i] += data.counters[i];
+    }
+}
+
+AnalysisProfiler::ScopedTimer::ScopedTimer(Phase phase, const llvm::Function* F)
+    : m_active(AnalysisProfiler::get().isEnabled())
+{
+    if (!m_active) {
+        return;
+    }
+    bool recursive = false;
+    for (const auto& frame : timer_frames) {
+        if (frame.phase == phase && frame.function == F) {
+            recursive = true;
+            break;
+        }
+    }
+    timer_frames.push_back(TimerFrame{phase, F, Clock::now(), 0, recursive, {}});
+}
+
+AnalysisProfiler::ScopedTimer::~ScopedTimer()
+{
+    if (!m_active) {
+        return;
+    }
+    const TimerFrame frame = timer_frames.back();
+    timer_frames.pop_back();
+    uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - frame.start).count();
+    if (!timer_frames.empty()) {
+        timer_frames.back().childrenNs += elapsed;
+    }
+    ProfileData data;
+    auto& phase_data = data.phases[frame.phase];
+    phase_data.inclusiveNs = frame.recursive ? 0 : elapsed;
+    phase_data.selfNs = elapsed > frame.childrenNs ? elapsed - frame.childrenNs : 0;
+    phase_data.calls = 1;
+    for (unsigned i = 0; i < COUNTERS_COUNT; ++i) {
+        data.counters[i] = frame.counters[i];
+    }
+    AnalysisProfiler::get().record(frame.function, data);
+}
+
+void AnalysisProfiler::count(Counter counter, uint64_t value)
+{
+    if (!m_enabled) {
+        return;
+    }
+    if (!timer_frames.empty()) {
+        // flushed with the timer, to avoid locking on every count
+        timer_frames.back().counters[counter] += value;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_unattributed.counters[counter] += value;
+}
+
+AnalysisProfiler::FunctionProfiles AnalysisProfiler::getFunctionProfiles() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_profiles;
+}
+
+AnalysisProfiler::ProfileData AnalysisProfiler::getModuleProfile() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ProfileData module_data = m_unattributed;
+    for (const auto& item : m_profiles) {
+        module_data.merge(item.second.data);
+    }
+    return module_data;
+}
+
+void AnalysisProfiler::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_profiles.clear();
+    m_unattributed = ProfileData();
+}
+
+const char* AnalysisProfiler::getPhaseName(Phase phase)
+{
+    switch (phase) {
+    case ANALYSIS:
+        return "analysis";
+    case PREDECESSOR_MERGE:
+        return "predecessor_merge";
+    case ALIAS_UPDATE:
+        return "alias_update";
+    case REFLECTION:
+        return "reflection";
+    case LOOP_FIXPOINT:
+        return "loop_fixpoint";
+    case FINALIZATION:
+        return "finalization";
+    default:
+        break;
+    }
+    return "unknown";
+}
+
+const char* AnalysisProfiler::getCounterName(Counter counter)
+{
+    switch (counter) {
+    case AA_QUERIES:
+        return "aa_queries";
+    case MAP_COPIES:
+        return "map_copies";
+    case MERGES:
+        return "merges";
+    default:
+        break;
+    }
+    return "unknown";
+}
+
+void AnalysisProfiler::record(const llvm::Function* F, const ProfileData& data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!F) {
+        m_unattributed.merge(data);
+        return;
+    }
+    auto pos = m_profiles.find(F);
+    if (pos == m_profiles.end()) {
+        // name is taken now, as function may be erased before profiles are reported
+        pos = m_profiles.insert(std::make_pair(F, FunctionProfile{F->getName().str(), ProfileData()})).first;
+    }
+    pos->second.data.merge(data);
+}
+
+} // namespace input_dependency
+
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace llvm {
+class Function;
+}
+
+namespace input_dependency {
+
+/**
+ * \class AnalysisProfiler
+ * \brief Collects time spent in analysis phases and counts of expensive operations, per function.
+ * Phases are measured with nested scoped timers. Each phase gets its inclusive time and its self time,
+ * which excludes time of phases nested into it. Counters are attributed to the function of the innermost timer.
+ * When profiling is disabled timers and counters do nothing.
+ */
+class AnalysisProfiler
+{
+public:
+    enum Phase {
+        ANALYSIS,
+        PREDECESSOR_MERGE,
+        ALIAS_UPDATE,
+        REFLECTION,
+        LOOP_FIXPOINT,
+        FINALIZATION,
+        PHASES_COUNT
+    };
+
+    enum Counter {
+        AA_QUERIES,
+        MAP_COPIES,
+        MERGES,
+        COUNTERS_COUNT
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    struct PhaseData
+    {
+        uint64_t inclusiveNs = 0;
+        uint64_t selfNs = 0;
+        uint64_t calls = 0;
+    };
+
+    struct ProfileData
+    {
+        PhaseData phases[PHASES_COUNT];
+        uint64_t counters[COUNTERS_COUNT] = {};
+
+        void merge(const ProfileData& data);
+    };
+
+    struct FunctionProfile
+    {
+        std::string name;
+        ProfileData data;
+    };
+
+    using FunctionProfiles = std::unordered_map<const llvm::Function*, FunctionProfile>;
+
+    /// Measures the phase for its lifetime.
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(Phase phase, const llvm::Function* F);
+        ~ScopedTimer();
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator =(const ScopedTimer&) = delete;
+
+    private:
+        bool m_active;
+    };
+
+public:
+    static AnalysisProfiler& get()
+    {
+        static AnalysisProfiler profiler;
+        return profiler;
+    }
+
+public:
+    void setEnabled(bool enabled)
+    {
+        m_enabled = enabled;
+    }
+
+    bool isEnabled() const
+    {
+        return m_enabled;
+    }
+
+    void count(Counter counter, uint64_t value = 1);
+
+    /// Profiles of all functions measured so far.
+    FunctionProfiles getFunctionProfiles() const;
+    /// Totals over all functions. Phase times nested into another phase of the same function are not added twice.
+    ProfileData getModuleProfile() const;
+    void clear();
+
+    static const char* getPhaseName(Phase phase);
+    static const char* getCounterName(Counter counter);
+
+private:
+    AnalysisProfiler() = default;
+
+    void record(const llvm::Function* F, const ProfileData& data);
+
+private:
+    bool m_enabled = false;
+    mutable std::mutex m_mutex;
+    FunctionProfiles m_profiles;
+    // counters counted outside of any timer
+    ProfileData m_unattributed;
+};
+
+} // namespace input_dependency
+
@@ -1,5 +1,7 @@
 #include "BasicBlockAnalysisResult.h"
 
+#include "AnalysisProfiler.h"
+#include "MemoryUsage.h"
 #include "Utils.h"
 #include "FunctionAnaliser.h"
 #include "InputDepConfig.h"
@@ -203,6 +205,7 @@ void BasicBlockAnalysisResult::updateReturnValueDependencies(const ValueDepInfo&
 
 ValueDepInfo BasicBlockAnalysisResult::getRefInfo(llvm::Instruction* instr)
 {
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::ALIAS_UPDATE, m_F);
     ValueDepInfo info;
     //llvm::dbgs() << *instr << "\n";
     const auto& DL = instr->getModule()->getDataLayout();
@@ -210,6 +213,7 @@ ValueDepInfo BasicBlockAnalysisResult::getRefInfo(llvm::Instruction* instr)
         if (!dep.first->getType()->isSized()) {
             continue;
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto modRef = m_AAR.getModRefInfo(instr, dep.first, DL.getTypeStoreSize(dep.first->getType()));
         if (modRef == llvm::ModRefInfo::MRI_Ref) {
             info.mergeDependencies(dep.second);
@@ -220,12 +224,14 @@ ValueDepInfo BasicBlockAnalysisResult::getRefInfo(llvm::Instruction* instr)
 
 void BasicBlockAnalysisResult::updateAliasesDependencies(llvm::Value* val, const ValueDepInfo& info)
 {
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::ALIAS_UPDATE, m_F);
     //llvm::dbgs() << "updateAliasesDependencies1 " << *val << "\n";
     llvm::Instruction* value_instr = llvm::dyn_cast<llvm::Instruction>(val);
     for (auto& valDep : m_valueDependencies) {
         if (valDep.first == val) {
             continue;
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto alias = m_AAR.alias(val, valDep.first);
         // what about partial alias
         if (alias == llvm::AliasResult::MayAlias) {
@@ -245,6 +251,7 @@ void BasicBlockAnalysisResult::updateAliasesDependencies(llvm::Value* val, const
         if (valDep.first == val) {
             continue;
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto alias = m_AAR.alias(val, valDep.first);
         if (alias == llvm::AliasResult::MayAlias) {
             //llvm::dbgs() << "May aliases " << *valDep.first << "\n";
@@ -260,11 +267,13 @@ void BasicBlockAnalysisResult::updateAliasesDependencies(llvm::Value* val, const
 
 void BasicBlockAnalysisResult::updateAliasesDependencies(llvm::Value* val, llvm::Instruction* elInstr, const ValueDepInfo& info)
 {
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::ALIAS_UPDATE, m_F);
     //llvm::dbgs() << "updateAliasesDependencies2 " << *val << "  " << *elInstr << "\n";
     for (auto& valDep : m_valueDependencies) {
         if (valDep.first == val) {
             continue;
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto alias = m_AAR.alias(val, valDep.first);
         if (alias == llvm::AliasResult::MayAlias || alias == llvm::AliasResult::PartialAlias) {
             //llvm::dbgs() << "May aliases " << *valDep.first << "\n";
@@ -281,6 +290,7 @@ void BasicBlockAnalysisResult::updateAliasesDependencies(llvm::Value* val, llvm:
         if (valDep.first == val) {
             continue;
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto alias = m_AAR.alias(val, valDep.first);
         if (alias == llvm::AliasResult::MayAlias || alias == llvm::AliasResult::PartialAlias) {
             valDep.second.mergeDependencies(elInstr, info);
@@ -292,8 +302,10 @@ void BasicBlockAnalysisResult::updateAliasesDependencies(llvm::Value* val, llvm:
 
 void BasicBlockAnalysisResult::updateAliasingOutArgDependencies(llvm::Value* value, const ValueDepInfo& info)
 {
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::ALIAS_UPDATE, m_F);
     llvm::Instruction* value_instr = llvm::dyn_cast<llvm::Instruction>(value);
     for (auto& arg : m_outArgDependencies) {
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto alias = m_AAR.alias(value, arg.first);
         if (alias != llvm::AliasResult::NoAlias) {
             if (alias == llvm::AliasResult::MayAlias || alias == llvm::AliasResult::PartialAlias) {
@@ -309,11 +321,13 @@ void BasicBlockAnalysisResult::updateAliasingOutArgDependencies(llvm::Value* val
 
 void BasicBlockAnalysisResult::updateModAliasesDependencies(llvm::StoreInst* storeInst, const ValueDepInfo& info)
 {
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::ALIAS_UPDATE, m_F);
     const auto& DL = storeInst->getModule()->getDataLayout();
     for (auto& dep : m_valueDependencies) {
         if (!dep.first->getType()->isSized()) {
             continue;
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto modRef = m_AAR.getModRefInfo(storeInst, dep.first, DL.getTypeStoreSize(dep.first->getType()));
         if (modRef == llvm::ModRefInfo::MRI_Mod) {
             // if modifies given value should modify other aliases too, thus no need to set update_aliases flag
@@ -327,6 +341,7 @@ void BasicBlockAnalysisResult::updateModAliasesDependencies(llvm::StoreInst* sto
         if (!dep.first->getType()->isSized()) {
             continue;
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto modRef = m_AAR.getModRefInfo(storeInst, dep.first, DL.getTypeStoreSize(dep.first->getType()));
         if (modRef == llvm::ModRefInfo::MRI_Mod) {
             updateValueDependencies(dep.first, info, false);
@@ -336,15 +351,18 @@ void BasicBlockAnalysisResult::updateModAliasesDependencies(llvm::StoreInst* sto
 
 void BasicBlockAnalysisResult::updateRefAliasesDependencies(llvm::Instruction* instr, const ValueDepInfo& info)
 {
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::ALIAS_UPDATE, m_F);
     const auto& DL = instr->getModule()->getDataLayout();
     for (auto& dep : m_valueDependencies) {
         if (!dep.first->getType()->isSized()) {
             continue;
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto modRef = m_AAR.getModRefInfo(instr, dep.first, DL.getTypeStoreSize(dep.first->getType()));
         if (modRef == llvm::ModRefInfo::MRI_Ref) {
             updateValueDependencies(dep.first, info, false);
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto alias = m_AAR.alias(instr, dep.first);
         if (alias == llvm::AliasResult::NoAlias) {
             continue;
@@ -381,6 +399,7 @@ void BasicBlockAnalysisResult::markCallbackFunctionsForValue(llvm::Value* value)
         if (valDep.first == value) {
             markFunctionsForValue(value);
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto alias = m_AAR.alias(value, valDep.first);
         // what about partial alias
         if (alias == llvm::AliasResult::MayAlias || alias == llvm::AliasResult::MustAlias) {
@@ -395,6 +414,7 @@ void BasicBlockAnalysisResult::markCallbackFunctionsForValue(llvm::Value* value)
         if (valDep.first == value) {
             markFunctionsForValue(value);
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto alias = m_AAR.alias(value, valDep.first);
         // what about partial alias
         if (alias == llvm::AliasResult::MayAlias || alias == llvm::AliasResult::MustAlias) {
@@ -415,6 +435,7 @@ void BasicBlockAnalysisResult::removeCallbackFunctionsForValue(llvm::Value* valu
             m_functionValues.erase(pos);
             continue;
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto alias = m_AAR.alias(value, valDep.first);
         // must alias only, as in case of structs a callback field "may alias" even with other fields
         if (/*alias == llvm::AliasResult::MayAlias || */alias == llvm::AliasResult::MustAlias) {
@@ -434,6 +455,7 @@ void BasicBlockAnalysisResult::removeCallbackFunctionsForValue(llvm::Value* valu
             m_functionValues.erase(pos);
             continue;
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
         auto alias = m_AAR.alias(value, valDep.first);
         // what about partial alias
         if (/*alias == llvm::AliasResult::MayAlias || */alias == llvm::AliasResult::MustAlias) {
@@ -446,6 +468,7 @@ void BasicBlockAnalysisResult::removeCallbackFunctionsForValue(llvm::Value* valu
 void BasicBlockAnalysisResult::setInitialValueDependencies(
                     const ValueDependencies& valueDependencies)
 {
+    AnalysisProfiler::get().count(AnalysisProfiler::MAP_COPIES);
     m_initialDependencies = valueDependencies;
 }
 
@@ -703,6 +726,11 @@ long unsigned BasicBlockAnalysisResult::get_input_unknowns_count() const
     return count;
 }
 
+long unsigned BasicBlockAnalysisResult::get_memory_usage() const
+{
+    return sizeof(BasicBlockAnalysisResult) + getDependenciesMemoryUsage();
+}
+
 DepInfo BasicBlockAnalysisResult::getLoadInstrDependencies(llvm::LoadInst* instr)
 {
     auto* loadOp = instr->getPointerOperand();
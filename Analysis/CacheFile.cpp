@@ -0,0 +1,332 @@
+#include "CacheFile.h"
+
+#include "Utils.h"
+
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+namespace input_dependency {
+
+namespace {
+
+const uint64_t cache_file_magic = 0x4843414350454449; // "IDEPCACH"
+const unsigned header_size = 4;
+
+// positions of fields in function table entry
+enum EntryField {
+    NAME_HASH = 0,
+    HASH,
+    FLAGS,
+    COUNTS,
+    CALL_SITES_COUNT,
+    DATA_OFFSET,
+    ENTRY_SIZE
+};
+
+enum FunctionFlags {
+    INPUT_DEP = 1,
+    EXTRACTED = 2
+};
+
+unsigned get_words_count(unsigned bits_count)
+{
+    return (bits_count + 63) / 64;
+}
+
+uint64_t get_name_words_count(uint64_t length)
+{
+    return (length + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+}
+
+// writes bits padded to words_count words
+void append_bits(const FunctionCacheData::Bits& bits, unsigned words_count, std::vector<uint64_t>& words)
+{
+    for (unsigned i = 0; i < words_count; ++i) {
+        words.push_back(i < bits.size() ? bits[i] : 0);
+    }
+}
+
+// writes length of the name, followed by its characters padded to words
+void append_name(const std::string& name, std::vector<uint64_t>& words)
+{
+    words.push_back(name.size());
+    const unsigned start = words.size();
+    words.resize(start + get_name_words_count(name.size()), 0);
+    std::copy(name.begin(), name.end(), reinterpret_cast<char*>(words.data() + start));
+}
+
+}
+
+CacheFile::FunctionView::FunctionView()
+    : m_entry(nullptr)
+    , m_inputDepBlocks(nullptr)
+    , m_unreachableBlocks(nullptr)
+    , m_inputDepInstrs(nullptr)
+    , m_inputIndepInstrs(nullptr)
+    , m_callSites(nullptr)
+{
+}
+
+CacheFile::FunctionView::FunctionView(const uint64_t* entry, const uint64_t* data)
+    : m_entry(entry)
+{
+    const unsigned blocks_words = get_words_count(getBlocksCount());
+    const unsigned instrs_words = get_words_count(getInstructionsCount());
+    m_inputDepBlocks = data;
+    m_unreachableBlocks = m_inputDepBlocks + blocks_words;
+    m_inputDepInstrs = m_unreachableBlocks + blocks_words;
+    m_inputIndepInstrs = m_inputDepInstrs + instrs_words;
+    m_callSites = m_inputIndepInstrs + instrs_words;
+}
+
+uint64_t CacheFile::FunctionView::getHash() const
+{
+    return m_entry[HASH];
+}
+
+bool CacheFile::FunctionView::isInputDep() const
+{
+    return m_entry[FLAGS] & INPUT_DEP;
+}
+
+bool CacheFile::FunctionView::isExtracted() const
+{
+    return m_entry[FLAGS] & EXTRACTED;
+}
+
+unsigned CacheFile::FunctionView::getInstructionsCount() const
+{
+    return m_entry[COUNTS] >> 32;
+}
+
+unsigned CacheFile::FunctionView::getBlocksCount() const
+{
+    return m_entry[COUNTS] & 0xffffffff;
+}
+
+bool CacheFile::FunctionView::isInputDepBlock(unsigned index) const
+{
+    return index < getBlocksCount() && testBit(m_inputDepBlocks, index);
+}
+
+bool CacheFile::FunctionView::isUnreachableBlock(unsigned index) const
+{
+    return index < getBlocksCount() && testBit(m_unreachableBlocks, index);
+}
+
+bool CacheFile::FunctionView::isInputDepInstr(unsigned index) const
+{
+    return index < getInstructionsCount() && testBit(m_inputDepInstrs, index);
+}
+
+bool CacheFile::FunctionView::isInputIndepInstr(unsigned index) const
+{
+    return index < getInstructionsCount() && testBit(m_inputIndepInstrs, index);
+}
+
+std::vector<FunctionCacheData::CallSiteData> CacheFile::FunctionView::getCallSites() const
+{
+    std::vector<FunctionCacheData::CallSiteData> callSites(m_entry[CALL_SITES_COUNT]);
+    const uint64_t* words = m_callSites;
+    for (auto& callSite : callSites) {
+        callSite.instrIndex = words[0] >> 32;
+        callSite.argsCount = words[0] & 0xffffffff;
+        const unsigned args_words = get_words_count(callSite.argsCount);
+        callSite.inputDepArgs.assign(words + 1, words + 1 + args_words);
+        words += 1 + args_words;
+        const unsigned input_dep_globals = words[0] >> 32;
+        const unsigned input_indep_globals = words[0] & 0xffffffff;
+        words = readNames(words + 1, input_dep_globals, callSite.inputDepGlobals);
+        words = readNames(words, input_indep_globals, callSite.inputIndepGlobals);
+    }
+    return callSites;
+}
+
+const uint64_t* CacheFile::FunctionView::readNames(const uint64_t* words, unsigned count, std::vector<std::string>& names)
+{
+    names.reserve(count);
+    for (unsigned i = 0; i < count; ++i) {
+        const char* name = reinterpret_cast<const char*>(words + 1);
+        names.push_back(std::string(name, words[0]));
+        words += 1 + get_name_words_count(words[0]);
+    }
+    return words;
+}
+
+bool CacheFile::FunctionView::testBit(const uint64_t* words, unsigned index)
+{
+    return words[index / 64] & (uint64_t(1) << (index % 64));
+}
+
+CacheFile::CacheFile()
+    : m_words(nullptr)
+    , m_wordsCount(0)
+    , m_functionsCount(0)
+{
+}
+
+CacheFile::~CacheFile()
+{
+}
+
+bool CacheFile::write(const std::string& file_name, const FunctionsData& functions)
+{
+    std::vector<std::pair<uint64_t, const FunctionCacheData*>> sorted_functions;
+    sorted_functions.reserve(functions.size());
+    for (const auto& item : functions) {
+        sorted_functions.push_back(std::make_pair(Utils::hashString(item.first), &item.second));
+    }
+    std::sort(sorted_functions.begin(), sorted_functions.end(),
+              [] (const std::pair<uint64_t, const FunctionCacheData*>& item1,
+                  const std::pair<uint64_t, const FunctionCacheData*>& item2)
+              { return item1.first < item2.first; });
+
+    std::vector<uint64_t> table;
+    std::vector<uint64_t> data;
+    const uint64_t data_start = header_size + sorted_functions.size() * ENTRY_SIZE;
+    for (const auto& item : sorted_functions) {
+        const FunctionCacheData& function_data = *item.second;
+        table.push_back(item.first);
+        table.push_back(function_data.hash);
+        table.push_back((function_data.isInputDep ? INPUT_DEP : 0) | (function_data.isExtracted ? EXTRACTED : 0));
+        table.push_back((uint64_t(function_data.instructionsCount) << 32) | function_data.blocksCount);
+        table.push_back(function_data.callSites.size());
+        table.push_back(data_start + data.size());
+
+        const unsigned blocks_words = get_words_count(function_data.blocksCount);
+        const unsigned instrs_words = get_words_count(function_data.instructionsCount);
+        append_bits(function_data.inputDepBlocks, blocks_words, data);
+        append_bits(function_data.unreachableBlocks, blocks_words, data);
+        append_bits(function_data.inputDepInstrs, instrs_words, data);
+        append_bits(function_data.inputIndepInstrs, instrs_words, data);
+        for (const auto& callSite : function_data.callSites) {
+            data.push_back((uint64_t(callSite.instrIndex) << 32) | callSite.argsCount);
+            append_bits(callSite.inputDepArgs, get_words_count(callSite.argsCount), data);
+            data.push_back((uint64_t(callSite.inputDepGlobals.size()) << 32) | callSite.inputIndepGlobals.size());
+            for (const auto& name : callSite.inputDepGlobals) {
+                append_name(name, data);
+            }
+            for (const auto& name : callSite.inputIndepGlobals) {
+                append_name(name, data);
+            }
+        }
+    }
+
+    std::error_code EC;
+    llvm::raw_fd_ostream ostream(file_name, EC, llvm::sys::fs::F_None);
+    if (EC) {
+        llvm::dbgs() << "Could not open file " << file_name << ": " << EC.message() << "\n";
+        return false;
+    }
+    const uint64_t header[header_size] = {cache_file_magic, version, sorted_functions.size(), 0};
+    ostream.write(reinterpret_cast<const char*>(header), sizeof(header));
+    ostream.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(uint64_t));
+    ostream.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(uint64_t));
+    return true;
+}
+
+bool CacheFile::load(const std::string& file_name)
+{
+    m_buffer.reset();
+    m_words = nullptr;
+    m_wordsCount = 0;
+    m_functionsCount = 0;
+    // file is memory mapped, when its size allows
+    auto buffer = llvm::MemoryBuffer::getFile(file_name, -1, false);
+    if (!buffer) {
+        llvm::dbgs() << "No input dependency cache file " << file_name << "\n";
+        return false;
+    }
+    const char* start = (*buffer)->getBufferStart();
+    const uint64_t size = (*buffer)->getBufferSize();
+    if (size % sizeof(uint64_t) != 0 || size < header_size * sizeof(uint64_t)
+            || reinterpret_cast<uintptr_t>(start) % alignof(uint64_t) != 0) {
+        llvm::dbgs() << "Invalid input dependency cache file " << file_name << "\n";
+        return false;
+    }
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(start);
+    const uint64_t words_count = size / sizeof(uint64_t);
+    if (words[0] != cache_file_magic || words[1] != version) {
+        llvm::dbgs() << "Input dependency cache file " << file_name << " has incompatible version. Ignoring\n";
+        return false;
+    }
+    if (words[2] > (words_count - header_size) / ENTRY_SIZE) {
+        llvm::dbgs() << "Invalid input dependency cache file " << file_name << "\n";
+        return false;
+    }
+    m_buffer = std::move(*buffer);
+    m_words = words;
+    m_wordsCount = words_count;
+    m_functionsCount = words[2];
+    return true;
+}
+
+bool CacheFile::isLoaded() const
+{
+    return m_buffer != nullptr;
+}
+
+bool CacheFile::find(const std::string& name, FunctionView& view) const
+{
+    if (!isLoaded()) {
+        return false;
+    }
+    const uint64_t name_hash = Utils::hashString(name);
+    // binary search in function table
+    uint64_t begin = 0;
+    uint64_t end = m_functionsCount;
+    while (begin < end) {
+        const uint64_t middle = begin + (end - begin) / 2;
+        if (m_words[header_size + middle * ENTRY_SIZE + NAME_HASH] < name_hash) {
+            begin = middle + 1;
+        } else {
+            end = middle;
+        }
+    }
+    if (begin == m_functionsCount) {
+        return false;
+    }
+    const uint64_t* entry = m_words + header_size + begin * ENTRY_SIZE;
+    if (entry[NAME_HASH] != name_hash) {
+        return false;
+    }
+    // check that function data is within the file
+    const uint64_t blocks_words = get_words_count(entry[COUNTS] & 0xffffffff);
+    const uint64_t instrs_words = get_words_count(entry[COUNTS] >> 32);
+    uint64_t offset = entry[DATA_OFFSET];
+    bool is_valid = offset <= m_wordsCount;
+    if (is_valid) {
+        offset += 2 * blocks_words + 2 * instrs_words;
+    }
+    for (uint64_t i = 0; i < entry[CALL_SITES_COUNT] && is_valid; ++i) {
+        is_valid = offset < m_wordsCount;
+        if (is_valid) {
+            offset += 1 + get_words_count(m_words[offset] & 0xffffffff);
+            is_valid = offset < m_wordsCount;
+        }
+        if (!is_valid) {
+            break;
+        }
+        const uint64_t names_count = (m_words[offset] >> 32) + (m_words[offset] & 0xffffffff);
+        ++offset;
+        for (uint64_t j = 0; j < names_count && is_valid; ++j) {
+            is_valid = offset < m_wordsCount && m_words[offset] <= (m_wordsCount - offset) * sizeof(uint64_t);
+            if (is_valid) {
+                offset += 1 + get_name_words_count(m_words[offset]);
+            }
+        }
+    }
+    if (!is_valid || offset > m_wordsCount) {
+        llvm::dbgs() << "Invalid input dependency cache entry for function " << name << "\n";
+        return false;
+    }
+    view = FunctionView(entry, m_words + entry[DATA_OFFSET]);
+    return true;
+}
+
+} // namespace input_dependency
+
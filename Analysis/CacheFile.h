@@ -0,0 +1,92 @@
+#pragma once
+
+#include "FunctionCacheData.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class MemoryBuffer;
+}
+
+namespace input_dependency {
+
+/**
+ * \class CacheFile
+ * \brief Binary file with cached input dependency results, written next to the bitcode.
+ * The file is read in place from a memory mapped buffer, no results are decoded up front.
+ *
+ * Layout, in 64 bit words:
+ *  - header: magic, version, number of functions, reserved word;
+ *  - function table sorted by function name hash. Entry: name hash, IR hash, flags, instructions and blocks counts,
+ *    number of call sites, offset of the function data;
+ *  - function data: input dependent blocks, unreachable blocks, input dependent instructions and input independent
+ *    instructions bit vectors, followed by call sites. Call site: instruction ordinal and arguments count,
+ *    input dependent arguments bit vector, counts of input dependent and input independent globals,
+ *    followed by globals names. Name: length in bytes, followed by characters padded to words.
+ */
+class CacheFile
+{
+public:
+    /// Read only view of a function entry in the mapped file.
+    class FunctionView
+    {
+    public:
+        FunctionView();
+        FunctionView(const uint64_t* entry, const uint64_t* data);
+
+    public:
+        uint64_t getHash() const;
+        bool isInputDep() const;
+        bool isExtracted() const;
+        unsigned getInstructionsCount() const;
+        unsigned getBlocksCount() const;
+        bool isInputDepBlock(unsigned index) const;
+        bool isUnreachableBlock(unsigned index) const;
+        bool isInputDepInstr(unsigned index) const;
+        bool isInputIndepInstr(unsigned index) const;
+        std::vector<FunctionCacheData::CallSiteData> getCallSites() const;
+
+    private:
+        static bool testBit(const uint64_t* words, unsigned index);
+        static const uint64_t* readNames(const uint64_t* words, unsigned count, std::vector<std::string>& names);
+
+    private:
+        const uint64_t* m_entry;
+        const uint64_t* m_inputDepBlocks;
+        const uint64_t* m_unreachableBlocks;
+        const uint64_t* m_inputDepInstrs;
+        const uint64_t* m_inputIndepInstrs;
+        const uint64_t* m_callSites;
+    };
+
+    using FunctionsData = std::vector<std::pair<std::string, FunctionCacheData>>;
+
+    // increase whenever layout of the file changes
+    static const unsigned version = 2;
+
+public:
+    CacheFile();
+    ~CacheFile();
+
+public:
+    static bool write(const std::string& file_name, const FunctionsData& functions);
+
+    /// Returns false if file can not be read, or is written with different format version.
+    bool load(const std::string& file_name);
+    bool isLoaded() const;
+    /// Returns false if there is no valid entry for the function with the given name.
+    bool find(const std::string& name, FunctionView& view) const;
+
+private:
+    std::unique_ptr<llvm::MemoryBuffer> m_buffer;
+    const uint64_t* m_words;
+    uint64_t m_wordsCount;
+    uint64_t m_functionsCount;
+};
+
+} // namespace input_dependency
+
@@ -1,10 +1,13 @@
 #include "CachedFunctionAnalysisResult.h"
 
+#include "FunctionNumbering.h"
 #include "constants.h"
 
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -12,84 +15,160 @@ namespace input_dependency {
 
 CachedFunctionAnalysisResult::CachedFunctionAnalysisResult(llvm::Function* F)
     : m_F(F)
-    , m_is_inputDep(false)
-    , m_is_extracted(false)
+    , m_isUpToDate(true)
+    , m_inputDepCount(0)
+    , m_inputIndepCount(0)
+    , m_unknownCount(0)
+    , m_unreachableCount(0)
+    , m_inputDepBlocksCount(0)
+    , m_unreachableBlocksCount(0)
+{
+}
+
+CachedFunctionAnalysisResult::~CachedFunctionAnalysisResult()
 {
 }
 
 void CachedFunctionAnalysisResult::analyze()
 {
-    parse_function_input_dep_metadata();
-    parse_function_extracted_metadata();
-    for (auto& B : *m_F) {
-        parse_block_input_dep_metadata(B);
-        parse_block_instructions_input_dep_metadata(B);
+    decode();
+}
+
+bool CachedFunctionAnalysisResult::isUpToDate() const
+{
+    decode();
+    return m_isUpToDate;
+}
+
+void CachedFunctionAnalysisResult::decode() const
+{
+    std::call_once(m_decoded, [this] () {
+        m_numbering.reset(new FunctionNumbering(m_F));
+        if (!parse_function_cache_metadata()) {
+            // results cached per instruction carry no IR hash, and are trusted if present
+            m_isUpToDate = m_F->getMetadata(metadata_strings::input_dep_function)
+                            || m_F->getMetadata(metadata_strings::input_indep_function);
+            parse_function_input_dep_metadata();
+            parse_function_extracted_metadata();
+            unsigned block_idx = 0;
+            for (auto& B : *m_F) {
+                parse_block_input_dep_metadata(B, block_idx++);
+            }
+        }
+        count_results();
+    });
+}
+
+// Returns false if function has no compact cache metadata, thus per instruction metadata should be parsed
+bool CachedFunctionAnalysisResult::parse_function_cache_metadata() const
+{
+    const llvm::MDNode* cache_md = m_F->getMetadata(metadata_strings::input_dep_cache);
+    if (!cache_md) {
+        return false;
     }
+    if (!FunctionCacheData::fromMetadata(cache_md, m_data) || !m_data.isValidFor(m_F)) {
+        llvm::dbgs() << "Invalid or outdated cache metadata for function " << m_F->getName() << "\n";
+        llvm::dbgs() << "Mark input dependent\n";
+        mark_all_input_dependent();
+        m_isUpToDate = false;
+    }
+    return true;
 }
 
-void CachedFunctionAnalysisResult::parse_function_input_dep_metadata()
+void CachedFunctionAnalysisResult::mark_all_input_dependent() const
+{
+    m_data = FunctionCacheData();
+    for (unsigned i = 0; i < m_numbering->getBlocksCount(); ++i) {
+        FunctionCacheData::setBit(m_data.inputDepBlocks, i);
+    }
+}
+
+void CachedFunctionAnalysisResult::parse_function_input_dep_metadata() const
 {
     if (auto* input_dep_function_md = m_F->getMetadata(metadata_strings::input_dep_function)) {
-        m_is_inputDep = true;
+        m_data.isInputDep = true;
     }
     // no need to look for input indep md
 }
 
- void CachedFunctionAnalysisResult::parse_function_extracted_metadata()
- {
-   if (auto* extr_function_md = m_F->getMetadata(metadata_strings::extracted)) {
-        m_is_extracted = true;
+void CachedFunctionAnalysisResult::parse_function_extracted_metadata() const
+{
+    if (auto* extr_function_md = m_F->getMetadata(metadata_strings::extracted)) {
+        m_data.isExtracted = true;
     }
- }
+}
 
-void CachedFunctionAnalysisResult::parse_block_input_dep_metadata(llvm::BasicBlock& B)
+void CachedFunctionAnalysisResult::parse_block_input_dep_metadata(llvm::BasicBlock& B, unsigned index) const
 {
     const llvm::Instruction& first_instr = *B.begin();
     if (auto* input_dep_block = first_instr.getMetadata(metadata_strings::input_dep_block)) {
-        m_inputDepBlocks.insert(&B);
-    } else if (auto* input_indep_block = first_instr.getMetadata(metadata_strings::input_indep_block)) {
-        m_inputInDepBlocks.insert(&B);
+        FunctionCacheData::setBit(m_data.inputDepBlocks, index);
     } else if (auto* unreachable_block = first_instr.getMetadata(metadata_strings::unreachable)) {
-        m_unreachableBlocks.insert(&B);
+        FunctionCacheData::setBit(m_data.unreachableBlocks, index);
+    } else if (auto* input_indep_block = first_instr.getMetadata(metadata_strings::input_indep_block)) {
+        for (auto& I : B) {
+            parse_instruction_input_dep_metadata(I, m_numbering->getInstructionIndex(&I));
+        }
     } else {
         llvm::dbgs() << "No input dependency metadata for block "
                      << B.getName() << " in function " << B.getParent()->getName() << "\n";
         llvm::dbgs() << "Mark input dependent\n";
-        m_inputDepBlocks.insert(&B);
+        FunctionCacheData::setBit(m_data.inputDepBlocks, index);
     }
 }
 
-void CachedFunctionAnalysisResult::parse_block_instructions_input_dep_metadata(llvm::BasicBlock& B)
+void CachedFunctionAnalysisResult::parse_instruction_input_dep_metadata(llvm::Instruction& I, unsigned index) const
 {
-    if (m_inputDepBlocks.find(&B) != m_inputDepBlocks.end()) {
-        add_all_instructions_to(B, m_inputDepInstructions);
-    } else if (m_unreachableBlocks.find(&B) != m_unreachableBlocks.end()) {
-        add_all_instructions_to(B, m_unreachableInstructions);
+    if (auto* input_dep_instr = I.getMetadata(metadata_strings::input_dep_instr)) {
+        FunctionCacheData::setBit(m_data.inputDepInstrs, index);
+    } else if (auto* input_indep_instr = I.getMetadata(metadata_strings::input_indep_instr)) {
+        FunctionCacheData::setBit(m_data.inputIndepInstrs, index);
+    } else if (auto* unknown_instr = I.getMetadata(metadata_strings::unknown)) {
+        // unknown instructions have no bits set
     } else {
-        for (auto& I : B) {
-            parse_instruction_input_dep_metadata(I);
-        }
+        assert(false);
     }
 }
 
-void CachedFunctionAnalysisResult::add_all_instructions_to(llvm::BasicBlock& B, Instructions& instructions)
+void CachedFunctionAnalysisResult::count_results() const
 {
-    for (auto& I : B) {
-        instructions.insert(&I);
+    unsigned block_idx = 0;
+    unsigned instr_idx = 0;
+    for (auto& B : *m_F) {
+        if (FunctionCacheData::testBit(m_data.inputDepBlocks, block_idx)) {
+            ++m_inputDepBlocksCount;
+            m_inputDepCount += B.size();
+        } else if (FunctionCacheData::testBit(m_data.unreachableBlocks, block_idx)) {
+            ++m_unreachableBlocksCount;
+            m_unreachableCount += B.size();
+        } else {
+            for (unsigned idx = instr_idx; idx < instr_idx + B.size(); ++idx) {
+                if (FunctionCacheData::testBit(m_data.inputDepInstrs, idx)) {
+                    ++m_inputDepCount;
+                } else if (FunctionCacheData::testBit(m_data.inputIndepInstrs, idx)) {
+                    ++m_inputIndepCount;
+                } else {
+                    ++m_unknownCount;
+                }
+            }
+        }
+        instr_idx += B.size();
+        ++block_idx;
     }
 }
 
-void CachedFunctionAnalysisResult::parse_instruction_input_dep_metadata(llvm::Instruction& I)
+bool CachedFunctionAnalysisResult::isInputDepBlock(const llvm::BasicBlock* block) const
 {
-    if (auto* input_dep_instr = I.getMetadata(metadata_strings::input_dep_instr)) {
-        m_inputDepInstructions.insert(&I);
-    } else if (auto* input_indep_instr = I.getMetadata(metadata_strings::input_indep_instr)) {
-        m_inputIndepInstructions.insert(&I);
-    } else if (auto* unknown_instr = I.getMetadata(metadata_strings::unknown)) {
-        m_unknownInstructions.insert(&I);
-    } else {
-        assert(false);
-    }
+    decode();
+    int index = m_numbering->getBlockIndex(block);
+    return index != -1 && FunctionCacheData::testBit(m_data.inputDepBlocks, index);
+}
+
+bool CachedFunctionAnalysisResult::isUnreachableBlock(const llvm::BasicBlock* block) const
+{
+    decode();
+    int index = m_numbering->getBlockIndex(block);
+    return index != -1 && FunctionCacheData::testBit(m_data.unreachableBlocks, index);
 }
 
 llvm::Function* CachedFunctionAnalysisResult::getFunction()
@@ -104,94 +183,164 @@ const llvm::Function* CachedFunctionAnalysisResult::getFunction() const
 
 bool CachedFunctionAnalysisResult::isInputDepFunction() const
 {
-    return m_is_inputDep;
+    decode();
+    return m_data.isInputDep;
 }
 
 void CachedFunctionAnalysisResult::setIsInputDepFunction(bool isInputDep)
 {
-    m_is_inputDep = isInputDep;
+    decode();
+    m_data.isInputDep = isInputDep;
 }
 
 bool CachedFunctionAnalysisResult::isExtractedFunction() const
 {
-    return m_is_extracted;
+    decode();
+    return m_data.isExtracted;
 }
 
 void CachedFunctionAnalysisResult::setIsExtractedFunction(bool isExtracted)
 {
-    m_is_extracted = isExtracted;
+    decode();
+    m_data.isExtracted = isExtracted;
 }
 
 bool CachedFunctionAnalysisResult::isInputDependent(llvm::Instruction* instr) const
 {
-    return m_inputDepInstructions.find(instr) != m_inputDepInstructions.end();
+    return isInputDependent(const_cast<const llvm::Instruction*>(instr));
 }
 
 bool CachedFunctionAnalysisResult::isInputDependent(const llvm::Instruction* instr) const
 {
-    return m_inputDepInstructions.find(const_cast<llvm::Instruction*>(instr)) != m_inputDepInstructions.end();
+    if (isInputDepBlock(instr->getParent())) {
+        return true;
+    }
+    int index = m_numbering->getInstructionIndex(instr);
+    return index != -1 && FunctionCacheData::testBit(m_data.inputDepInstrs, index);
 }
 
 bool CachedFunctionAnalysisResult::isInputIndependent(llvm::Instruction* instr) const
 {
-    return m_inputIndepInstructions.find(instr) != m_inputIndepInstructions.end();
+    return isInputIndependent(const_cast<const llvm::Instruction*>(instr));
 }
 
 bool CachedFunctionAnalysisResult::isInputIndependent(const llvm::Instruction* instr) const
 {
-    return m_inputIndepInstructions.find(const_cast<llvm::Instruction*>(instr)) != m_inputIndepInstructions.end();
+    if (isInputDepBlock(instr->getParent()) || isUnreachableBlock(instr->getParent())) {
+        return false;
+    }
+    int index = m_numbering->getInstructionIndex(instr);
+    return index != -1 && FunctionCacheData::testBit(m_data.inputIndepInstrs, index);
 }
 
 bool CachedFunctionAnalysisResult::isInputDependentBlock(llvm::BasicBlock* block) const
 {
-    return m_inputDepBlocks.find(block) != m_inputDepBlocks.end();
+    return isInputDepBlock(block);
 }
 
+// Call sites are cached only in compact metadata format
 FunctionSet CachedFunctionAnalysisResult::getCallSitesData() const
 {
-    llvm::dbgs() << "CachedFunctionAnalysisResult has no information about call site data\n";
-    return FunctionSet();
+    decode();
+    FunctionSet calledFunctions;
+    for (const auto& callSite : m_data.callSites) {
+        llvm::Instruction* instr = m_numbering->getInstruction(callSite.instrIndex);
+        if (auto* calledF = instr ? FunctionCacheData::getCalledFunction(instr) : nullptr) {
+            calledFunctions.insert(calledF);
+        }
+    }
+    return calledFunctions;
 }
 
 FunctionCallDepInfo CachedFunctionAnalysisResult::getFunctionCallDepInfo(llvm::Function* F) const
 {
-    llvm::dbgs() << "CachedFunctionAnalysisResult has no information about call dep info\n";
-    return FunctionCallDepInfo();
+    decode();
+    FunctionCallDepInfo callDepInfo(*F);
+    llvm::Module* M = m_F->getParent();
+    for (const auto& callSite : m_data.callSites) {
+        llvm::Instruction* instr = m_numbering->getInstruction(callSite.instrIndex);
+        if (!instr || FunctionCacheData::getCalledFunction(instr) != F || callSite.argsCount != F->arg_size()) {
+            continue;
+        }
+        FunctionCallDepInfo::ArgumentDependenciesMap argDeps;
+        unsigned argNo = 0;
+        for (auto& arg : F->getArgumentList()) {
+            auto dep = FunctionCacheData::testBit(callSite.inputDepArgs, argNo++) ? DepInfo::INPUT_DEP : DepInfo::INPUT_INDEP;
+            argDeps.insert(std::make_pair(&arg, ValueDepInfo(arg.getType(), DepInfo(dep))));
+        }
+        FunctionCallDepInfo::GlobalVariableDependencyMap globalDeps;
+        for (const auto& name : callSite.inputDepGlobals) {
+            if (auto* global = M->getNamedGlobal(name)) {
+                globalDeps.insert(std::make_pair(global, ValueDepInfo(global->getType(), DepInfo(DepInfo::INPUT_DEP))));
+            }
+        }
+        for (const auto& name : callSite.inputIndepGlobals) {
+            if (auto* global = M->getNamedGlobal(name)) {
+                globalDeps.insert(std::make_pair(global, ValueDepInfo(global->getType(), DepInfo(DepInfo::INPUT_INDEP))));
+            }
+        }
+        callDepInfo.addCall(instr, argDeps);
+        callDepInfo.addCall(instr, globalDeps);
+    }
+    return callDepInfo;
+}
+
+// Call site data is keyed by instruction, thus only the call itself needs to change
+bool CachedFunctionAnalysisResult::changeFunctionCall(const llvm::Instruction* callInstr, llvm::Function* oldF, llvm::Function* newF)
+{
+    decode();
+    llvm::Instruction* instr = const_cast<llvm::Instruction*>(callInstr);
+    if (FunctionCacheData::getCalledFunction(instr) != oldF) {
+        return false;
+    }
+    if (auto call = llvm::dyn_cast<llvm::CallInst>(instr)) {
+        call->setCalledFunction(newF);
+    } else if (auto invoke = llvm::dyn_cast<llvm::InvokeInst>(instr)) {
+        invoke->setCalledFunction(newF);
+    }
+    return true;
 }
 
 long unsigned CachedFunctionAnalysisResult::get_input_dep_blocks_count() const
 {
-    return m_inputDepBlocks.size();
+    decode();
+    return m_inputDepBlocksCount;
 }
 
 long unsigned CachedFunctionAnalysisResult::get_input_indep_blocks_count() const
 {
-    return m_inputInDepBlocks.size();
+    decode();
+    return m_numbering->getBlocksCount() - m_inputDepBlocksCount - m_unreachableBlocksCount;
 }
 
 long unsigned CachedFunctionAnalysisResult::get_unreachable_blocks_count() const
 {
-    return m_unreachableBlocks.size();
+    decode();
+    return m_unreachableBlocksCount;
 }
 
 long unsigned CachedFunctionAnalysisResult::get_unreachable_instructions_count() const
 {
-    return m_unreachableInstructions.size();
+    decode();
+    return m_unreachableCount;
 }
 
 long unsigned CachedFunctionAnalysisResult::get_input_dep_count() const
 {
-    return m_inputDepInstructions.size();
+    decode();
+    return m_inputDepCount;
 }
 
 long unsigned CachedFunctionAnalysisResult::get_input_indep_count() const
 {
-    return m_inputIndepInstructions.size();
+    decode();
+    return m_inputIndepCount;
 }
 
 long unsigned CachedFunctionAnalysisResult::get_input_unknowns_count() const
 {
-    return m_unknownInstructions.size();
+    decode();
+    return m_unknownCount;
 }
 
 }
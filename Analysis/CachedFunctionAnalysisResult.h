@@ -1,8 +1,10 @@
 #pragma once
 
+#include "FunctionCacheData.h"
 #include "FunctionInputDependencyResultInterface.h"
 
-#include <unordered_set>
+#include <memory>
+#include <mutex>
 
 namespace llvm {
 class Function;
@@ -12,16 +14,24 @@ class Instruction;
 
 namespace input_dependency {
 
+class FunctionNumbering;
+
+/**
+ * \class CachedFunctionAnalysisResult
+ * \brief Input dependency results of a function read from IR metadata.
+ * Metadata is decoded on the first query into bit vectors over block and instruction ordinals.
+ * Decoding is done once, and is safe to be triggered from several threads.
+ */
 class CachedFunctionAnalysisResult final : public FunctionInputDependencyResultInterface
 {
-public:
-    using BasicBlocks = std::unordered_set<llvm::BasicBlock*>;
-    using Instructions = std::unordered_set<llvm::Instruction*>;
-
 public:
     CachedFunctionAnalysisResult(llvm::Function* F);
+    ~CachedFunctionAnalysisResult();
 
+    /// Forces decoding of cached results, otherwise done on first query.
     void analyze();
+    /// Returns false if cached results are outdated or missing. Decodes results.
+    bool isUpToDate() const;
     
 public:
     llvm::Function* getFunction() override;
@@ -37,6 +47,7 @@ public:
     bool isInputDependentBlock(llvm::BasicBlock* block) const override;
     FunctionSet getCallSitesData() const override;
     FunctionCallDepInfo getFunctionCallDepInfo(llvm::Function* F) const override;
+    bool changeFunctionCall(const llvm::Instruction* callInstr, llvm::Function* oldF, llvm::Function* newF) override;
 
     long unsigned get_input_dep_blocks_count() const override;
     long unsigned get_input_indep_blocks_count() const override;
@@ -46,25 +57,35 @@ public:
     long unsigned get_input_indep_count() const override;
     long unsigned get_input_unknowns_count() const override;
 
+    CachedFunctionAnalysisResult* toCachedInputDependentFunctionAnalysisResult() override
+    {
+        return this;
+    }
+
 private:
-    void parse_function_input_dep_metadata();
-    void parse_function_extracted_metadata();
-    void parse_block_input_dep_metadata(llvm::BasicBlock& B);
-    void parse_block_instructions_input_dep_metadata(llvm::BasicBlock& B);
-    void add_all_instructions_to(llvm::BasicBlock& B, Instructions& instructions);
-    void parse_instruction_input_dep_metadata(llvm::Instruction& I);
+    void decode() const;
+    bool parse_function_cache_metadata() const;
+    void parse_function_input_dep_metadata() const;
+    void parse_function_extracted_metadata() const;
+    void parse_block_input_dep_metadata(llvm::BasicBlock& B, unsigned index) const;
+    void parse_instruction_input_dep_metadata(llvm::Instruction& I, unsigned index) const;
+    void mark_all_input_dependent() const;
+    void count_results() const;
+    bool isInputDepBlock(const llvm::BasicBlock* block) const;
+    bool isUnreachableBlock(const llvm::BasicBlock* block) const;
 
 private:
     llvm::Function* m_F;
-    bool m_is_inputDep;
-    bool m_is_extracted;
-    BasicBlocks m_inputDepBlocks;
-    BasicBlocks m_inputInDepBlocks;
-    BasicBlocks m_unreachableBlocks;
-    Instructions m_inputDepInstructions;
-    Instructions m_inputIndepInstructions;
-    Instructions m_unknownInstructions;
-    Instructions m_unreachableInstructions;
+    mutable std::once_flag m_decoded;
+    mutable std::unique_ptr<FunctionNumbering> m_numbering;
+    mutable FunctionCacheData m_data;
+    mutable bool m_isUpToDate;
+    mutable long unsigned m_inputDepCount;
+    mutable long unsigned m_inputIndepCount;
+    mutable long unsigned m_unknownCount;
+    mutable long unsigned m_unreachableCount;
+    mutable long unsigned m_inputDepBlocksCount;
+    mutable long unsigned m_unreachableBlocksCount;
 }; // class CachedFunctionAnalysisResult
 
 } // namespace input_dependency
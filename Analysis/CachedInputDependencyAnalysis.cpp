@@ -1,9 +1,14 @@
 #include "CachedInputDependencyAnalysis.h"
 #include "Utils.h"
 
+#include "CacheFile.h"
 #include "CachedFunctionAnalysisResult.h"
+#include "InputDependencyAnalysis.h"
+#include "InputDependentFunctionAnalysisResult.h"
+#include "MappedFunctionAnalysisResult.h"
 
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/Support/Debug.h"
@@ -16,6 +21,13 @@ CachedInputDependencyAnalysis::CachedInputDependencyAnalysis(llvm::Module* M)
 {
 }
 
+CachedInputDependencyAnalysis::CachedInputDependencyAnalysis(llvm::Module* M,
+                                                             const std::shared_ptr<CacheFile>& cacheFile)
+    : m_module(M)
+    , m_cacheFile(cacheFile)
+{
+}
+
 void CachedInputDependencyAnalysis::run()
 {
     llvm::dbgs() << "Analyze cached input dependency\n";
@@ -23,15 +35,40 @@ void CachedInputDependencyAnalysis::run()
         if (Utils::isLibraryFunction(&F, m_module)) {
             continue;
         }
+        CacheFile::FunctionView view;
+        if (m_cacheFile && m_cacheFile->find(F.getName().str(), view)) {
+            MappedFunctionAnalysisResult* mapped_function = new MappedFunctionAnalysisResult(&F, m_cacheFile, view);
+            m_functionAnalisers.insert(std::make_pair(&F, InputDepResType(mapped_function)));
+            m_upToDateChecks[&F] = [mapped_function] () { return mapped_function->isUpToDate(); };
+            continue;
+        }
+        // cached results are decoded on first query
         CachedFunctionAnalysisResult* cached_function = new CachedFunctionAnalysisResult(&F);
-        cached_function->analyze();
         auto res = m_functionAnalisers.insert(std::make_pair(&F, InputDepResType(cached_function)));
         assert(res.second);
+        m_upToDateChecks[&F] = [cached_function] () { return cached_function->isUpToDate(); };
+    }
+}
+
+const CachedInputDependencyAnalysis::InputDependencyAnalysisInfo& CachedInputDependencyAnalysis::getAnalysisInfo() const
+{
+    for (auto& F : *m_module) {
+        refreshIfStale(&F);
+    }
+    return m_functionAnalisers;
+}
+
+CachedInputDependencyAnalysis::InputDependencyAnalysisInfo& CachedInputDependencyAnalysis::getAnalysisInfo()
+{
+    for (auto& F : *m_module) {
+        refreshIfStale(&F);
     }
+    return m_functionAnalisers;
 }
 
 bool CachedInputDependencyAnalysis::isInputDependent(llvm::Function* F, llvm::Instruction* instr) const
 {
+    refreshIfStale(F);
     auto pos = m_functionAnalisers.find(F);
     if (pos == m_functionAnalisers.end()) {
         return false;
@@ -50,6 +87,7 @@ bool CachedInputDependencyAnalysis::isInputDependent(llvm::Instruction* instr) c
 bool CachedInputDependencyAnalysis::isInputDependent(llvm::BasicBlock* block) const
 {
     auto F = block->getParent();
+    refreshIfStale(F);
     auto pos = m_functionAnalisers.find(F);
     if (pos == m_functionAnalisers.end()) {
         return false;
@@ -59,6 +97,7 @@ bool CachedInputDependencyAnalysis::isInputDependent(llvm::BasicBlock* block) co
 
 CachedInputDependencyAnalysis::InputDepResType CachedInputDependencyAnalysis::getAnalysisInfo(llvm::Function* F)
 {
+    refreshIfStale(F);
     auto pos = m_functionAnalisers.find(F);
     if (pos == m_functionAnalisers.end()) {
         return nullptr;
@@ -68,6 +107,7 @@ CachedInputDependencyAnalysis::InputDepResType CachedInputDependencyAnalysis::ge
 
 const CachedInputDependencyAnalysis::InputDepResType CachedInputDependencyAnalysis::getAnalysisInfo(llvm::Function* F) const
 {
+    refreshIfStale(F);
     auto pos = m_functionAnalisers.find(F);
     if (pos == m_functionAnalisers.end()) {
         return nullptr;
@@ -85,5 +125,99 @@ bool CachedInputDependencyAnalysis::insertAnalysisInfo(llvm::Function* F, InputD
     return true;
 }
 
+void CachedInputDependencyAnalysis::invalidate(llvm::Function* F)
+{
+    if (Utils::isLibraryFunction(F, m_module)) {
+        return;
+    }
+    m_upToDateChecks.erase(F);
+    if (m_refreshAnalysis) {
+        // results and analyses refresh analysis has for F describe its former IR
+        m_refreshAnalysis->invalidate(F);
+        m_invalidatedFunctions.insert(F);
+        // functions depending on F are checked again on their next query
+        for (auto function : m_refreshAnalysis->getAffectedFunctions(FunctionSet{F})) {
+            m_checkedFunctions.erase(function);
+        }
+        return;
+    }
+    InputDepResType inputDepResult(new InputDependentFunctionAnalysisResult(F));
+    auto pos = m_functionAnalisers.find(F);
+    if (pos != m_functionAnalisers.end()) {
+        inputDepResult->setIsExtractedFunction(pos->second->isExtractedFunction());
+    }
+    m_functionAnalisers[F] = inputDepResult;
 }
 
+void CachedInputDependencyAnalysis::invalidateCallSite(llvm::Instruction* callSite)
+{
+    invalidate(callSite->getParent()->getParent());
+    // cached results of callee may not be valid for the new call site
+    llvm::Function* calledF = nullptr;
+    if (auto* callInst = llvm::dyn_cast<llvm::CallInst>(callSite)) {
+        calledF = callInst->getCalledFunction();
+    } else if (auto* invokeInst = llvm::dyn_cast<llvm::InvokeInst>(callSite)) {
+        calledF = invokeInst->getCalledFunction();
+    }
+    if (calledF) {
+        invalidate(calledF);
+    }
+}
+
+void CachedInputDependencyAnalysis::removeFunction(llvm::Function* F)
+{
+    m_functionAnalisers.erase(F);
+    m_upToDateChecks.erase(F);
+    m_checkedFunctions.erase(F);
+    m_invalidatedFunctions.erase(F);
+    if (m_refreshAnalysis) {
+        m_refreshAnalysis->removeFunction(F);
+    }
+}
+
+void CachedInputDependencyAnalysis::setRefreshAnalysis(const std::shared_ptr<InputDependencyAnalysis>& analysis)
+{
+    m_refreshAnalysis = analysis;
+}
+
+void CachedInputDependencyAnalysis::refreshIfStale(llvm::Function* F) const
+{
+    if (!m_refreshAnalysis || (m_upToDateChecks.empty() && m_invalidatedFunctions.empty())
+            || !m_checkedFunctions.insert(F).second) {
+        return;
+    }
+    // results of F depend on functions, which are affected by F
+    FunctionSet staleFunctions;
+    for (auto function : m_refreshAnalysis->getAffectedFunctions(FunctionSet{F})) {
+        if (isStale(function)) {
+            staleFunctions.insert(function);
+        }
+    }
+    if (staleFunctions.empty()) {
+        return;
+    }
+    for (auto function : m_refreshAnalysis->refresh(staleFunctions, m_functionAnalisers)) {
+        // replaced results are fresh
+        m_upToDateChecks.erase(function);
+        m_invalidatedFunctions.erase(function);
+    }
+}
+
+bool CachedInputDependencyAnalysis::isStale(llvm::Function* F) const
+{
+    if (m_invalidatedFunctions.find(F) != m_invalidatedFunctions.end()) {
+        return true;
+    }
+    auto pos = m_upToDateChecks.find(F);
+    if (pos == m_upToDateChecks.end()) {
+        return false;
+    }
+    bool is_up_to_date = pos->second();
+    m_upToDateChecks.erase(pos);
+    if (!is_up_to_date) {
+        llvm::dbgs() << "Cached input dependency of function " << F->getName() << " is stale\n";
+    }
+    return !is_up_to_date;
+}
+
+}
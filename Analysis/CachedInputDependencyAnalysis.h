@@ -1,6 +1,11 @@
 #pragma once
 
 #include "InputDependencyAnalysisInterface.h"
+#include "definitions.h"
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
 
 namespace llvm {
 class Function;
@@ -11,10 +16,15 @@ class Module;
 
 namespace input_dependency {
 
+class CacheFile;
+class InputDependencyAnalysis;
+
 class CachedInputDependencyAnalysis final : public InputDependencyAnalysisInterface
 {
 public:
     CachedInputDependencyAnalysis(llvm::Module* M);
+    /// Results of functions found in the cache file are read from the file, rest from IR metadata.
+    CachedInputDependencyAnalysis(llvm::Module* M, const std::shared_ptr<CacheFile>& cacheFile);
 
 public:
     void run() override;
@@ -23,24 +33,46 @@ public:
     bool isInputDependent(llvm::Instruction* instr) const override;
     bool isInputDependent(llvm::BasicBlock* block) const override;
 
-    const InputDependencyAnalysisInfo& getAnalysisInfo() const override
-    {
-        return m_functionAnalisers;
-    }
-
-    InputDependencyAnalysisInfo& getAnalysisInfo() override
-    {
-        return m_functionAnalisers;
-    }
+    /// Requesting whole module info checks cached results of all functions.
+    const InputDependencyAnalysisInfo& getAnalysisInfo() const override;
+    InputDependencyAnalysisInfo& getAnalysisInfo() override;
 
     InputDepResType getAnalysisInfo(llvm::Function* F) override;
     const InputDepResType getAnalysisInfo(llvm::Function* F) const override;
 
     bool insertAnalysisInfo(llvm::Function* F, InputDepResType analysis_info) override;
+    /// Invalidated functions are re-analysed with refresh analysis when their results are requested.
+    /// Without refresh analysis cached results can not be recomputed, and invalidated functions get conservative
+    /// input dependent results.
+    void invalidate(llvm::Function* F) override;
+    void invalidateCallSite(llvm::Instruction* callSite) override;
+    void removeFunction(llvm::Function* F) override;
+
+    /**
+     * \brief Sets analysis to re-analyse functions with stale cached results, and functions affected by them.
+     * Cached results of a function are checked against its IR when they, or results depending on them, are first requested.
+     * \param analysis lazy analysis of the module, kept alive as long as its results are used.
+     */
+    void setRefreshAnalysis(const std::shared_ptr<InputDependencyAnalysis>& analysis);
+
+private:
+    /// Re-analyses stale functions results of F depend on, if any.
+    void refreshIfStale(llvm::Function* F) const;
+    /// Returns true if F has been invalidated, or cached results of F do not match its IR. Checks cached results of F,
+    /// if not checked yet.
+    bool isStale(llvm::Function* F) const;
 
 private:
     llvm::Module* m_module;
-    InputDependencyAnalysisInfo m_functionAnalisers;
+    std::shared_ptr<CacheFile> m_cacheFile;
+    std::shared_ptr<InputDependencyAnalysis> m_refreshAnalysis;
+    mutable InputDependencyAnalysisInfo m_functionAnalisers;
+    // checks of cached results not done yet. Checking decodes results, which hashes the function.
+    mutable std::unordered_map<llvm::Function*, std::function<bool ()>> m_upToDateChecks;
+    // functions all results they depend on have been checked for
+    mutable FunctionSet m_checkedFunctions;
+    // invalidated functions to be re-analysed
+    mutable FunctionSet m_invalidatedFunctions;
 };
 
 } // namespace input_dependency
@@ -6,6 +6,7 @@
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Function.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace input_dependency {
@@ -16,22 +17,43 @@ ClonedFunctionAnalysisResult::ClonedFunctionAnalysisResult(llvm::Function* F)
     , m_is_extracted(false)
     , m_instructionsCount(0)
 {
-    for (const auto& B : *m_F) {
-        m_instructionsCount += B.getInstList().size();
+    for (const auto& B : *F) {
+        m_instructionsCount += B.size();
     }
 }
 
 void ClonedFunctionAnalysisResult::setInputDepInstrs(InstrSet&& inputDeps)
 {
-    m_inputDependentInstrs = std::move(inputDeps);
+    m_inputDependentInstrs = toInstructionBits(inputDeps);
 }
 
 void ClonedFunctionAnalysisResult::setInputIndepInstrs(InstrSet&& inputIndeps)
 {
-    m_inputIndependentInstrs = std::move(inputIndeps);
+    m_inputIndependentInstrs = toInstructionBits(inputIndeps);
 }
 
 void ClonedFunctionAnalysisResult::setInputDependentBasicBlocks(std::unordered_set<llvm::BasicBlock*>&& inputDeps)
+{
+    m_inputDependentBasicBlocks.clear();
+    for (const auto& block : inputDeps) {
+        int index = getNumbering().getBlockIndex(block);
+        if (index != -1) {
+            FunctionCacheData::setBit(m_inputDependentBasicBlocks, index);
+        }
+    }
+}
+
+void ClonedFunctionAnalysisResult::setInputDepInstrs(FunctionCacheData::Bits&& inputDeps)
+{
+    m_inputDependentInstrs = std::move(inputDeps);
+}
+
+void ClonedFunctionAnalysisResult::setInputIndepInstrs(FunctionCacheData::Bits&& inputIndeps)
+{
+    m_inputIndependentInstrs = std::move(inputIndeps);
+}
+
+void ClonedFunctionAnalysisResult::setInputDependentBasicBlocks(FunctionCacheData::Bits&& inputDeps)
 {
     m_inputDependentBasicBlocks = std::move(inputDeps);
 }
@@ -78,27 +100,28 @@ void ClonedFunctionAnalysisResult::setIsExtractedFunction(bool isExtracted)
 
 bool ClonedFunctionAnalysisResult::isInputDependent(llvm::Instruction* instr) const
 {
-    return m_inputDependentInstrs.find(instr) != m_inputDependentInstrs.end();
+    return testInstruction(m_inputDependentInstrs, instr);
 }
 
 bool ClonedFunctionAnalysisResult::isInputDependent(const llvm::Instruction* instr) const
 {
-    return m_inputDependentInstrs.find(const_cast<llvm::Instruction*>(instr)) != m_inputDependentInstrs.end();
+    return testInstruction(m_inputDependentInstrs, instr);
 }
 
 bool ClonedFunctionAnalysisResult::isInputIndependent(llvm::Instruction* instr) const
 {
-    return m_inputIndependentInstrs.find(instr) != m_inputIndependentInstrs.end();
+    return testInstruction(m_inputIndependentInstrs, instr);
 }
 
 bool ClonedFunctionAnalysisResult::isInputIndependent(const llvm::Instruction* instr) const
 {
-    return m_inputIndependentInstrs.find(const_cast<llvm::Instruction*>(instr)) != m_inputIndependentInstrs.end();
+    return testInstruction(m_inputIndependentInstrs, instr);
 }
 
 bool ClonedFunctionAnalysisResult::isInputDependentBlock(llvm::BasicBlock* block) const
 {
-    return m_inputDependentBasicBlocks.find(block) != m_inputDependentBasicBlocks.end();
+    int index = getNumbering().getBlockIndex(block);
+    return index != -1 && FunctionCacheData::testBit(m_inputDependentBasicBlocks, index);
 }
 
 FunctionSet ClonedFunctionAnalysisResult::getCallSitesData() const
@@ -151,7 +174,7 @@ bool ClonedFunctionAnalysisResult::changeFunctionCall(const llvm::Instruction* c
 
 long unsigned ClonedFunctionAnalysisResult::get_input_dep_blocks_count() const
 {
-    return m_inputDependentBasicBlocks.size();
+    return countBits(m_inputDependentBasicBlocks);
 }
 
 long unsigned ClonedFunctionAnalysisResult::get_input_indep_blocks_count() const
@@ -171,12 +194,12 @@ long unsigned ClonedFunctionAnalysisResult::get_unreachable_instructions_count()
 
 long unsigned ClonedFunctionAnalysisResult::get_input_dep_count() const
 {
-    return m_inputDependentInstrs.size();
+    return countBits(m_inputDependentInstrs);
 }
 
 long unsigned ClonedFunctionAnalysisResult::get_input_indep_count() const
 {
-    return m_inputIndependentInstrs.size();
+    return countBits(m_inputIndependentInstrs);
 }
 
 long unsigned ClonedFunctionAnalysisResult::get_input_unknowns_count() const
@@ -184,6 +207,42 @@ long unsigned ClonedFunctionAnalysisResult::get_input_unknowns_count() const
     return m_instructionsCount - get_input_dep_count() - get_input_indep_count();
 }
 
+const FunctionNumbering& ClonedFunctionAnalysisResult::getNumbering() const
+{
+    std::call_once(m_numbered, [this] () {
+        m_numbering.reset(new FunctionNumbering(m_F));
+    });
+    return *m_numbering;
+}
+
+bool ClonedFunctionAnalysisResult::testInstruction(const FunctionCacheData::Bits& bits, const llvm::Instruction* instr) const
+{
+    // instructions added after results were set have no ordinal
+    int index = getNumbering().getInstructionIndex(instr);
+    return index != -1 && FunctionCacheData::testBit(bits, index);
+}
+
+FunctionCacheData::Bits ClonedFunctionAnalysisResult::toInstructionBits(const InstrSet& instrs) const
+{
+    FunctionCacheData::Bits bits;
+    for (const auto& instr : instrs) {
+        int index = getNumbering().getInstructionIndex(instr);
+        if (index != -1) {
+            FunctionCacheData::setBit(bits, index);
+        }
+    }
+    return bits;
+}
+
+long unsigned ClonedFunctionAnalysisResult::countBits(const FunctionCacheData::Bits& bits)
+{
+    long unsigned count = 0;
+    for (const auto& word : bits) {
+        count += llvm::countPopulation(word);
+    }
+    return count;
+}
+
 
 } // namespace input_dependency
 
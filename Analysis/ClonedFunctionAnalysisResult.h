@@ -1,6 +1,11 @@
 #pragma once
 
 #include "FunctionInputDependencyResultInterface.h"
+#include "FunctionCacheData.h"
+#include "FunctionNumbering.h"
+
+#include <memory>
+#include <mutex>
 
 namespace llvm {
 
@@ -11,6 +16,14 @@ class BasicBlock;
 
 namespace input_dependency {
 
+/**
+ * \class ClonedFunctionAnalysisResult
+ * \brief Input dependency results of a clone or of an extracted function.
+ * Results are kept as bit vectors over instruction and block ordinals of the function (\see FunctionNumbering).
+ * As cloning preserves layout, ordinals of a clone are the ones of its original.
+ * The numbering itself is built on first query, as results of many clones are set from bits and never queried.
+ * Queries thus expect the layout of the function not to change between setting results and first query.
+ */
 class ClonedFunctionAnalysisResult final : public FunctionInputDependencyResultInterface
 {
 public:
@@ -19,6 +32,10 @@ public:
     void setInputDepInstrs(InstrSet&& inputDeps);
     void setInputIndepInstrs(InstrSet&& inputIndeps);
     void setInputDependentBasicBlocks(std::unordered_set<llvm::BasicBlock*>&& inputDeps);
+    /// Setters by instruction and block ordinals
+    void setInputDepInstrs(FunctionCacheData::Bits&& inputDeps);
+    void setInputIndepInstrs(FunctionCacheData::Bits&& inputIndeps);
+    void setInputDependentBasicBlocks(FunctionCacheData::Bits&& inputDeps);
     void setCalledFunctions(const FunctionSet& calledFunctions);
     void setFunctionCallDepInfo(std::unordered_map<llvm::Function*, FunctionCallDepInfo>&& callDepInfo);
 
@@ -53,15 +70,23 @@ public:
          return this;
      }
 
+private:
+    const FunctionNumbering& getNumbering() const;
+    bool testInstruction(const FunctionCacheData::Bits& bits, const llvm::Instruction* instr) const;
+    FunctionCacheData::Bits toInstructionBits(const InstrSet& instrs) const;
+    static long unsigned countBits(const FunctionCacheData::Bits& bits);
+
 private:
     llvm::Function* m_F;
     bool m_is_inputDep;
     bool m_is_extracted;
     unsigned int m_instructionsCount;
-    InstrSet m_inputIndependentInstrs;
-    InstrSet m_inputDependentInstrs;
+    mutable std::once_flag m_numbered;
+    mutable std::unique_ptr<FunctionNumbering> m_numbering;
+    FunctionCacheData::Bits m_inputIndependentInstrs;
+    FunctionCacheData::Bits m_inputDependentInstrs;
+    FunctionCacheData::Bits m_inputDependentBasicBlocks;
     FunctionSet m_calledFunctions;
-    std::unordered_set<llvm::BasicBlock*> m_inputDependentBasicBlocks;
     std::unordered_map<llvm::Function*, FunctionCallDepInfo> m_functionCallDepInfo;
 }; //class ClonedFunctionAnalysisResult
 
@@ -1,5 +1,7 @@
 #include "DependencyAnaliser.h"
 
+#include "AnalysisProfiler.h"
+#include "MemoryUsage.h"
 #include "InputDepInstructionsRecorder.h"
 #include "InputDepConfig.h"
 #include "FunctionAnaliser.h"
@@ -527,6 +529,22 @@ void DependencyAnaliser::updateFunctionInvokeSiteInfo(llvm::InvokeInst* invokeIn
     pos.first->second.addInvoke(invokeInst, globalsDepMap);
 }
 
+long unsigned DependencyAnaliser::getDependenciesMemoryUsage() const
+{
+    return MemoryUsage::heapOf(m_functionValues)
+        + MemoryUsage::heapOf(m_outArgDependencies)
+        + MemoryUsage::heapOf(m_returnValueDependencies)
+        + MemoryUsage::heapOf(m_calledFunctions)
+        + MemoryUsage::heapOf(m_functionCallInfo)
+        + MemoryUsage::heapOf(m_inputIndependentInstrs)
+        + MemoryUsage::heapOf(m_inputDependentInstrs)
+        + MemoryUsage::heapOf(m_finalInputDependentInstrs)
+        + MemoryUsage::heapOf(m_valueDependencies)
+        + MemoryUsage::heapOf(m_initialDependencies)
+        + MemoryUsage::heapOf(m_referencedGlobals)
+        + MemoryUsage::heapOf(m_modifiedGlobals);
+}
+
 ArgumentSet DependencyAnaliser::isInput(llvm::Value* val) const
 {
     for (auto& arg : m_inputs) {
@@ -539,6 +557,7 @@ ArgumentSet DependencyAnaliser::isInput(llvm::Value* val) const
     ArgumentSet set;
     for (auto& arg : m_inputs) {
         if (auto* argVal = llvm::dyn_cast<llvm::Value>(arg)) {
+            AnalysisProfiler::get().count(AnalysisProfiler::AA_QUERIES);
             auto aliasResult = m_AAR.alias(argVal, val);
             if (aliasResult != llvm::AliasResult::NoAlias) {
                 set.insert(arg);
@@ -147,6 +147,10 @@ protected:
     static llvm::Value* getFunctionOutArgumentValue(llvm::Value* actualArg);
     static llvm::Value* getMemoryValue(llvm::Value* instrOp);
 
+protected:
+    /// Estimated bytes held by dependency containers of this analiser.
+    long unsigned getDependenciesMemoryUsage() const;
+
 protected:
     llvm::Function* m_F;
     const Arguments& m_inputs;
@@ -77,6 +77,8 @@ public:
     virtual long unsigned get_input_dep_count() const = 0;
     virtual long unsigned get_input_indep_count() const = 0;
     virtual long unsigned get_input_unknowns_count() const = 0;
+    /// Estimated bytes held by the results. \see MemoryUsage
+    virtual long unsigned get_memory_usage() const = 0;
     /// \}
 
 protected:
@@ -1,5 +1,7 @@
 #include "FunctionAnaliser.h"
 
+#include "AnalysisProfiler.h"
+#include "TraceRecorder.h"
 #include "BasicBlockAnalysisResult.h"
 #include "DependencyAnalysisResult.h"
 #include "DependencyAnaliser.h"
@@ -11,7 +13,11 @@
 #include "Utils.h"
 #include "ClonedFunctionAnalysisResult.h"
 #include "CFGTraversalPath.h"
+#include "FunctionCacheData.h"
+#include "FunctionNumbering.h"
+#include "FunctionSummary.h"
 #include "InputDepConfig.h"
+#include "MemoryUsage.h"
 #include "exception.h"
 
 #include "llvm/ADT/SCCIterator.h"
@@ -29,7 +35,7 @@
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
 
-#include <chrono>
+#include <algorithm>
 #include <forward_list>
 #include <list>
 
@@ -37,7 +43,7 @@ namespace input_dependency {
 
 namespace {
 
-llvm::Value* get_mapped_value(llvm::Value* val, llvm::ValueToValueMapTy& VMap)
+llvm::Value* get_mapped_value(llvm::Value* val, const llvm::ValueToValueMapTy& VMap)
 {
     auto map_pos = VMap.find(val);
     if (map_pos == VMap.end()) {
@@ -49,7 +55,7 @@ llvm::Value* get_mapped_value(llvm::Value* val, llvm::ValueToValueMapTy& VMap)
 
 llvm::Instruction* get_mapped_instruction(llvm::Instruction* I,
                                           std::unordered_map<llvm::Instruction*, llvm::Instruction*>& instr_map,
-                                          llvm::ValueToValueMapTy& VMap)
+                                          const llvm::ValueToValueMapTy& VMap)
 {
     auto local_map_pos = instr_map.find(I);
     if (local_map_pos != instr_map.end()) {
@@ -70,7 +76,7 @@ llvm::Instruction* get_mapped_instruction(llvm::Instruction* I,
 
 llvm::Argument* get_mapped_argument(llvm::Argument* arg,
                                     std::unordered_map<llvm::Argument*, llvm::Argument*>& argument_mapping,
-                                    llvm::ValueToValueMapTy& VMap)
+                                    const llvm::ValueToValueMapTy& VMap)
 {
     auto local_map_pos = argument_mapping.find(arg);
     if (local_map_pos != argument_mapping.end()) {
@@ -105,6 +111,9 @@ public:
         , m_globalsUpdated(false)
         , m_is_inputDep(false)
         , m_is_extracted(false)
+        , m_blocksMemoryUsage(0)
+        , m_loopsMemoryUsage(0)
+        , m_peakMemoryUsage(0)
     {
     }
 
@@ -228,7 +237,31 @@ public:
     long unsigned get_input_dep_count() const;
     long unsigned get_input_indep_count() const;
     long unsigned get_input_unknowns_count() const;
+    long unsigned get_memory_usage() const;
+    long unsigned get_blocks_memory_usage() const
+    {
+        return m_blocksMemoryUsage;
+    }
+    long unsigned get_loops_memory_usage() const
+    {
+        return m_loopsMemoryUsage;
+    }
+    long unsigned get_peak_memory_usage() const
+    {
+        return m_peakMemoryUsage;
+    }
     FunctionInputDependencyResultInterface* cloneForArguments(const DependencyAnaliser::ArgumentDependenciesMap& inputDepArgs);
+    FunctionInputDependencyResultInterface* cloneForArguments(const DependencyAnaliser::ArgumentDependenciesMap& inputDepArgs,
+                                                              llvm::Function* clonedF,
+                                                              const llvm::ValueToValueMapTy& VMap);
+    void collectSummaryInterface(FunctionSummary& summary) const;
+    void collectSummaryResults(FunctionSummary& summary) const;
+    bool loadSummary(const std::shared_ptr<FunctionSummary>& summary);
+    bool isLoadedFromSummary() const
+    {
+        return m_summary != nullptr;
+    }
+    void reset();
     void dump() const;
 
 private:
@@ -258,6 +291,7 @@ private:
     DependencyAnaliser::ArgumentDependenciesMap getBasicBlockPredecessorsArguments(llvm::BasicBlock* B);
     DependencyAnaliser::ValueCallbackMap getBasicBlockPredecessorsCallbackFunctions(llvm::BasicBlock* B);
     DependencyAnalysisResultT getAnalysisResult(llvm::BasicBlock* B) const;
+    bool changeSummaryFunctionCall(llvm::Instruction* callInstr, llvm::Function* oldF, llvm::Function* newF);
 
 private:
     llvm::Function* m_F;
@@ -289,11 +323,28 @@ private:
     std::unordered_map<llvm::BasicBlock*, llvm::BasicBlock*> m_loopBlocks;
     // last block of a function is not always the exit block, as it may be unreachable from entry
     llvm::BasicBlock* m_exit_block;
+
+    // Results loaded from function summary. Used instead of m_BBAnalysisResults when summary is set.
+    std::shared_ptr<FunctionSummary> m_summary;
+    InstrSet m_summaryInputDepInstrs;
+    InstrSet m_summaryInputIndepInstrs;
+    std::unordered_set<llvm::BasicBlock*> m_summaryInputDepBlocks;
+    GlobalVariableDependencyMap m_summaryGlobalDeps;
+    std::unordered_map<llvm::Function*, FunctionCallDepInfo> m_summaryCallDepInfos;
+
+    // Memory accounting, collected only when statistics are requested. Blocks and loops usage is measured right
+    // after analysis, peak includes transient predecessor dependencies and finalization.
+    long unsigned m_blocksMemoryUsage;
+    long unsigned m_loopsMemoryUsage;
+    long unsigned m_peakMemoryUsage;
 }; // class FunctionAnaliser::Impl
 
 
 bool FunctionAnaliser::Impl::isInputDependent(llvm::Instruction* instr) const
 {
+    if (m_summary) {
+        return m_summaryInputDepInstrs.find(instr) != m_summaryInputDepInstrs.end();
+    }
     const auto& analysisRes = getAnalysisResult(instr->getParent());
     if (analysisRes) {
         return analysisRes->isInputDependent(instr);
@@ -303,6 +354,9 @@ bool FunctionAnaliser::Impl::isInputDependent(llvm::Instruction* instr) const
 
 bool FunctionAnaliser::Impl::isInputIndependent(llvm::Instruction* instr) const
 {
+    if (m_summary) {
+        return m_summaryInputIndepInstrs.find(instr) != m_summaryInputIndepInstrs.end();
+    }
     const auto& analysisRes = getAnalysisResult(instr->getParent());
     if (analysisRes) {
         return analysisRes->isInputIndependent(instr);
@@ -321,6 +375,9 @@ bool FunctionAnaliser::Impl::isInputIndependent(llvm::Value* val) const
 
 bool FunctionAnaliser::Impl::isInputDependentBlock(llvm::BasicBlock* block) const
 {
+    if (m_summary) {
+        return m_summaryInputDepBlocks.find(block) != m_summaryInputDepBlocks.end();
+    }
     const auto& analysisRes = getAnalysisResult(block);
     if (analysisRes) {
         return analysisRes->isInputDependent(block);
@@ -358,6 +415,9 @@ const ValueDepInfo& FunctionAnaliser::Impl::getRetValueDependencies() const
  
 bool FunctionAnaliser::Impl::hasGlobalVariableDepInfo(llvm::GlobalVariable* global) const
 {
+    if (m_summary) {
+        return m_summaryGlobalDeps.find(global) != m_summaryGlobalDeps.end();
+    }
     const auto& pos = m_BBAnalysisResults.find(m_exit_block);
     assert(pos != m_BBAnalysisResults.end());
     llvm::Value* val = llvm::dyn_cast<llvm::GlobalVariable>(global);
@@ -367,6 +427,13 @@ bool FunctionAnaliser::Impl::hasGlobalVariableDepInfo(llvm::GlobalVariable* glob
 
 ValueDepInfo FunctionAnaliser::Impl::getGlobalVariableDependencies(llvm::GlobalVariable* global) const
 {
+    if (m_summary) {
+        auto pos = m_summaryGlobalDeps.find(global);
+        if (pos == m_summaryGlobalDeps.end()) {
+            return ValueDepInfo();
+        }
+        return pos->second;
+    }
     const auto& pos = m_BBAnalysisResults.find(m_exit_block);
     assert(pos != m_BBAnalysisResults.end());
     llvm::Value* val = llvm::dyn_cast<llvm::GlobalVariable>(global);
@@ -420,6 +487,13 @@ FunctionAnaliser::Impl::getCallArgumentInfo(llvm::Function* F) const
 FunctionCallDepInfo FunctionAnaliser::Impl::getFunctionCallDepInfo(llvm::Function* F) const
 {
     assert(m_calledFunctions.find(F) != m_calledFunctions.end());
+    if (m_summary) {
+        auto pos = m_summaryCallDepInfos.find(F);
+        if (pos == m_summaryCallDepInfos.end()) {
+            return FunctionCallDepInfo(*F);
+        }
+        return pos->second;
+    }
     FunctionCallDepInfo callDepInfo(*F);
     for (const auto& result : m_BBAnalysisResults) {
         if (result.second->hasFunctionCallInfo(F)) {
@@ -432,6 +506,9 @@ FunctionCallDepInfo FunctionAnaliser::Impl::getFunctionCallDepInfo(llvm::Functio
 
 bool FunctionAnaliser::Impl::changeFunctionCall(llvm::Instruction* callInstr, llvm::Function* oldF, llvm::Function* newF)
 {
+    if (m_summary) {
+        return changeSummaryFunctionCall(callInstr, oldF, newF);
+    }
     llvm::BasicBlock* block = callInstr->getParent();
     auto analysisRes = getAnalysisResult(block);
     if (!analysisRes) {
@@ -480,8 +557,8 @@ const GlobalsSet& FunctionAnaliser::Impl::getModifiedGlobals() const
 
 void FunctionAnaliser::Impl::analyze()
 {
-    typedef std::chrono::high_resolution_clock Clock;
-    auto tic = Clock::now();
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::ANALYSIS, m_F);
+    TraceRecorder::ScopedSpan span("analyze", m_F);
     collectArguments();
 
     CFGTraversalPathCreator traversalPath(*m_F);
@@ -490,6 +567,9 @@ void FunctionAnaliser::Impl::analyze()
     traversalPath.construct(CFGTraversalPathCreator::CFG);
     const auto& blocks_in_traversal_order = traversalPath.getBlocksInOrder();
     m_loopBlocks= traversalPath.getBlocksLoops();
+    const bool track_memory = InputDepConfig::get().is_memory_stats();
+    m_blocksMemoryUsage = 0;
+    m_loopsMemoryUsage = 0;
     llvm::BasicBlock* bb;
     for (auto& block : blocks_in_traversal_order) {
         bb = block.first;
@@ -500,10 +580,19 @@ void FunctionAnaliser::Impl::analyze()
         } else {
             m_BBAnalysisResults[bb] = createBasicBlockAnalysisResult(bb, depInfo);
         }
-        m_BBAnalysisResults[bb]->setInitialValueDependencies(getBasicBlockPredecessorsDependencies(bb));
+        const auto& predecessorsDeps = getBasicBlockPredecessorsDependencies(bb);
+        if (track_memory) {
+            m_peakMemoryUsage = std::max(m_peakMemoryUsage,
+                                         m_blocksMemoryUsage + m_loopsMemoryUsage + MemoryUsage::of(predecessorsDeps));
+        }
+        m_BBAnalysisResults[bb]->setInitialValueDependencies(predecessorsDeps);
         m_BBAnalysisResults[bb]->setOutArguments(getBasicBlockPredecessorsArguments(bb));
         m_BBAnalysisResults[bb]->setCallbackFunctions(getBasicBlockPredecessorsCallbackFunctions(bb));
         m_BBAnalysisResults[bb]->gatherResults();
+        if (track_memory) {
+            // results of the block do not change until finalization
+            (block.second ? m_loopsMemoryUsage : m_blocksMemoryUsage) += m_BBAnalysisResults[bb]->get_memory_usage();
+        }
 
         updateValueDependencies(bb);
         updateCalledFunctionsList(m_BBAnalysisResults[bb]);
@@ -512,9 +601,12 @@ void FunctionAnaliser::Impl::analyze()
     }
     m_exit_block = bb;
     m_inputs.clear();
-    auto toc = Clock::now();
-    if (getenv("INPUT_DEP_TIME")) {
-        llvm::dbgs() << "Input dep elapsed time " << std::chrono::duration_cast<std::chrono::nanoseconds>(toc - tic).count() << "\n";
+    // these may be released once analysis is done, results use only loop info
+    m_AAR = nullptr;
+    m_postDomTree = nullptr;
+    m_domTree = nullptr;
+    if (track_memory) {
+        m_peakMemoryUsage = std::max(m_peakMemoryUsage, get_memory_usage());
     }
 }
 
@@ -525,6 +617,8 @@ void FunctionAnaliser::Impl::finalizeArguments(const ArgumentDependenciesMap& de
     //    llvm::dbgs() << *arg.first << "     " << arg.second.getDependencyName() << "\n";
     //}
 
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::FINALIZATION, m_F);
+    TraceRecorder::ScopedSpan span("finalize_arguments", m_F);
     m_calledFunctionsInfo.clear();
     m_calledFunctionGlobalsInfo.clear();
     for (auto& item : m_BBAnalysisResults) {
@@ -534,19 +628,30 @@ void FunctionAnaliser::Impl::finalizeArguments(const ArgumentDependenciesMap& de
     }
     updateFunctionInputDependencies();
     m_argumentsFinalized = true;
+    if (InputDepConfig::get().is_memory_stats()) {
+        m_peakMemoryUsage = std::max(m_peakMemoryUsage, get_memory_usage());
+    }
 }
 
 void FunctionAnaliser::Impl::finalizeGlobals(const GlobalVariableDependencyMap& globalsDeps)
 {
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::FINALIZATION, m_F);
+    TraceRecorder::ScopedSpan span("finalize_globals", m_F);
     for (auto& item : m_BBAnalysisResults) {
         item.second->finalizeGlobals(globalsDeps);
     }
     updateFunctionInputDependencies();
     m_globalsFinalized = true;
+    if (InputDepConfig::get().is_memory_stats()) {
+        m_peakMemoryUsage = std::max(m_peakMemoryUsage, get_memory_usage());
+    }
 }
 
 long unsigned FunctionAnaliser::Impl::get_input_dep_blocks_count() const
 {
+    if (m_summary) {
+        return m_summaryInputDepBlocks.size();
+    }
     long unsigned count = 0;
     for (const auto& analiser : m_BBAnalysisResults) {
         count += analiser.second->get_input_dep_blocks_count();
@@ -556,6 +661,9 @@ long unsigned FunctionAnaliser::Impl::get_input_dep_blocks_count() const
 
 long unsigned FunctionAnaliser::Impl::get_input_indep_blocks_count() const
 {
+    if (m_summary) {
+        return m_F->getBasicBlockList().size() - m_summaryInputDepBlocks.size();
+    }
     long unsigned count = 0;
     for (const auto& analiser : m_BBAnalysisResults) {
         count += analiser.second->get_input_indep_blocks_count();
@@ -575,6 +683,9 @@ long unsigned FunctionAnaliser::Impl::get_unreachable_instructions_count() const
 
 long unsigned FunctionAnaliser::Impl::get_input_dep_count() const
 {
+    if (m_summary) {
+        return m_summaryInputDepInstrs.size();
+    }
     long unsigned count = 0;
     for (const auto& analiser : m_BBAnalysisResults) {
         count += analiser.second->get_input_dep_count();
@@ -584,6 +695,9 @@ long unsigned FunctionAnaliser::Impl::get_input_dep_count() const
 
 long unsigned FunctionAnaliser::Impl::get_input_indep_count() const
 {
+    if (m_summary) {
+        return m_summaryInputIndepInstrs.size();
+    }
     long unsigned count = 0;
     for (const auto& analiser : m_BBAnalysisResults) {
         count += analiser.second->get_input_indep_count();
@@ -593,6 +707,13 @@ long unsigned FunctionAnaliser::Impl::get_input_indep_count() const
 
 long unsigned FunctionAnaliser::Impl::get_input_unknowns_count() const
 {
+    if (m_summary) {
+        long unsigned instrs_count = 0;
+        for (auto& B : *m_F) {
+            instrs_count += B.getInstList().size();
+        }
+        return instrs_count - m_summaryInputDepInstrs.size() - m_summaryInputIndepInstrs.size();
+    }
     long unsigned count = 0;
     for (const auto& analiser : m_BBAnalysisResults) {
         count += analiser.second->get_input_unknowns_count();
@@ -605,53 +726,63 @@ FunctionAnaliser::Impl::cloneForArguments(const DependencyAnaliser::ArgumentDepe
 {
     llvm::ValueToValueMapTy VMap;
     llvm::Function* newF = llvm::CloneFunction(m_F, VMap);
+    return cloneForArguments(inputDepArgs, newF, VMap);
+}
 
-    ClonedFunctionAnalysisResult* clonedResults = new ClonedFunctionAnalysisResult(newF);
+FunctionInputDependencyResultInterface*
+FunctionAnaliser::Impl::cloneForArguments(const DependencyAnaliser::ArgumentDependenciesMap& inputDepArgs,
+                                          llvm::Function* clonedF,
+                                          const llvm::ValueToValueMapTy& VMap)
+{
+    ClonedFunctionAnalysisResult* clonedResults = new ClonedFunctionAnalysisResult(clonedF);
     clonedResults->setCalledFunctions(m_calledFunctions);
 
     // get clonned finalized info
-    InstrSet inputDeps;
-    InstrSet inputIndeps;
-    std::unordered_set<llvm::BasicBlock*> inputDepBlocks;
-    std::unordered_map<llvm::Instruction*, llvm::Instruction*> local_instr_map;
+    // clone has the layout of m_F, thus results are collected by ordinals, without mapping each instruction
+    FunctionCacheData::Bits inputDeps;
+    FunctionCacheData::Bits inputIndeps;
+    FunctionCacheData::Bits inputDepBlocks;
+    unsigned block_idx = 0;
+    unsigned instr_idx = 0;
     for (auto& B : *m_F) {
         auto analysisRes = getAnalysisResult(&B);
         // if analysisRes is null, consider input dependent
-        if (!analysisRes || analysisRes->isInputDependent(&B, inputDepArgs)) {
-            llvm::Value* block_val = get_mapped_value(&B, VMap);
-            if (!block_val) {
-                continue;
-            }
-            llvm::BasicBlock* mapped_block = llvm::dyn_cast<llvm::BasicBlock>(block_val);
-            if (!mapped_block) {
-                llvm::dbgs() << "Invalid mapping for block " << B.getName()
-                             << ". Mapped to value " << *block_val << ". Skip entire block.\n";
-                continue;
-            }
-            inputDepBlocks.insert(mapped_block);
+        // results loaded from summary are finalized for all callers, hence are safe for any subset of input dep arguments
+        bool is_input_dep_block = m_summary ? isInputDependentBlock(&B)
+                                            : (!analysisRes || analysisRes->isInputDependent(&B, inputDepArgs));
+        if (is_input_dep_block) {
+            FunctionCacheData::setBit(inputDepBlocks, block_idx);
             if (BasicBlocksUtils::get().isBlockUnreachable(&B)) {
-                BasicBlocksUtils::get().addUnreachableBlock(mapped_block);
+                llvm::Value* block_val = get_mapped_value(&B, VMap);
+                if (auto* mapped_block = llvm::dyn_cast_or_null<llvm::BasicBlock>(block_val)) {
+                    BasicBlocksUtils::get().addUnreachableBlock(mapped_block);
+                }
             }
         }
         for (auto& I : B) {
-            llvm::Instruction* mapped_instr = get_mapped_instruction(&I, local_instr_map, VMap);
-            if (!mapped_instr) {
-                continue;
-            }
-            if (!analysisRes || analysisRes->isInputDependent(&I, inputDepArgs)) {
-                inputDeps.insert(mapped_instr);
+            if (m_summary) {
+                if (isInputDependent(&I)) {
+                    FunctionCacheData::setBit(inputDeps, instr_idx);
+                } else if (isInputIndependent(&I)) {
+                    FunctionCacheData::setBit(inputIndeps, instr_idx);
+                }
+            } else if (!analysisRes || analysisRes->isInputDependent(&I, inputDepArgs)) {
+                FunctionCacheData::setBit(inputDeps, instr_idx);
             } else if (analysisRes && analysisRes->isInputIndependent(&I, inputDepArgs)) {
-                inputIndeps.insert(mapped_instr);
+                FunctionCacheData::setBit(inputIndeps, instr_idx);
             } else {
                 llvm::dbgs() << "No information for instruction " << I << "\n";
             }
+            ++instr_idx;
         }
+        ++block_idx;
     }
     clonedResults->setInputDependentBasicBlocks(std::move(inputDepBlocks));
     clonedResults->setInputDepInstrs(std::move(inputDeps));
     clonedResults->setInputIndepInstrs(std::move(inputIndeps));
 
     // clone call site information
+    std::unordered_map<llvm::Instruction*, llvm::Instruction*> local_instr_map;
     std::unordered_map<llvm::Function*, FunctionCallDepInfo> clonned_call_dep_info;
     for (auto& F : m_calledFunctions) {
         auto callDepInfo = getFunctionCallDepInfo(F);
@@ -690,6 +821,10 @@ FunctionAnaliser::Impl::cloneForArguments(const DependencyAnaliser::ArgumentDepe
 void FunctionAnaliser::Impl::dump() const
 {
     llvm::dbgs() << "****** Function " << m_F->getName() << " ******\\n";
+    if (m_summary) {
+        llvm::dbgs() << "Results are loaded from function summary\n";
+        return;
+    }
     for (auto& BB : *m_F) {
         auto pos = m_BBAnalysisResults.find(&BB);
         if (pos != m_BBAnalysisResults.end()) {
@@ -698,6 +833,273 @@ void FunctionAnaliser::Impl::dump() const
     }
 }
 
+void FunctionAnaliser::Impl::collectSummaryInterface(FunctionSummary& summary) const
+{
+    summary.name = m_F->getName().str();
+    summary.outArgDeps = FunctionSummary::toArgumentDepSummaries(m_outArgDependencies);
+    summary.returnDeps = FunctionSummary::toDepSummary(m_returnValueDependencies);
+    summary.referencedGlobals.clear();
+    for (const auto& global : getReferencedGlobals()) {
+        summary.referencedGlobals.push_back(global->getName().str());
+    }
+    std::sort(summary.referencedGlobals.begin(), summary.referencedGlobals.end());
+    summary.modifiedGlobals.clear();
+    for (const auto& global : getModifiedGlobals()) {
+        summary.modifiedGlobals.push_back(global->getName().str());
+    }
+    std::sort(summary.modifiedGlobals.begin(), summary.modifiedGlobals.end());
+
+    GlobalVariableDependencyMap exitGlobalDeps;
+    if (m_summary) {
+        exitGlobalDeps = m_summaryGlobalDeps;
+    } else {
+        auto exit_pos = m_BBAnalysisResults.find(m_exit_block);
+        if (exit_pos != m_BBAnalysisResults.end()) {
+            for (const auto& item : exit_pos->second->getValuesDependencies()) {
+                if (auto* global = llvm::dyn_cast<llvm::GlobalVariable>(item.first)) {
+                    exitGlobalDeps.insert(std::make_pair(global, item.second));
+                }
+            }
+        }
+        for (const auto& global : getModifiedGlobals()) {
+            if (exitGlobalDeps.find(global) == exitGlobalDeps.end() && hasGlobalVariableDepInfo(global)) {
+                exitGlobalDeps.insert(std::make_pair(global, getGlobalVariableDependencies(global)));
+            }
+        }
+    }
+    summary.exitGlobalDeps = FunctionSummary::toGlobalDepSummaries(exitGlobalDeps);
+    summary.computeInterfaceHash();
+}
+
+void FunctionAnaliser::Impl::collectSummaryResults(FunctionSummary& summary) const
+{
+    FunctionNumbering numbering(m_F);
+    summary.isInputDep = m_is_inputDep;
+    summary.inputDepInstructions.clear();
+    summary.inputIndepInstructions.clear();
+    summary.inputDepBlocks.clear();
+    for (auto& B : *m_F) {
+        if (isInputDependentBlock(&B)) {
+            summary.inputDepBlocks.push_back(numbering.getBlockIndex(&B));
+        }
+        for (auto& I : B) {
+            if (isInputDependent(&I)) {
+                summary.inputDepInstructions.push_back(numbering.getInstructionIndex(&I));
+            } else if (isInputIndependent(&I)) {
+                summary.inputIndepInstructions.push_back(numbering.getInstructionIndex(&I));
+            }
+        }
+    }
+    summary.callees.clear();
+    for (const auto& calledF : m_calledFunctions) {
+        auto& calleeSummary = summary.callees[calledF->getName().str()];
+        calleeSummary.callArgumentDeps = FunctionSummary::toArgumentDepSummaries(getCallArgumentInfo(calledF));
+        calleeSummary.callGlobalDeps = FunctionSummary::toGlobalDepSummaries(getCallGlobalsInfo(calledF));
+        auto callDepInfo = getFunctionCallDepInfo(calledF);
+        for (const auto& callSite : callDepInfo.getCallSites()) {
+            int index = numbering.getInstructionIndex(callSite);
+            if (index == -1) {
+                continue;
+            }
+            auto& callSiteSummary = calleeSummary.callSites[index];
+            callSiteSummary.argumentDeps = FunctionSummary::toArgumentDepSummaries(callDepInfo.getArgumentsDependencies(callSite));
+            callSiteSummary.globalDeps = FunctionSummary::toGlobalDepSummaries(callDepInfo.getGlobalsDependencies(callSite));
+        }
+    }
+}
+
+bool FunctionAnaliser::Impl::loadSummary(const std::shared_ptr<FunctionSummary>& summary)
+{
+    FunctionNumbering numbering(m_F);
+    llvm::Module* M = m_F->getParent();
+
+    ArgumentDependenciesMap outArgDeps;
+    ValueDepInfo returnDeps;
+    GlobalVariableDependencyMap globalDeps;
+    if (!FunctionSummary::fromArgumentDepSummaries(summary->outArgDeps, m_F, m_F, outArgDeps)
+        || !FunctionSummary::fromDepSummary(summary->returnDeps, m_F, m_F->getReturnType(), returnDeps)
+        || !FunctionSummary::fromGlobalDepSummaries(summary->exitGlobalDeps, m_F, globalDeps)) {
+        return false;
+    }
+    GlobalsSet referencedGlobals;
+    GlobalsSet modifiedGlobals;
+    for (const auto& name : summary->referencedGlobals) {
+        llvm::GlobalVariable* global = M->getNamedGlobal(name);
+        if (!global) {
+            return false;
+        }
+        referencedGlobals.insert(global);
+    }
+    for (const auto& name : summary->modifiedGlobals) {
+        llvm::GlobalVariable* global = M->getNamedGlobal(name);
+        if (!global) {
+            return false;
+        }
+        modifiedGlobals.insert(global);
+    }
+
+    FunctionSet calledFunctions;
+    FunctionArgumentsDependencies calledFunctionsInfo;
+    FunctionGlobalsDependencies calledFunctionGlobalsInfo;
+    std::unordered_map<llvm::Function*, FunctionCallDepInfo> callDepInfos;
+    for (const auto& callee : summary->callees) {
+        llvm::Function* calledF = M->getFunction(callee.first);
+        if (!calledF) {
+            return false;
+        }
+        calledFunctions.insert(calledF);
+        if (!FunctionSummary::fromArgumentDepSummaries(callee.second.callArgumentDeps, calledF, m_F,
+                                                       calledFunctionsInfo[calledF])
+            || !FunctionSummary::fromGlobalDepSummaries(callee.second.callGlobalDeps, m_F,
+                                                        calledFunctionGlobalsInfo[calledF])) {
+            return false;
+        }
+        FunctionCallDepInfo callDepInfo(*calledF);
+        for (const auto& callSite : callee.second.callSites) {
+            llvm::Instruction* callInstr = numbering.getInstruction(callSite.first);
+            if (!callInstr || (!llvm::isa<llvm::CallInst>(callInstr) && !llvm::isa<llvm::InvokeInst>(callInstr))) {
+                return false;
+            }
+            ArgumentDependenciesMap argDeps;
+            GlobalVariableDependencyMap callGlobalDeps;
+            if (!FunctionSummary::fromArgumentDepSummaries(callSite.second.argumentDeps, calledF, m_F, argDeps)
+                || !FunctionSummary::fromGlobalDepSummaries(callSite.second.globalDeps, m_F, callGlobalDeps)) {
+                return false;
+            }
+            callDepInfo.addCall(callInstr, argDeps);
+            callDepInfo.addCall(callInstr, callGlobalDeps);
+        }
+        callDepInfos.insert(std::make_pair(calledF, callDepInfo));
+    }
+
+    InstrSet inputDepInstrs;
+    InstrSet inputIndepInstrs;
+    std::unordered_set<llvm::BasicBlock*> inputDepBlocks;
+    for (const auto& index : summary->inputDepInstructions) {
+        llvm::Instruction* I = numbering.getInstruction(index);
+        if (!I) {
+            return false;
+        }
+        inputDepInstrs.insert(I);
+    }
+    for (const auto& index : summary->inputIndepInstructions) {
+        llvm::Instruction* I = numbering.getInstruction(index);
+        if (!I) {
+            return false;
+        }
+        inputIndepInstrs.insert(I);
+    }
+    for (const auto& index : summary->inputDepBlocks) {
+        llvm::BasicBlock* B = numbering.getBlock(index);
+        if (!B) {
+            return false;
+        }
+        inputDepBlocks.insert(B);
+    }
+
+    reset();
+    m_summary = summary;
+    m_outArgDependencies = std::move(outArgDeps);
+    m_returnValueDependencies = std::move(returnDeps);
+    m_summaryGlobalDeps = std::move(globalDeps);
+    m_referencedGlobals = std::move(referencedGlobals);
+    m_modifiedGlobals = std::move(modifiedGlobals);
+    m_calledFunctions = std::move(calledFunctions);
+    m_calledFunctionsInfo = std::move(calledFunctionsInfo);
+    m_calledFunctionGlobalsInfo = std::move(calledFunctionGlobalsInfo);
+    m_summaryCallDepInfos = std::move(callDepInfos);
+    m_summaryInputDepInstrs = std::move(inputDepInstrs);
+    m_summaryInputIndepInstrs = std::move(inputIndepInstrs);
+    m_summaryInputDepBlocks = std::move(inputDepBlocks);
+    m_globalsUpdated = true;
+    m_argumentsFinalized = true;
+    m_globalsFinalized = true;
+    return true;
+}
+
+long unsigned FunctionAnaliser::Impl::get_memory_usage() const
+{
+    long unsigned bytes = sizeof(Impl)
+                        + MemoryUsage::heapOf(m_inputs)
+                        + MemoryUsage::heapOf(m_valueDependencies)
+                        + MemoryUsage::heapOf(m_outArgDependencies)
+                        + MemoryUsage::heapOf(m_returnValueDependencies)
+                        + MemoryUsage::heapOf(m_calledFunctionsInfo)
+                        + MemoryUsage::heapOf(m_calledFunctionGlobalsInfo)
+                        + MemoryUsage::heapOf(m_calledFunctions)
+                        + MemoryUsage::heapOf(m_referencedGlobals)
+                        + MemoryUsage::heapOf(m_modifiedGlobals)
+                        + MemoryUsage::heapOf(m_BBAnalysisResults)
+                        + MemoryUsage::heapOf(m_loopBlocks)
+                        + MemoryUsage::heapOf(m_summaryInputDepInstrs)
+                        + MemoryUsage::heapOf(m_summaryInputIndepInstrs)
+                        + MemoryUsage::heapOf(m_summaryInputDepBlocks)
+                        + MemoryUsage::heapOf(m_summaryGlobalDeps)
+                        + MemoryUsage::heapOf(m_summaryCallDepInfos);
+    for (const auto& item : m_BBAnalysisResults) {
+        bytes += item.second->get_memory_usage();
+    }
+    return bytes;
+}
+
+void FunctionAnaliser::Impl::reset()
+{
+    m_inputs.clear();
+    m_valueDependencies.clear();
+    m_outArgDependencies.clear();
+    m_returnValueDependencies = ValueDepInfo(m_F->getReturnType());
+    m_calledFunctionsInfo.clear();
+    m_calledFunctionGlobalsInfo.clear();
+    m_calledFunctions.clear();
+    m_referencedGlobals.clear();
+    m_modifiedGlobals.clear();
+    m_argumentsFinalized = false;
+    m_globalsFinalized = false;
+    m_globalsUpdated = false;
+    m_BBAnalysisResults.clear();
+    m_loopBlocks.clear();
+    m_exit_block = nullptr;
+    m_summary.reset();
+    m_summaryInputDepInstrs.clear();
+    m_summaryInputIndepInstrs.clear();
+    m_summaryInputDepBlocks.clear();
+    m_summaryGlobalDeps.clear();
+    m_summaryCallDepInfos.clear();
+    m_blocksMemoryUsage = 0;
+    m_loopsMemoryUsage = 0;
+    m_peakMemoryUsage = 0;
+}
+
+bool FunctionAnaliser::Impl::changeSummaryFunctionCall(llvm::Instruction* callInstr, llvm::Function* oldF, llvm::Function* newF)
+{
+    auto pos = m_summaryCallDepInfos.find(oldF);
+    if (pos == m_summaryCallDepInfos.end()) {
+        return false;
+    }
+    if (auto call = llvm::dyn_cast<llvm::CallInst>(callInstr)) {
+        call->setCalledFunction(newF);
+    } else if (auto invoke = llvm::dyn_cast<llvm::InvokeInst>(callInstr)) {
+        invoke->setCalledFunction(newF);
+    } else {
+        assert(false);
+    }
+    auto& callDepInfo = pos->second;
+    FunctionCallDepInfo newCallDepInfo(*newF);
+    newCallDepInfo.addCall(callInstr, callDepInfo.getArgumentsDependencies(callInstr));
+    newCallDepInfo.addCall(callInstr, callDepInfo.getGlobalsDependencies(callInstr));
+    auto insert_res = m_summaryCallDepInfos.insert(std::make_pair(newF, newCallDepInfo));
+    if (!insert_res.second) {
+        insert_res.first->second.addDepInfo(newCallDepInfo);
+    }
+    callDepInfo.removeCall(callInstr);
+    m_calledFunctions.insert(newF);
+    if (callDepInfo.empty()) {
+        m_summaryCallDepInfos.erase(pos);
+        m_calledFunctions.erase(oldF);
+    }
+    return true;
+}
+
 void FunctionAnaliser::Impl::collectArguments()
 {
     auto& arguments = m_F->getArgumentList();
@@ -966,6 +1368,7 @@ void FunctionAnaliser::Impl::updateModifiedGlobals()
 DependencyAnaliser::ValueDependencies
 FunctionAnaliser::Impl::getBasicBlockPredecessorsDependencies(llvm::BasicBlock* B)
 {
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::PREDECESSOR_MERGE, m_F);
     DependencyAnaliser::ValueDependencies deps;
     auto pred = pred_begin(B);
     while (pred != pred_end(B)) {
@@ -981,6 +1384,7 @@ FunctionAnaliser::Impl::getBasicBlockPredecessorsDependencies(llvm::BasicBlock*
         }
         assert(pos != m_BBAnalysisResults.end());
         const auto& valueDeps = pos->second->getValuesDependencies();
+        AnalysisProfiler::get().count(AnalysisProfiler::MERGES);
         for (auto& dep : valueDeps) {
             auto res = deps.insert(dep);
             if (!res.second) {
@@ -1063,6 +1467,9 @@ FunctionAnaliser::Impl::getBasicBlockPredecessorsCallbackFunctions(llvm::BasicBl
 FunctionAnaliser::Impl::DependencyAnalysisResultT FunctionAnaliser::Impl::getAnalysisResult(llvm::BasicBlock* bb) const
 {
     assert(bb->getParent() == m_F);
+    if (m_summary) {
+        return nullptr;
+    }
     auto pos = m_BBAnalysisResults.find(bb);
     if (pos != m_BBAnalysisResults.end()) {
         return pos->second;
@@ -1078,7 +1485,6 @@ FunctionAnaliser::Impl::DependencyAnalysisResultT FunctionAnaliser::Impl::getAna
     }
     pos = m_BBAnalysisResults.find(bb);
     if (pos == m_BBAnalysisResults.end()) {
-        const auto& bb_node = (*m_postDomTree)[bb];
         // TODO: commented so that the log is not a mess. uncomment later
         //llvm::dbgs() << "No analysis result for " << bb->getName() << " in function " << m_F->getName() << "\n";
         //if (!m_postDomTree.isReachableFromEntry(bb_node)) {
@@ -1283,10 +1689,63 @@ long unsigned FunctionAnaliser::get_input_unknowns_count() const
     return m_analiser->get_input_unknowns_count();
 }
 
+long unsigned FunctionAnaliser::get_memory_usage() const
+{
+    return m_analiser->get_memory_usage();
+}
+
+long unsigned FunctionAnaliser::get_blocks_memory_usage() const
+{
+    return m_analiser->get_blocks_memory_usage();
+}
+
+long unsigned FunctionAnaliser::get_loops_memory_usage() const
+{
+    return m_analiser->get_loops_memory_usage();
+}
+
+long unsigned FunctionAnaliser::get_peak_memory_usage() const
+{
+    return m_analiser->get_peak_memory_usage();
+}
+
 FunctionInputDependencyResultInterface*
 FunctionAnaliser::cloneForArguments(const DependencyAnaliser::ArgumentDependenciesMap& inputDepArgs)
 {
-    m_analiser->cloneForArguments(inputDepArgs);
+    return m_analiser->cloneForArguments(inputDepArgs);
+}
+
+FunctionInputDependencyResultInterface*
+FunctionAnaliser::cloneForArguments(const DependencyAnaliser::ArgumentDependenciesMap& inputDepArgs,
+                                    llvm::Function* clonedF,
+                                    const llvm::ValueToValueMapTy& VMap)
+{
+    return m_analiser->cloneForArguments(inputDepArgs, clonedF, VMap);
+}
+
+void FunctionAnaliser::collectSummaryInterface(FunctionSummary& summary) const
+{
+    m_analiser->collectSummaryInterface(summary);
+}
+
+void FunctionAnaliser::collectSummaryResults(FunctionSummary& summary) const
+{
+    m_analiser->collectSummaryResults(summary);
+}
+
+bool FunctionAnaliser::loadSummary(const std::shared_ptr<FunctionSummary>& summary)
+{
+    return m_analiser->loadSummary(summary);
+}
+
+bool FunctionAnaliser::isLoadedFromSummary() const
+{
+    return m_analiser->isLoadedFromSummary();
+}
+
+void FunctionAnaliser::reset()
+{
+    m_analiser->reset();
 }
 
 void FunctionAnaliser::dump() const
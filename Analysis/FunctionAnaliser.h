@@ -3,6 +3,8 @@
 #include "FunctionInputDependencyResultInterface.h"
 #include "DependencyAnaliser.h"
 
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
 #include <memory>
 
 namespace llvm {
@@ -14,6 +16,7 @@ class DominatorTree;
 
 namespace input_dependency {
 
+class FunctionSummary;
 class IndirectCallSitesAnalysisResult;
 class VirtualCallSiteAnalysisResult;
 
@@ -116,6 +119,40 @@ public:
     /// \}
 
     FunctionInputDependencyResultInterface* cloneForArguments(const DependencyAnaliser::ArgumentDependenciesMap& inputDepArgs);
+    /// Projects results for \p inputDepArgs onto \p clonedF, an unmodified clone of the function made with \p VMap.
+    FunctionInputDependencyResultInterface* cloneForArguments(const DependencyAnaliser::ArgumentDependenciesMap& inputDepArgs,
+                                                              llvm::Function* clonedF,
+                                                              const llvm::ValueToValueMapTy& VMap);
+
+    /// \name Memory accounting. Sizes are estimated from result containers, \see MemoryUsage
+    /// Blocks, loops and peak usage are collected only when statistics are requested.
+    /// \{
+    long unsigned get_memory_usage() const;
+    /// Bytes held by results of blocks outside of loops, measured right after analysis.
+    long unsigned get_blocks_memory_usage() const;
+    /// Bytes held by results of top level loops, measured right after analysis.
+    long unsigned get_loops_memory_usage() const;
+    /// Largest usage seen during analysis and finalization, including transient predecessor dependencies.
+    long unsigned get_peak_memory_usage() const;
+    /// \}
+
+    /// \name Function summaries interface
+    /// \{
+    /// Collects results of context insensitive analysis. Should be called right after \link analyze.
+    void collectSummaryInterface(FunctionSummary& summary) const;
+    /// Collects finalized results.
+    void collectSummaryResults(FunctionSummary& summary) const;
+    /**
+     * \brief Takes results from the given summary instead of running the analysis.
+     * Results loaded from summary are final, \link finalizeArguments and \link finalizeGlobals should not be called.
+     * \return false if summary does not match the function, e.g. refers to missing globals.
+     */
+    bool loadSummary(const std::shared_ptr<FunctionSummary>& summary);
+    bool isLoadedFromSummary() const;
+    /// Drops all results. \link analyze should be called to run analysis again.
+    void reset();
+    /// \}
+
     /// \name debug interface
     /// \{
     void dump() const;
@@ -0,0 +1,324 @@
+#include "FunctionCacheData.h"
+
+#include "BasicBlocksUtils.h"
+#include "FunctionInputDependencyResultInterface.h"
+#include "FunctionNumbering.h"
+#include "Utils.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Type.h"
+
+#include <algorithm>
+
+namespace input_dependency {
+
+namespace {
+
+// positions of fields in metadata tuple
+enum CacheTupleField {
+    VERSION = 0,
+    HASH,
+    INPUT_DEP,
+    EXTRACTED,
+    INSTRUCTIONS_COUNT,
+    BLOCKS_COUNT,
+    INPUT_DEP_BLOCKS,
+    UNREACHABLE_BLOCKS,
+    INPUT_DEP_INSTRS,
+    INPUT_INDEP_INSTRS,
+    CALL_SITES,
+    FIELDS_COUNT
+};
+
+// positions of fields in call site tuple
+enum CallSiteTupleField {
+    CALL_SITE_INSTR = 0,
+    CALL_SITE_ARGS_COUNT,
+    CALL_SITE_INPUT_DEP_ARGS,
+    CALL_SITE_INPUT_DEP_GLOBALS,
+    CALL_SITE_INPUT_INDEP_GLOBALS,
+    CALL_SITE_FIELDS_COUNT
+};
+
+llvm::Metadata* get_int_metadata(llvm::LLVMContext& Ctx, uint64_t value)
+{
+    return llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(llvm::Type::getInt64Ty(Ctx), value));
+}
+
+bool get_int_value(const llvm::MDOperand& op, uint64_t& value)
+{
+    auto* constAsMd = llvm::dyn_cast_or_null<llvm::ConstantAsMetadata>(op.get());
+    if (!constAsMd) {
+        return false;
+    }
+    auto* constInt = llvm::dyn_cast<llvm::ConstantInt>(constAsMd->getValue());
+    if (!constInt) {
+        return false;
+    }
+    value = constInt->getZExtValue();
+    return true;
+}
+
+llvm::MDNode* get_bits_metadata(llvm::LLVMContext& Ctx, const FunctionCacheData::Bits& bits)
+{
+    std::vector<llvm::Metadata*> words;
+    words.reserve(bits.size());
+    for (const auto& word : bits) {
+        words.push_back(get_int_metadata(Ctx, word));
+    }
+    return llvm::MDTuple::get(Ctx, words);
+}
+
+bool get_bits(const llvm::MDOperand& op, unsigned size, FunctionCacheData::Bits& bits)
+{
+    auto* node = llvm::dyn_cast_or_null<llvm::MDNode>(op.get());
+    // vector may be shorter than size, if last bits are not set
+    if (!node || node->getNumOperands() > (size + 63) / 64) {
+        return false;
+    }
+    bits.resize(node->getNumOperands());
+    for (unsigned i = 0; i < node->getNumOperands(); ++i) {
+        if (!get_int_value(node->getOperand(i), bits[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+llvm::MDNode* get_names_metadata(llvm::LLVMContext& Ctx, const std::vector<std::string>& names)
+{
+    std::vector<llvm::Metadata*> strings;
+    strings.reserve(names.size());
+    for (const auto& name : names) {
+        strings.push_back(llvm::MDString::get(Ctx, name));
+    }
+    return llvm::MDTuple::get(Ctx, strings);
+}
+
+bool get_names(const llvm::MDOperand& op, std::vector<std::string>& names)
+{
+    auto* node = llvm::dyn_cast_or_null<llvm::MDNode>(op.get());
+    if (!node) {
+        return false;
+    }
+    names.clear();
+    for (unsigned i = 0; i < node->getNumOperands(); ++i) {
+        auto* name = llvm::dyn_cast_or_null<llvm::MDString>(node->getOperand(i).get());
+        if (!name) {
+            return false;
+        }
+        names.push_back(name->getString().str());
+    }
+    return true;
+}
+
+llvm::MDNode* get_call_sites_metadata(llvm::LLVMContext& Ctx, const std::vector<FunctionCacheData::CallSiteData>& callSites)
+{
+    std::vector<llvm::Metadata*> nodes;
+    nodes.reserve(callSites.size());
+    for (const auto& callSite : callSites) {
+        std::vector<llvm::Metadata*> fields(CALL_SITE_FIELDS_COUNT);
+        fields[CALL_SITE_INSTR] = get_int_metadata(Ctx, callSite.instrIndex);
+        fields[CALL_SITE_ARGS_COUNT] = get_int_metadata(Ctx, callSite.argsCount);
+        fields[CALL_SITE_INPUT_DEP_ARGS] = get_bits_metadata(Ctx, callSite.inputDepArgs);
+        fields[CALL_SITE_INPUT_DEP_GLOBALS] = get_names_metadata(Ctx, callSite.inputDepGlobals);
+        fields[CALL_SITE_INPUT_INDEP_GLOBALS] = get_names_metadata(Ctx, callSite.inputIndepGlobals);
+        nodes.push_back(llvm::MDTuple::get(Ctx, fields));
+    }
+    return llvm::MDTuple::get(Ctx, nodes);
+}
+
+bool get_call_sites(const llvm::MDOperand& op, unsigned instructions_count,
+                    std::vector<FunctionCacheData::CallSiteData>& callSites)
+{
+    auto* node = llvm::dyn_cast_or_null<llvm::MDNode>(op.get());
+    if (!node) {
+        return false;
+    }
+    callSites.resize(node->getNumOperands());
+    for (unsigned i = 0; i < node->getNumOperands(); ++i) {
+        auto* callSiteNode = llvm::dyn_cast_or_null<llvm::MDNode>(node->getOperand(i).get());
+        if (!callSiteNode || callSiteNode->getNumOperands() != CALL_SITE_FIELDS_COUNT) {
+            return false;
+        }
+        auto& callSite = callSites[i];
+        uint64_t value = 0;
+        if (!get_int_value(callSiteNode->getOperand(CALL_SITE_INSTR), value) || value >= instructions_count) {
+            return false;
+        }
+        callSite.instrIndex = value;
+        if (!get_int_value(callSiteNode->getOperand(CALL_SITE_ARGS_COUNT), value)) {
+            return false;
+        }
+        callSite.argsCount = value;
+        if (!get_bits(callSiteNode->getOperand(CALL_SITE_INPUT_DEP_ARGS), callSite.argsCount, callSite.inputDepArgs)
+                || !get_names(callSiteNode->getOperand(CALL_SITE_INPUT_DEP_GLOBALS), callSite.inputDepGlobals)
+                || !get_names(callSiteNode->getOperand(CALL_SITE_INPUT_INDEP_GLOBALS), callSite.inputIndepGlobals)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+FunctionCacheData FunctionCacheData::collect(llvm::Function* F, const FunctionInputDependencyResultInterface& FA)
+{
+    FunctionCacheData data;
+    data.hash = Utils::getFunctionHash(F);
+    data.isInputDep = FA.isInputDepFunction();
+    data.isExtracted = FA.isExtractedFunction();
+    unsigned block_idx = 0;
+    unsigned instr_idx = 0;
+    for (auto& B : *F) {
+        if (FA.isInputDependentBlock(&B)) {
+            setBit(data.inputDepBlocks, block_idx);
+        } else if (BasicBlocksUtils::get().isBlockUnreachable(&B)) {
+            setBit(data.unreachableBlocks, block_idx);
+        } else {
+            unsigned idx = instr_idx;
+            for (auto& I : B) {
+                if (FA.isInputDependent(&I)) {
+                    setBit(data.inputDepInstrs, idx);
+                } else if (FA.isInputIndependent(&I)) {
+                    setBit(data.inputIndepInstrs, idx);
+                }
+                ++idx;
+            }
+        }
+        instr_idx += B.size();
+        ++block_idx;
+    }
+    data.instructionsCount = instr_idx;
+    data.blocksCount = block_idx;
+
+    // arguments and globals without input independent dependency info are considered input dependent
+    FunctionNumbering numbering(F);
+    for (const auto& callee : FA.getCallSitesData()) {
+        const auto& callDepInfo = FA.getFunctionCallDepInfo(callee);
+        const auto& callGlobalsDeps = callDepInfo.getCallsGlobalsDependencies();
+        for (const auto& callsite_entry : callDepInfo.getCallsArgumentDependencies()) {
+            auto* callInstr = const_cast<llvm::Instruction*>(callsite_entry.first);
+            int index = numbering.getInstructionIndex(callInstr);
+            if (index == -1 || getCalledFunction(callInstr) != callee) {
+                continue;
+            }
+            CallSiteData callSite;
+            callSite.instrIndex = index;
+            callSite.argsCount = callee->arg_size();
+            unsigned argNo = 0;
+            for (auto& arg : callee->getArgumentList()) {
+                auto arg_pos = callsite_entry.second.find(&arg);
+                if (arg_pos == callsite_entry.second.end() || !arg_pos->second.isInputIndep()) {
+                    setBit(callSite.inputDepArgs, argNo);
+                }
+                ++argNo;
+            }
+            auto globals_pos = callGlobalsDeps.find(callInstr);
+            if (globals_pos != callGlobalsDeps.end()) {
+                for (const auto& global_entry : globals_pos->second) {
+                    auto& globals = global_entry.second.isInputIndep() ? callSite.inputIndepGlobals
+                                                                        : callSite.inputDepGlobals;
+                    globals.push_back(global_entry.first->getName().str());
+                }
+                std::sort(callSite.inputDepGlobals.begin(), callSite.inputDepGlobals.end());
+                std::sort(callSite.inputIndepGlobals.begin(), callSite.inputIndepGlobals.end());
+            }
+            data.callSites.push_back(std::move(callSite));
+        }
+    }
+    std::sort(data.callSites.begin(), data.callSites.end(),
+              [] (const CallSiteData& site1, const CallSiteData& site2) { return site1.instrIndex < site2.instrIndex; });
+    return data;
+}
+
+llvm::MDNode* FunctionCacheData::toMetadata(llvm::LLVMContext& Ctx) const
+{
+    std::vector<llvm::Metadata*> fields(FIELDS_COUNT);
+    fields[VERSION] = get_int_metadata(Ctx, version);
+    fields[HASH] = get_int_metadata(Ctx, hash);
+    fields[INPUT_DEP] = get_int_metadata(Ctx, isInputDep);
+    fields[EXTRACTED] = get_int_metadata(Ctx, isExtracted);
+    fields[INSTRUCTIONS_COUNT] = get_int_metadata(Ctx, instructionsCount);
+    fields[BLOCKS_COUNT] = get_int_metadata(Ctx, blocksCount);
+    fields[INPUT_DEP_BLOCKS] = get_bits_metadata(Ctx, inputDepBlocks);
+    fields[UNREACHABLE_BLOCKS] = get_bits_metadata(Ctx, unreachableBlocks);
+    fields[INPUT_DEP_INSTRS] = get_bits_metadata(Ctx, inputDepInstrs);
+    fields[INPUT_INDEP_INSTRS] = get_bits_metadata(Ctx, inputIndepInstrs);
+    fields[CALL_SITES] = get_call_sites_metadata(Ctx, callSites);
+    return llvm::MDTuple::get(Ctx, fields);
+}
+
+bool FunctionCacheData::fromMetadata(const llvm::MDNode* node, FunctionCacheData& data)
+{
+    if (!node || node->getNumOperands() != FIELDS_COUNT) {
+        return false;
+    }
+    uint64_t value = 0;
+    if (!get_int_value(node->getOperand(VERSION), value) || value != version) {
+        return false;
+    }
+    if (!get_int_value(node->getOperand(HASH), data.hash)) {
+        return false;
+    }
+    if (!get_int_value(node->getOperand(INPUT_DEP), value)) {
+        return false;
+    }
+    data.isInputDep = value;
+    if (!get_int_value(node->getOperand(EXTRACTED), value)) {
+        return false;
+    }
+    data.isExtracted = value;
+    if (!get_int_value(node->getOperand(INSTRUCTIONS_COUNT), value)) {
+        return false;
+    }
+    data.instructionsCount = value;
+    if (!get_int_value(node->getOperand(BLOCKS_COUNT), value)) {
+        return false;
+    }
+    data.blocksCount = value;
+    return get_bits(node->getOperand(INPUT_DEP_BLOCKS), data.blocksCount, data.inputDepBlocks)
+        && get_bits(node->getOperand(UNREACHABLE_BLOCKS), data.blocksCount, data.unreachableBlocks)
+        && get_bits(node->getOperand(INPUT_DEP_INSTRS), data.instructionsCount, data.inputDepInstrs)
+        && get_bits(node->getOperand(INPUT_INDEP_INSTRS), data.instructionsCount, data.inputIndepInstrs)
+        && get_call_sites(node->getOperand(CALL_SITES), data.instructionsCount, data.callSites);
+}
+
+bool FunctionCacheData::isValidFor(llvm::Function* F) const
+{
+    return hash == Utils::getFunctionHash(F);
+}
+
+void FunctionCacheData::setBit(Bits& bits, unsigned index)
+{
+    if (bits.size() <= index / 64) {
+        bits.resize(index / 64 + 1, 0);
+    }
+    bits[index / 64] |= (uint64_t(1) << (index % 64));
+}
+
+bool FunctionCacheData::testBit(const Bits& bits, unsigned index)
+{
+    if (bits.size() <= index / 64) {
+        return false;
+    }
+    return bits[index / 64] & (uint64_t(1) << (index % 64));
+}
+
+llvm::Function* FunctionCacheData::getCalledFunction(llvm::Instruction* instr)
+{
+    if (auto* callInst = llvm::dyn_cast<llvm::CallInst>(instr)) {
+        return callInst->getCalledFunction();
+    } else if (auto* invokeInst = llvm::dyn_cast<llvm::InvokeInst>(instr)) {
+        return invokeInst->getCalledFunction();
+    }
+    return nullptr;
+}
+
+} // namespace input_dependency
+
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Function;
+class Instruction;
+class LLVMContext;
+class MDNode;
+}
+
+namespace input_dependency {
+
+class FunctionInputDependencyResultInterface;
+
+/**
+ * \class FunctionCacheData
+ * \brief Compact form of cached input dependency results of a function.
+ * Results are kept as packed bit vectors over block and instruction ordinals (\see FunctionNumbering),
+ * and are stored as a single metadata tuple attached to the function.
+ * Instructions of input dependent and unreachable blocks have no bits set, as they all share the block's state.
+ */
+class FunctionCacheData
+{
+public:
+    using Bits = std::vector<uint64_t>;
+
+    /// Argument and globals dependencies of a direct call site. Callee is the function called by the instruction.
+    struct CallSiteData
+    {
+        unsigned instrIndex = 0;
+        unsigned argsCount = 0;
+        // bits are set for input dependent arguments
+        Bits inputDepArgs;
+        // names of globals callee refers to
+        std::vector<std::string> inputDepGlobals;
+        std::vector<std::string> inputIndepGlobals;
+    };
+
+    // increase whenever layout of the tuple changes
+    static const unsigned version = 2;
+
+public:
+    // IR hash of the function results were collected for. \see Utils::getFunctionHash
+    uint64_t hash = 0;
+    bool isInputDep = false;
+    bool isExtracted = false;
+    unsigned instructionsCount = 0;
+    unsigned blocksCount = 0;
+    Bits inputDepBlocks;
+    Bits unreachableBlocks;
+    Bits inputDepInstrs;
+    Bits inputIndepInstrs;
+    std::vector<CallSiteData> callSites;
+
+public:
+    static FunctionCacheData collect(llvm::Function* F, const FunctionInputDependencyResultInterface& FA);
+
+    llvm::MDNode* toMetadata(llvm::LLVMContext& Ctx) const;
+    /// Returns false if node is malformed or is written with different version.
+    static bool fromMetadata(const llvm::MDNode* node, FunctionCacheData& data);
+    /// Returns true if data has been collected for the given function and the function did not change since.
+    bool isValidFor(llvm::Function* F) const;
+
+    static void setBit(Bits& bits, unsigned index);
+    static bool testBit(const Bits& bits, unsigned index);
+    /// Returns function called directly by the given call or invoke instruction.
+    static llvm::Function* getCalledFunction(llvm::Instruction* instr);
+}; // class FunctionCacheData
+
+} // namespace input_dependency
+
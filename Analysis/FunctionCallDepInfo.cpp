@@ -1,4 +1,5 @@
 #include "Utils.h"
+#include "MemoryUsage.h"
 
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalVariable.h"
@@ -370,6 +371,14 @@ FunctionCallDepInfo::GlobalVariableDependencyMap& FunctionCallDepInfo::getGlobal
     return pos->second;
 }
 
+long unsigned FunctionCallDepInfo::get_memory_usage() const
+{
+    return sizeof(FunctionCallDepInfo)
+        + MemoryUsage::heapOf(m_callsArgumentsDeps)
+        + MemoryUsage::heapOf(m_callsGlobalsDeps)
+        + MemoryUsage::heapOf(m_callSites);
+}
+
 template<class Key>
 void FunctionCallDepInfo::markAllInputDependent(std::unordered_map<Key, ValueDepInfo>& argDeps)
 {
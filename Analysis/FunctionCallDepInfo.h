@@ -79,6 +79,9 @@ public:
 
     void markAllInputDependent();
 
+    /// Estimated bytes held by this object. \see MemoryUsage
+    long unsigned get_memory_usage() const;
+
 private:
     bool isValidInstruction(const llvm::Instruction* instr) const;
     void addCallSiteArguments(const llvm::Instruction* instr, const ArgumentDependenciesMap& argDeps);
@@ -0,0 +1,76 @@
+#include "FunctionNumbering.h"
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+
+namespace input_dependency {
+
+FunctionNumbering::FunctionNumbering(llvm::Function* F)
+{
+    for (auto& B : *F) {
+        m_blockIndices[&B] = m_blocks.size();
+        m_blocks.push_back(&B);
+        for (auto& I : B) {
+            m_instructionIndices[&I] = m_instructions.size();
+            m_instructions.push_back(&I);
+        }
+    }
+}
+
+int FunctionNumbering::getInstructionIndex(const llvm::Instruction* I) const
+{
+    auto pos = m_instructionIndices.find(I);
+    if (pos == m_instructionIndices.end()) {
+        return -1;
+    }
+    return pos->second;
+}
+
+int FunctionNumbering::getBlockIndex(const llvm::BasicBlock* B) const
+{
+    auto pos = m_blockIndices.find(B);
+    if (pos == m_blockIndices.end()) {
+        return -1;
+    }
+    return pos->second;
+}
+
+llvm::Instruction* FunctionNumbering::getInstruction(unsigned index) const
+{
+    if (index >= m_instructions.size()) {
+        return nullptr;
+    }
+    return m_instructions[index];
+}
+
+llvm::BasicBlock* FunctionNumbering::getBlock(unsigned index) const
+{
+    if (index >= m_blocks.size()) {
+        return nullptr;
+    }
+    return m_blocks[index];
+}
+
+void FunctionNumbering::forgetInstruction(const llvm::Instruction* I)
+{
+    auto pos = m_instructionIndices.find(I);
+    if (pos == m_instructionIndices.end()) {
+        return;
+    }
+    m_instructions[pos->second] = nullptr;
+    m_instructionIndices.erase(pos);
+}
+
+void FunctionNumbering::forgetBlock(const llvm::BasicBlock* B)
+{
+    auto pos = m_blockIndices.find(B);
+    if (pos == m_blockIndices.end()) {
+        return;
+    }
+    m_blocks[pos->second] = nullptr;
+    m_blockIndices.erase(pos);
+}
+
+} // namespace input_dependency
+
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+namespace llvm {
+class BasicBlock;
+class Function;
+class Instruction;
+}
+
+namespace input_dependency {
+
+/**
+ * \class FunctionNumbering
+ * \brief Assigns stable ordinals to blocks and instructions of a function, in layout order.
+ * Ordinals do not depend on value names or pointers, thus can be used to persist per-instruction data.
+ */
+class FunctionNumbering
+{
+public:
+    explicit FunctionNumbering(llvm::Function* F);
+
+public:
+    unsigned getInstructionsCount() const
+    {
+        return m_instructions.size();
+    }
+
+    unsigned getBlocksCount() const
+    {
+        return m_blocks.size();
+    }
+
+    /// Returns -1 if instruction does not belong to numbered function
+    int getInstructionIndex(const llvm::Instruction* I) const;
+    int getBlockIndex(const llvm::BasicBlock* B) const;
+    llvm::Instruction* getInstruction(unsigned index) const;
+    llvm::BasicBlock* getBlock(unsigned index) const;
+
+    /// Drops ordinal of instruction \p I, which is about to be, or has been, erased.
+    /// Instructions created later at the same address then have no ordinal. Other ordinals do not change.
+    void forgetInstruction(const llvm::Instruction* I);
+    /// Drops ordinal of block \p B, \see forgetInstruction.
+    void forgetBlock(const llvm::BasicBlock* B);
+
+private:
+    std::vector<llvm::Instruction*> m_instructions;
+    std::vector<llvm::BasicBlock*> m_blocks;
+    std::unordered_map<const llvm::Instruction*, unsigned> m_instructionIndices;
+    std::unordered_map<const llvm::BasicBlock*, unsigned> m_blockIndices;
+};
+
+} // namespace input_dependency
+
@@ -0,0 +1,208 @@
+#include "FunctionSummary.h"
+
+#include "Utils.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Module.h"
+
+#include <algorithm>
+
+namespace input_dependency {
+
+namespace {
+
+uint64_t hash_dep_summary(uint64_t hash, const FunctionSummary::DepSummary& summary)
+{
+    hash = Utils::hashCombine(hash, summary.dependency);
+    hash = Utils::hashCombine(hash, summary.arguments.size());
+    for (const auto& arg : summary.arguments) {
+        hash = Utils::hashCombine(hash, arg);
+    }
+    hash = Utils::hashCombine(hash, summary.globals.size());
+    for (const auto& global : summary.globals) {
+        hash = Utils::hashString(global, hash);
+    }
+    hash = Utils::hashCombine(hash, summary.elements.size());
+    for (const auto& element : summary.elements) {
+        hash = hash_dep_summary(hash, element);
+    }
+    return hash;
+}
+
+template <class Key>
+uint64_t hash_dep_summaries(uint64_t hash, const std::map<Key, FunctionSummary::DepSummary>& summaries);
+
+template <>
+uint64_t hash_dep_summaries(uint64_t hash, const FunctionSummary::ArgumentDepSummaries& summaries)
+{
+    hash = Utils::hashCombine(hash, summaries.size());
+    for (const auto& item : summaries) {
+        hash = Utils::hashCombine(hash, item.first);
+        hash = hash_dep_summary(hash, item.second);
+    }
+    return hash;
+}
+
+template <>
+uint64_t hash_dep_summaries(uint64_t hash, const FunctionSummary::GlobalDepSummaries& summaries)
+{
+    hash = Utils::hashCombine(hash, summaries.size());
+    for (const auto& item : summaries) {
+        hash = Utils::hashString(item.first, hash);
+        hash = hash_dep_summary(hash, item.second);
+    }
+    return hash;
+}
+
+uint64_t hash_names(uint64_t hash, const std::vector<std::string>& names)
+{
+    hash = Utils::hashCombine(hash, names.size());
+    for (const auto& name : names) {
+        hash = Utils::hashString(name, hash);
+    }
+    return hash;
+}
+
+}
+
+void FunctionSummary::computeInterfaceHash()
+{
+    uint64_t hash = Utils::hashString(name);
+    hash = hash_dep_summaries(hash, outArgDeps);
+    hash = hash_dep_summary(hash, returnDeps);
+    hash = hash_names(hash, referencedGlobals);
+    hash = hash_names(hash, modifiedGlobals);
+    hash = hash_dep_summaries(hash, exitGlobalDeps);
+    interfaceHash = hash;
+}
+
+FunctionSummary::DepSummary FunctionSummary::toDepSummary(const ValueDepInfo& depInfo)
+{
+    DepSummary summary;
+    summary.dependency = depInfo.getDependency();
+    for (const auto& arg : depInfo.getArgumentDependencies()) {
+        summary.arguments.push_back(arg->getArgNo());
+    }
+    std::sort(summary.arguments.begin(), summary.arguments.end());
+    const auto& valueDeps = depInfo.getValueDependencies();
+    if (depInfo.isOnlyGlobalValueDependent()) {
+        for (const auto& val : valueDeps) {
+            summary.globals.push_back(val->getName().str());
+        }
+        std::sort(summary.globals.begin(), summary.globals.end());
+    } else if (!valueDeps.empty() || summary.dependency == DepInfo::VALUE_DEP) {
+        // local values can not be referred between runs, be conservative
+        summary.dependency = DepInfo::INPUT_DEP;
+        summary.arguments.clear();
+    }
+    for (const auto& element : depInfo.getCompositeValueDeps()) {
+        summary.elements.push_back(toDepSummary(element));
+    }
+    return summary;
+}
+
+FunctionSummary::ArgumentDepSummaries
+FunctionSummary::toArgumentDepSummaries(const DependencyAnaliser::ArgumentDependenciesMap& deps)
+{
+    ArgumentDepSummaries summaries;
+    for (const auto& item : deps) {
+        summaries[item.first->getArgNo()] = toDepSummary(item.second);
+    }
+    return summaries;
+}
+
+FunctionSummary::GlobalDepSummaries
+FunctionSummary::toGlobalDepSummaries(const DependencyAnaliser::GlobalVariableDependencyMap& deps)
+{
+    GlobalDepSummaries summaries;
+    for (const auto& item : deps) {
+        summaries[item.first->getName().str()] = toDepSummary(item.second);
+    }
+    return summaries;
+}
+
+bool FunctionSummary::fromDepSummary(const DepSummary& summary,
+                                     llvm::Function* depsOwner,
+                                     llvm::Type* type,
+                                     ValueDepInfo& depInfo)
+{
+    ArgumentSet args;
+    for (const auto& argNo : summary.arguments) {
+        if (argNo >= depsOwner->arg_size()) {
+            return false;
+        }
+        args.insert(&*std::next(depsOwner->arg_begin(), argNo));
+    }
+    ValueSet globals;
+    llvm::Module* M = depsOwner->getParent();
+    for (const auto& name : summary.globals) {
+        llvm::GlobalVariable* global = M->getNamedGlobal(name);
+        if (!global) {
+            return false;
+        }
+        globals.insert(global);
+    }
+    DepInfo dep(summary.dependency, std::move(args));
+    dep.mergeDependencies(globals);
+    dep.setDependency(summary.dependency);
+    depInfo = type ? ValueDepInfo(type, dep) : ValueDepInfo(dep);
+    auto& elements = depInfo.getCompositeValueDeps();
+    if (elements.size() != summary.elements.size()) {
+        return summary.elements.empty();
+    }
+    for (unsigned i = 0; i < elements.size(); ++i) {
+        if (!fromDepSummary(summary.elements[i], depsOwner, nullptr, elements[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FunctionSummary::fromArgumentDepSummaries(const ArgumentDepSummaries& summaries,
+                                               llvm::Function* keysOwner,
+                                               llvm::Function* depsOwner,
+                                               DependencyAnaliser::ArgumentDependenciesMap& deps)
+{
+    for (const auto& item : summaries) {
+        if (item.first >= keysOwner->arg_size()) {
+            return false;
+        }
+        llvm::Argument* arg = &*std::next(keysOwner->arg_begin(), item.first);
+        ValueDepInfo depInfo;
+        if (!fromDepSummary(item.second, depsOwner, arg->getType(), depInfo)) {
+            return false;
+        }
+        deps.insert(std::make_pair(arg, depInfo));
+    }
+    return true;
+}
+
+bool FunctionSummary::fromGlobalDepSummaries(const GlobalDepSummaries& summaries,
+                                             llvm::Function* depsOwner,
+                                             DependencyAnaliser::GlobalVariableDependencyMap& deps)
+{
+    llvm::Module* M = depsOwner->getParent();
+    for (const auto& item : summaries) {
+        llvm::GlobalVariable* global = M->getNamedGlobal(item.first);
+        if (!global) {
+            return false;
+        }
+        ValueDepInfo depInfo;
+        if (!fromDepSummary(item.second, depsOwner, global->getType(), depInfo)) {
+            return false;
+        }
+        deps.insert(std::make_pair(global, depInfo));
+    }
+    return true;
+}
+
+uint64_t FunctionSummary::getContextHash(const DependencyAnaliser::ArgumentDependenciesMap& argDeps,
+                                         const DependencyAnaliser::GlobalVariableDependencyMap& globalDeps)
+{
+    uint64_t hash = hash_dep_summaries(0, toArgumentDepSummaries(argDeps));
+    return hash_dep_summaries(hash, toGlobalDepSummaries(globalDeps));
+}
+
+} // namespace input_dependency
+
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "DependencyAnaliser.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Function;
+class Module;
+class Type;
+}
+
+namespace input_dependency {
+
+/**
+ * \class FunctionSummary
+ * \brief Module independent form of function analysis results, used to reuse results between runs.
+ * Values are referred with stable keys: arguments with their numbers, globals with their names,
+ * instructions and blocks with their ordinals (\see FunctionNumbering).
+ */
+class FunctionSummary
+{
+public:
+    /// Serializable form of ValueDepInfo.
+    /// Dependencies on local values are not serialized, such dependencies are stored as input dependent.
+    struct DepSummary
+    {
+        DepInfo::Dependency dependency = DepInfo::UNKNOWN;
+        std::vector<unsigned> arguments;
+        std::vector<std::string> globals;
+        std::vector<DepSummary> elements;
+    };
+
+    using ArgumentDepSummaries = std::map<unsigned, DepSummary>;
+    using GlobalDepSummaries = std::map<std::string, DepSummary>;
+
+    struct CallSiteSummary
+    {
+        ArgumentDepSummaries argumentDeps;
+        GlobalDepSummaries globalDeps;
+    };
+
+    struct CalleeSummary
+    {
+        ArgumentDepSummaries callArgumentDeps;
+        GlobalDepSummaries callGlobalDeps;
+        // keys are call instruction ordinals
+        std::map<unsigned, CallSiteSummary> callSites;
+    };
+
+public:
+    std::string name;
+    // function IR hash combined with interface hashes of callees
+    uint64_t key = 0;
+    // hash of data callers use during their analysis
+    uint64_t interfaceHash = 0;
+    // hash of argument and globals dependencies function has been finalized with
+    uint64_t contextHash = 0;
+
+    /// \name Results of context insensitive analysis, used when analysing callers
+    /// \{
+    ArgumentDepSummaries outArgDeps;
+    DepSummary returnDeps;
+    std::vector<std::string> referencedGlobals;
+    std::vector<std::string> modifiedGlobals;
+    GlobalDepSummaries exitGlobalDeps;
+    /// \}
+
+    /// \name Finalized results
+    /// \{
+    bool isInputDep = false;
+    std::map<std::string, CalleeSummary> callees;
+    std::vector<unsigned> inputDepInstructions;
+    std::vector<unsigned> inputIndepInstructions;
+    std::vector<unsigned> inputDepBlocks;
+    /// \}
+
+public:
+    void computeInterfaceHash();
+
+    static DepSummary toDepSummary(const ValueDepInfo& depInfo);
+    static ArgumentDepSummaries toArgumentDepSummaries(const DependencyAnaliser::ArgumentDependenciesMap& deps);
+    static GlobalDepSummaries toGlobalDepSummaries(const DependencyAnaliser::GlobalVariableDependencyMap& deps);
+
+    /**
+     * \brief Restores dependency info from its summary.
+     * \param depsOwner function, arguments of which values depend on.
+     * \param type type of the value, used to restore composite dependencies. May be null.
+     * \return false if some global could not be found in the module.
+     */
+    static bool fromDepSummary(const DepSummary& summary,
+                               llvm::Function* depsOwner,
+                               llvm::Type* type,
+                               ValueDepInfo& depInfo);
+    /// \param keysOwner function, arguments of which are keys of the map.
+    static bool fromArgumentDepSummaries(const ArgumentDepSummaries& summaries,
+                                         llvm::Function* keysOwner,
+                                         llvm::Function* depsOwner,
+                                         DependencyAnaliser::ArgumentDependenciesMap& deps);
+    static bool fromGlobalDepSummaries(const GlobalDepSummaries& summaries,
+                                       llvm::Function* depsOwner,
+                                       DependencyAnaliser::GlobalVariableDependencyMap& deps);
+
+    /// Hash of argument and globals dependencies a function is finalized with.
+    static uint64_t getContextHash(const DependencyAnaliser::ArgumentDependenciesMap& argDeps,
+                                   const DependencyAnaliser::GlobalVariableDependencyMap& globalDeps);
+}; // class FunctionSummary
+
+} // namespace input_dependency
+
@@ -0,0 +1,234 @@
+#include "FunctionSummaryStore.h"
+
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <fstream>
+
+namespace input_dependency {
+
+namespace {
+
+// increase whenever summary format or analysis semantics change
+const unsigned summary_format_version = 1;
+
+}
+
+bool FunctionSummaryStore::load(const std::string& file_name)
+{
+    m_summaries.clear();
+    std::ifstream ifs(file_name, std::ifstream::in);
+    if (!ifs.is_open()) {
+        llvm::dbgs() << "No function summaries file " << file_name << "\n";
+        return false;
+    }
+    try {
+        json root;
+        ifs >> root;
+        auto version_pos = root.find("version");
+        if (version_pos == root.end() || version_pos->get<unsigned>() != summary_format_version) {
+            llvm::dbgs() << "Function summaries file " << file_name << " has incompatible version. Ignoring\n";
+            return false;
+        }
+        const json& functions = root["functions"];
+        for (unsigned i = 0; i < functions.size(); ++i) {
+            insert(from_json(functions[i]));
+        }
+    } catch (const std::exception& e) {
+        llvm::dbgs() << "Failed to parse function summaries file " << file_name << ": " << e.what() << "\n";
+        m_summaries.clear();
+        return false;
+    }
+    llvm::dbgs() << "Loaded " << m_summaries.size() << " function summaries\n";
+    return true;
+}
+
+bool FunctionSummaryStore::save(const std::string& file_name) const
+{
+    std::ofstream ofs(file_name, std::ofstream::out);
+    if (!ofs.is_open()) {
+        llvm::dbgs() << "Could not open file " << file_name << "\n";
+        return false;
+    }
+    json root;
+    root["version"] = summary_format_version;
+    json functions = json::array();
+    for (const auto& item : m_summaries) {
+        functions.push_back(to_json(*item.second));
+    }
+    root["functions"] = functions;
+    ofs << root.dump();
+    return true;
+}
+
+FunctionSummaryStore::FunctionSummaryType FunctionSummaryStore::find(const std::string& name) const
+{
+    auto pos = m_summaries.find(name);
+    if (pos == m_summaries.end()) {
+        return FunctionSummaryType();
+    }
+    return pos->second;
+}
+
+void FunctionSummaryStore::insert(const FunctionSummaryType& summary)
+{
+    m_summaries[summary->name] = summary;
+}
+
+void FunctionSummaryStore::clear()
+{
+    m_summaries.clear();
+}
+
+FunctionSummaryStore::json FunctionSummaryStore::to_json(const FunctionSummary& summary)
+{
+    json value;
+    value["name"] = summary.name;
+    value["key"] = summary.key;
+    value["interface_hash"] = summary.interfaceHash;
+    value["context_hash"] = summary.contextHash;
+    value["out_args"] = to_json(summary.outArgDeps);
+    value["return"] = to_json(summary.returnDeps);
+    value["referenced_globals"] = summary.referencedGlobals;
+    value["modified_globals"] = summary.modifiedGlobals;
+    value["exit_globals"] = to_json(summary.exitGlobalDeps);
+    value["input_dep"] = summary.isInputDep;
+    json callees = json::array();
+    for (const auto& callee : summary.callees) {
+        json callee_value;
+        callee_value["name"] = callee.first;
+        callee_value["args"] = to_json(callee.second.callArgumentDeps);
+        callee_value["globals"] = to_json(callee.second.callGlobalDeps);
+        json call_sites = json::array();
+        for (const auto& callSite : callee.second.callSites) {
+            json call_site_value;
+            call_site_value["instr"] = callSite.first;
+            call_site_value["args"] = to_json(callSite.second.argumentDeps);
+            call_site_value["globals"] = to_json(callSite.second.globalDeps);
+            call_sites.push_back(call_site_value);
+        }
+        callee_value["call_sites"] = call_sites;
+        callees.push_back(callee_value);
+    }
+    value["callees"] = callees;
+    value["input_dep_instrs"] = summary.inputDepInstructions;
+    value["input_indep_instrs"] = summary.inputIndepInstructions;
+    value["input_dep_blocks"] = summary.inputDepBlocks;
+    return value;
+}
+
+FunctionSummaryStore::json FunctionSummaryStore::to_json(const FunctionSummary::DepSummary& summary)
+{
+    json value;
+    value["dep"] = static_cast<unsigned>(summary.dependency);
+    if (!summary.arguments.empty()) {
+        value["args"] = summary.arguments;
+    }
+    if (!summary.globals.empty()) {
+        value["globals"] = summary.globals;
+    }
+    if (!summary.elements.empty()) {
+        json elements = json::array();
+        for (const auto& element : summary.elements) {
+            elements.push_back(to_json(element));
+        }
+        value["elements"] = elements;
+    }
+    return value;
+}
+
+FunctionSummaryStore::json FunctionSummaryStore::to_json(const FunctionSummary::ArgumentDepSummaries& summaries)
+{
+    json value = json::array();
+    for (const auto& item : summaries) {
+        json entry = to_json(item.second);
+        entry["key"] = item.first;
+        value.push_back(entry);
+    }
+    return value;
+}
+
+FunctionSummaryStore::json FunctionSummaryStore::to_json(const FunctionSummary::GlobalDepSummaries& summaries)
+{
+    json value = json::array();
+    for (const auto& item : summaries) {
+        json entry = to_json(item.second);
+        entry["key"] = item.first;
+        value.push_back(entry);
+    }
+    return value;
+}
+
+FunctionSummaryStore::FunctionSummaryType FunctionSummaryStore::from_json(const json& value)
+{
+    FunctionSummaryType summary = std::make_shared<FunctionSummary>();
+    summary->name = value["name"].get<std::string>();
+    summary->key = value["key"].get<uint64_t>();
+    summary->interfaceHash = value["interface_hash"].get<uint64_t>();
+    summary->contextHash = value["context_hash"].get<uint64_t>();
+    summary->outArgDeps = argument_deps_from_json(value["out_args"]);
+    summary->returnDeps = dep_from_json(value["return"]);
+    summary->referencedGlobals = value["referenced_globals"].get<std::vector<std::string>>();
+    summary->modifiedGlobals = value["modified_globals"].get<std::vector<std::string>>();
+    summary->exitGlobalDeps = global_deps_from_json(value["exit_globals"]);
+    summary->isInputDep = value["input_dep"].get<bool>();
+    const json& callees = value["callees"];
+    for (unsigned i = 0; i < callees.size(); ++i) {
+        const json& callee_value = callees[i];
+        auto& callee = summary->callees[callee_value["name"].get<std::string>()];
+        callee.callArgumentDeps = argument_deps_from_json(callee_value["args"]);
+        callee.callGlobalDeps = global_deps_from_json(callee_value["globals"]);
+        const json& call_sites = callee_value["call_sites"];
+        for (unsigned j = 0; j < call_sites.size(); ++j) {
+            auto& callSite = callee.callSites[call_sites[j]["instr"].get<unsigned>()];
+            callSite.argumentDeps = argument_deps_from_json(call_sites[j]["args"]);
+            callSite.globalDeps = global_deps_from_json(call_sites[j]["globals"]);
+        }
+    }
+    summary->inputDepInstructions = value["input_dep_instrs"].get<std::vector<unsigned>>();
+    summary->inputIndepInstructions = value["input_indep_instrs"].get<std::vector<unsigned>>();
+    summary->inputDepBlocks = value["input_dep_blocks"].get<std::vector<unsigned>>();
+    return summary;
+}
+
+FunctionSummary::DepSummary FunctionSummaryStore::dep_from_json(const json& value)
+{
+    FunctionSummary::DepSummary summary;
+    summary.dependency = static_cast<DepInfo::Dependency>(value["dep"].get<unsigned>());
+    auto args_pos = value.find("args");
+    if (args_pos != value.end()) {
+        summary.arguments = args_pos->get<std::vector<unsigned>>();
+    }
+    auto globals_pos = value.find("globals");
+    if (globals_pos != value.end()) {
+        summary.globals = globals_pos->get<std::vector<std::string>>();
+    }
+    auto elements_pos = value.find("elements");
+    if (elements_pos != value.end()) {
+        for (unsigned i = 0; i < elements_pos->size(); ++i) {
+            summary.elements.push_back(dep_from_json((*elements_pos)[i]));
+        }
+    }
+    return summary;
+}
+
+FunctionSummary::ArgumentDepSummaries FunctionSummaryStore::argument_deps_from_json(const json& value)
+{
+    FunctionSummary::ArgumentDepSummaries summaries;
+    for (unsigned i = 0; i < value.size(); ++i) {
+        summaries[value[i]["key"].get<unsigned>()] = dep_from_json(value[i]);
+    }
+    return summaries;
+}
+
+FunctionSummary::GlobalDepSummaries FunctionSummaryStore::global_deps_from_json(const json& value)
+{
+    FunctionSummary::GlobalDepSummaries summaries;
+    for (unsigned i = 0; i < value.size(); ++i) {
+        summaries[value[i]["key"].get<std::string>()] = dep_from_json(value[i]);
+    }
+    return summaries;
+}
+
+} // namespace input_dependency
+
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "FunctionSummary.h"
+
+#include "json/json.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace input_dependency {
+
+/**
+ * \class FunctionSummaryStore
+ * \brief On disk storage of function summaries, keyed by function name.
+ */
+class FunctionSummaryStore
+{
+public:
+    using FunctionSummaryType = std::shared_ptr<FunctionSummary>;
+
+private:
+    using json = nlohmann::json;
+
+public:
+    /// Returns false if file can not be read, or was written by different format version.
+    bool load(const std::string& file_name);
+    bool save(const std::string& file_name) const;
+
+    FunctionSummaryType find(const std::string& name) const;
+    void insert(const FunctionSummaryType& summary);
+    void clear();
+
+private:
+    static json to_json(const FunctionSummary& summary);
+    static json to_json(const FunctionSummary::DepSummary& summary);
+    static json to_json(const FunctionSummary::ArgumentDepSummaries& summaries);
+    static json to_json(const FunctionSummary::GlobalDepSummaries& summaries);
+    static FunctionSummaryType from_json(const json& value);
+    static FunctionSummary::DepSummary dep_from_json(const json& value);
+    static FunctionSummary::ArgumentDepSummaries argument_deps_from_json(const json& value);
+    static FunctionSummary::GlobalDepSummaries global_deps_from_json(const json& value);
+
+private:
+    std::unordered_map<std::string, FunctionSummaryType> m_summaries;
+};
+
+} // namespace input_dependency
+
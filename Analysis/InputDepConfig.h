@@ -1,5 +1,6 @@
 #pragma once
 
+#include <mutex>
 #include <unordered_set>
 
 #include "llvm/IR/Function.h"
@@ -56,23 +57,78 @@ public:
         return use_cache;
     }
 
+    void set_cache_file(const std::string& file)
+    {
+        cache_file = file;
+    }
+
+    bool has_cache_file() const
+    {
+        return !cache_file.empty();
+    }
+
+    const std::string& get_cache_file() const
+    {
+        return cache_file;
+    }
+
+    void set_lazy_analysis(bool lazy)
+    {
+        lazy_analysis = lazy;
+    }
+
+    bool is_lazy_analysis() const
+    {
+        return lazy_analysis;
+    }
+
+    void set_summary_file(const std::string& file)
+    {
+        summary_file = file;
+    }
+
+    bool has_summary_file() const
+    {
+        return !summary_file.empty();
+    }
+
+    const std::string& get_summary_file() const
+    {
+        return summary_file;
+    }
+
+    void set_memory_stats(bool stats)
+    {
+        memory_stats = stats;
+    }
+
+    bool is_memory_stats() const
+    {
+        return memory_stats;
+    }
+
+    // functions are registered by transformations, which may do so from several threads
     void add_input_dep_function(llvm::Function* F)
     {
+        std::lock_guard<std::mutex> lock(m_functions_mutex);
         m_input_dep_functions.insert(F);
     }
 
     bool is_input_dep_function(llvm::Function* F)
     {
+        std::lock_guard<std::mutex> lock(m_functions_mutex);
         return m_input_dep_functions.find(F) != m_input_dep_functions.end();
     }
 
     void add_extracted_function(llvm::Function* F)
     {
+        std::lock_guard<std::mutex> lock(m_functions_mutex);
         m_extracted_functions.insert(F);
     }
 
     bool is_extracted_function(llvm::Function* F)
     {
+        std::lock_guard<std::mutex> lock(m_functions_mutex);
         return m_extracted_functions.find(F) != m_extracted_functions.end();
     }
 
@@ -81,6 +137,11 @@ private:
     bool cache_input_dep;
     std::string lib_config_file;
     bool use_cache;
+    std::string cache_file;
+    std::string summary_file;
+    bool lazy_analysis;
+    bool memory_stats = false;
+    std::mutex m_functions_mutex;
     std::unordered_set<llvm::Function*> m_input_dep_functions;
     std::unordered_set<llvm::Function*> m_extracted_functions;
 };
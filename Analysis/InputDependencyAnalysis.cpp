@@ -3,10 +3,12 @@
 #include "BasicBlocksUtils.h"
 #include "FunctionAnaliser.h"
 #include "FunctionInputDependencyResultInterface.h"
+#include "FunctionSummary.h"
 #include "IndirectCallSitesAnalysis.h"
 #include "InputDepConfig.h"
 #include "InputDepInstructionsRecorder.h"
 #include "InputDependentFunctionAnalysisResult.h"
+#include "TraceRecorder.h"
 #include "Utils.h"
 #include "constants.h"
 
@@ -23,12 +25,41 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <list>
+#include <map>
+
 namespace input_dependency {
 
+namespace {
+
+// bounds number of times a function is finalized again for changed context
+const unsigned max_refinalization_count = 8;
+
+// Library functions are described by the config file, thus summaries depend on its contents, not only its name
+uint64_t getLibConfigHash()
+{
+    const auto& config = InputDepConfig::get();
+    uint64_t hash = Utils::hashString(config.get_config_file(), config.is_goto_unsafe());
+    if (!config.has_config_file()) {
+        return hash;
+    }
+    auto buffer = llvm::MemoryBuffer::getFile(config.get_config_file());
+    if (!buffer) {
+        return hash;
+    }
+    return Utils::hashString((*buffer)->getBuffer().str(), hash);
+}
+
+}
+
 InputDependencyAnalysis::InputDependencyAnalysis(llvm::Module* M)
     : m_module(M)
+    , m_isLazy(false)
+    , m_libConfigHash(0)
 {
     m_functionAnalysisGetter = [&] (llvm::Function* F) -> FunctionAnaliser* {
         auto pos = m_functionAnalisers.find(F);
@@ -40,6 +71,11 @@ InputDependencyAnalysis::InputDependencyAnalysis(llvm::Module* M)
     };
 }
 
+void InputDependencyAnalysis::setIsLazy(bool isLazy)
+{
+    m_isLazy = isLazy;
+}
+
 void InputDependencyAnalysis::setCallGraph(llvm::CallGraph* callGraph)
 {
     m_callGraph = callGraph;
@@ -75,8 +111,22 @@ void InputDependencyAnalysis::setDominatorTreeGetter(const DominatorTreeGetter&
     m_domTreeGetter = domTreeGetter;
 }
 
+void InputDependencyAnalysis::setFunctionAnalysesReleaser(const FunctionAnalysesReleaser& releaser)
+{
+    m_functionAnalysesReleaser = releaser;
+}
+
+void InputDependencyAnalysis::setFunctionAnalysesInvalidator(const FunctionAnalysesInvalidator& invalidator)
+{
+    m_functionAnalysesInvalidator = invalidator;
+}
+
 void InputDependencyAnalysis::run()
 {
+    if (InputDepConfig::get().has_summary_file()) {
+        m_summaryStore.load(InputDepConfig::get().get_summary_file());
+        m_libConfigHash = getLibConfigHash();
+    }
     llvm::scc_iterator<llvm::CallGraph*> CGI = llvm::scc_begin(m_callGraph);
     llvm::CallGraphSCC CurSCC(*m_callGraph, &CGI);
     while (!CGI.isAtEnd()) {
@@ -85,21 +135,260 @@ void InputDependencyAnalysis::run()
         const std::vector<llvm::CallGraphNode *> &NodeVec = *CGI;
         CurSCC.initialize(NodeVec.data(), NodeVec.data() + NodeVec.size());
 
+        unsigned scc_begin = m_functionsBottomUp.size();
         for (llvm::CallGraphNode* node : CurSCC) {
             llvm::Function* F = node->getFunction();
             if (F == nullptr || Utils::isLibraryFunction(F, m_module)) {
                 continue;
             }
-            runOnFunction(F);
+            m_functionsBottomUp.push_back(F);
+            m_moduleFunctions.insert(F);
+        }
+        if (m_functionsBottomUp.size() != scc_begin) {
+            m_sccEnds.push_back(m_functionsBottomUp.size());
         }
         ++CGI;
     }
-    doFinalization();
+    if (m_isLazy || InputDepConfig::get().is_lazy_analysis()) {
+        m_isLazy = true;
+        collectModuleCallers();
+        llvm::dbgs() << "Input dependency analysis will run on demand\n\n";
+        return;
+    }
+    runOnAllFunctions();
     llvm::dbgs() << "Finished input dependency analysis\n\n";
 }
 
+void InputDependencyAnalysis::runOnAllFunctions() const
+{
+    m_isLazy = false;
+    unsigned scc_begin = 0;
+    for (auto scc_end : m_sccEnds) {
+        TraceRecorder::ScopedSpan span("scc", m_functionsBottomUp[scc_begin]);
+        for (unsigned i = scc_begin; i < scc_end; ++i) {
+            llvm::Function* F = m_functionsBottomUp[i];
+            if (m_functionAnalisers.find(F) == m_functionAnalisers.end()) {
+                runOnFunction(F);
+            }
+        }
+        scc_begin = scc_end;
+    }
+    std::vector<llvm::Function*> functions;
+    for (auto it = m_functionsBottomUp.rbegin(); it != m_functionsBottomUp.rend(); ++it) {
+        if (m_finalizationContexts.find(*it) == m_finalizationContexts.end()) {
+            functions.push_back(*it);
+        }
+    }
+    doFinalization(functions);
+    if (InputDepConfig::get().has_summary_file()) {
+        saveFunctionSummaries();
+    }
+}
+
+void InputDependencyAnalysis::runOnDemand(llvm::Function* F) const
+{
+    runOnInvalidated();
+    if (!m_isLazy || m_finalizationContexts.find(F) != m_finalizationContexts.end()
+            || Utils::isLibraryFunction(F, m_module)) {
+        return;
+    }
+    TraceRecorder::ScopedSpan span("on_demand", F);
+    // context of F depends on all its transitive callers
+    const auto& toFinalize = collectTransitiveCallers(FunctionSet{F});
+    // Analysis of these needs results of all their callees. For a function reachable from main this is close to the
+    // whole module, thus queries pay off for functions with few transitive callers, e.g. leaves of shallow call trees,
+    // or code not reachable from main. Already analysed functions are not analysed again by following queries.
+    const auto& toAnalyze = collectTransitiveCallees(toFinalize);
+    llvm::dbgs() << "Input dependency on demand for " << F->getName() << ": analysing " << toAnalyze.size()
+                 << " functions, finalizing " << toFinalize.size() << " functions\n";
+    for (auto function : m_functionsBottomUp) {
+        if (toAnalyze.find(function) != toAnalyze.end()
+                && m_functionAnalisers.find(function) == m_functionAnalisers.end()) {
+            runOnFunction(function);
+        }
+    }
+    std::vector<llvm::Function*> functions;
+    for (auto it = m_functionsBottomUp.rbegin(); it != m_functionsBottomUp.rend(); ++it) {
+        if (toFinalize.find(*it) != toFinalize.end()
+                && m_finalizationContexts.find(*it) == m_finalizationContexts.end()) {
+            functions.push_back(*it);
+        }
+    }
+    doFinalization(functions);
+}
+
+FunctionSet InputDependencyAnalysis::getAffectedFunctions(const FunctionSet& functions) const
+{
+    // callers use results of changed functions, and may in turn change contexts of any function they call
+    return collectTransitiveCallees(collectTransitiveCallers(functions));
+}
+
+FunctionSet InputDependencyAnalysis::refresh(const FunctionSet& staleFunctions, InputDependencyAnalysisInfo& results)
+{
+    // callers use results of stale functions, thus are analysed again
+    FunctionSet refreshed = collectTransitiveCallers(staleFunctions);
+    std::unordered_map<llvm::Function*, uint64_t> previousContexts;
+    auto refreshFunction = [&] (llvm::Function* F) {
+        // contexts of callees are taken before their caller changes
+        for (const auto& calledF : collectCalledFunctions(F)) {
+            if (previousContexts.find(calledF) == previousContexts.end()) {
+                previousContexts[calledF] = getCallersContextHash(calledF, results);
+            }
+        }
+        auto result = getAnalysisInfo(F);
+        if (result) {
+            results[F] = result;
+        }
+    };
+    for (auto F : refreshed) {
+        refreshFunction(F);
+    }
+    std::vector<llvm::Function*> worklist(refreshed.begin(), refreshed.end());
+    while (!worklist.empty()) {
+        llvm::Function* F = worklist.back();
+        worklist.pop_back();
+        for (const auto& calledF : collectCalledFunctions(F)) {
+            if (refreshed.find(calledF) != refreshed.end() || Utils::isLibraryFunction(calledF, m_module)
+                    || previousContexts[calledF] == getCallersContextHash(calledF, results)) {
+                continue;
+            }
+            refreshed.insert(calledF);
+            refreshFunction(calledF);
+            worklist.push_back(calledF);
+        }
+    }
+    llvm::dbgs() << "Re-analysed " << refreshed.size() << " functions affected by "
+                 << staleFunctions.size() << " stale functions\n";
+    return refreshed;
+}
+
+uint64_t InputDependencyAnalysis::getCallersContextHash(llvm::Function* F, const InputDependencyAnalysisInfo& results) const
+{
+    // Cached results keep only whether arguments and globals at call sites are input dependent,
+    // thus fresh results are compared in the same form. Input dependency at any call site makes a value input dependent.
+    std::unordered_map<llvm::Argument*, bool> inputDepArgs;
+    std::unordered_map<llvm::GlobalVariable*, bool> inputDepGlobals;
+    auto callers_pos = m_moduleCallers.find(F);
+    if (callers_pos != m_moduleCallers.end()) {
+        for (const auto& caller : callers_pos->second) {
+            auto pos = results.find(caller);
+            if (pos == results.end()) {
+                continue;
+            }
+            const auto& callDepInfo = pos->second->getFunctionCallDepInfo(F);
+            for (const auto& callsite_entry : callDepInfo.getCallsArgumentDependencies()) {
+                for (auto& arg : F->getArgumentList()) {
+                    auto arg_pos = callsite_entry.second.find(&arg);
+                    inputDepArgs[&arg] |= arg_pos == callsite_entry.second.end() || !arg_pos->second.isInputIndep();
+                }
+            }
+            for (const auto& callsite_entry : callDepInfo.getCallsGlobalsDependencies()) {
+                for (const auto& global_entry : callsite_entry.second) {
+                    inputDepGlobals[global_entry.first] |= !global_entry.second.isInputIndep();
+                }
+            }
+        }
+    }
+    DependencyAnaliser::ArgumentDependenciesMap argDeps;
+    for (const auto& item : inputDepArgs) {
+        auto dep = item.second ? DepInfo::INPUT_DEP : DepInfo::INPUT_INDEP;
+        argDeps.insert(std::make_pair(item.first, ValueDepInfo(item.first->getType(), DepInfo(dep))));
+    }
+    DependencyAnaliser::GlobalVariableDependencyMap globalDeps;
+    for (const auto& item : inputDepGlobals) {
+        auto dep = item.second ? DepInfo::INPUT_DEP : DepInfo::INPUT_INDEP;
+        globalDeps.insert(std::make_pair(item.first, ValueDepInfo(item.first->getType(), DepInfo(dep))));
+    }
+    return FunctionSummary::getContextHash(argDeps, globalDeps);
+}
+
+FunctionSet InputDependencyAnalysis::collectTransitiveCallers(const FunctionSet& functions) const
+{
+    FunctionSet callers;
+    std::vector<llvm::Function*> worklist(functions.begin(), functions.end());
+    while (!worklist.empty()) {
+        llvm::Function* current = worklist.back();
+        worklist.pop_back();
+        if (!callers.insert(current).second) {
+            continue;
+        }
+        auto pos = m_moduleCallers.find(current);
+        if (pos != m_moduleCallers.end()) {
+            worklist.insert(worklist.end(), pos->second.begin(), pos->second.end());
+        }
+    }
+    return callers;
+}
+
+FunctionSet InputDependencyAnalysis::collectTransitiveCallees(const FunctionSet& functions) const
+{
+    FunctionSet callees;
+    std::vector<llvm::Function*> worklist(functions.begin(), functions.end());
+    while (!worklist.empty()) {
+        llvm::Function* current = worklist.back();
+        worklist.pop_back();
+        if (!callees.insert(current).second) {
+            continue;
+        }
+        for (const auto& calledF : collectCalledFunctions(current)) {
+            if (!Utils::isLibraryFunction(calledF, m_module)) {
+                worklist.push_back(calledF);
+            }
+        }
+    }
+    return callees;
+}
+
+void InputDependencyAnalysis::collectModuleCallers()
+{
+    for (auto F : m_functionsBottomUp) {
+        for (const auto& calledF : collectCalledFunctions(F)) {
+            m_moduleCallers[calledF].insert(F);
+        }
+    }
+}
+
+FunctionSet InputDependencyAnalysis::collectCalledFunctions(llvm::Function* F) const
+{
+    // Over-approximation of functions F may call: direct callees, candidates of indirect and virtual calls,
+    // and functions whose address is taken in F, as they may be called through library functions.
+    FunctionSet calledFunctions;
+    for (auto& B : *F) {
+        for (auto& I : B) {
+            for (auto& op : I.operands()) {
+                if (auto* function = llvm::dyn_cast<llvm::Function>(op.get()->stripPointerCasts())) {
+                    calledFunctions.insert(function);
+                }
+            }
+            llvm::FunctionType* calledFType = nullptr;
+            if (auto* callInst = llvm::dyn_cast<llvm::CallInst>(&I)) {
+                if (callInst->getCalledFunction()) {
+                    continue;
+                }
+                calledFType = callInst->getFunctionType();
+            } else if (auto* invokeInst = llvm::dyn_cast<llvm::InvokeInst>(&I)) {
+                if (invokeInst->getCalledFunction()) {
+                    continue;
+                }
+                calledFType = invokeInst->getFunctionType();
+            } else {
+                continue;
+            }
+            if (m_virtualCallSiteAnalysisRes->hasVirtualCallCandidates(&I)) {
+                const auto& candidates = m_virtualCallSiteAnalysisRes->getVirtualCallCandidates(&I);
+                calledFunctions.insert(candidates.begin(), candidates.end());
+            } else if (m_indirectCallSiteAnalysisRes->hasIndirectTargets(calledFType)) {
+                const auto& targets = m_indirectCallSiteAnalysisRes->getIndirectTargets(calledFType);
+                calledFunctions.insert(targets.begin(), targets.end());
+            }
+        }
+    }
+    return calledFunctions;
+}
+
 bool InputDependencyAnalysis::isInputDependent(llvm::Function* F, llvm::Instruction* instr) const
 {
+    runOnDemand(F);
     auto pos = m_functionAnalisers.find(F);
     if (pos == m_functionAnalisers.end()) {
         return false;
@@ -118,6 +407,7 @@ bool InputDependencyAnalysis::isInputDependent(llvm::Instruction* instr) const
 bool InputDependencyAnalysis::isInputDependent(llvm::BasicBlock* block) const
 {
     auto F = block->getParent();
+    runOnDemand(F);
     auto pos = m_functionAnalisers.find(F);
     if (pos == m_functionAnalisers.end()) {
         return false;
@@ -127,6 +417,7 @@ bool InputDependencyAnalysis::isInputDependent(llvm::BasicBlock* block) const
 
 InputDependencyAnalysis::InputDepResType InputDependencyAnalysis::getAnalysisInfo(llvm::Function* F)
 {
+    runOnDemand(F);
     auto pos = m_functionAnalisers.find(F);
     if (pos == m_functionAnalisers.end()) {
         return nullptr;
@@ -136,6 +427,7 @@ InputDependencyAnalysis::InputDepResType InputDependencyAnalysis::getAnalysisInf
 
 const InputDependencyAnalysis::InputDepResType InputDependencyAnalysis::getAnalysisInfo(llvm::Function* F) const
 {
+    runOnDemand(F);
     auto pos = m_functionAnalisers.find(F);
     if (pos == m_functionAnalisers.end()) {
         return nullptr;
@@ -153,32 +445,252 @@ bool InputDependencyAnalysis::insertAnalysisInfo(llvm::Function* F, InputDepResT
     return true;
 }
 
-void InputDependencyAnalysis::runOnFunction(llvm::Function* F)
+void InputDependencyAnalysis::invalidate(llvm::Function* F)
+{
+    if (Utils::isLibraryFunction(F, m_module)) {
+        return;
+    }
+    m_invalidatedFunctions.insert(F);
+    if (m_functionAnalysesInvalidator) {
+        m_functionAnalysesInvalidator(F);
+    }
+}
+
+void InputDependencyAnalysis::invalidateCallSite(llvm::Instruction* callSite)
+{
+    invalidate(callSite->getParent()->getParent());
+    // Callees get new context when caller is finalized again. Results inserted for callees, e.g. clone results projected
+    // from the original, are kept. Only callees without any results should be analysed.
+    llvm::Function* calledF = nullptr;
+    if (auto* callInst = llvm::dyn_cast<llvm::CallInst>(callSite)) {
+        calledF = callInst->getCalledFunction();
+    } else if (auto* invokeInst = llvm::dyn_cast<llvm::InvokeInst>(callSite)) {
+        calledF = invokeInst->getCalledFunction();
+    }
+    if (!calledF) {
+        return;
+    }
+    if (m_functionAnalisers.find(calledF) == m_functionAnalisers.end()) {
+        invalidate(calledF);
+    }
+}
+
+void InputDependencyAnalysis::removeFunction(llvm::Function* F)
+{
+    if (m_functionAnalysesInvalidator) {
+        m_functionAnalysesInvalidator(F);
+    }
+    m_functionAnalisers.erase(F);
+    m_invalidatedFunctions.erase(F);
+    m_functionsCallInfo.erase(F);
+    m_finalizationContexts.erase(F);
+    m_refinalizationCounts.erase(F);
+    m_processedInputDepFunctions.erase(F);
+    m_functionSummaries.erase(F);
+    for (auto* callersMap : {&m_calleeCallersInfo, &m_moduleCallers}) {
+        callersMap->erase(F);
+        for (auto& item : *callersMap) {
+            item.second.erase(F);
+        }
+    }
+    if (m_moduleFunctions.erase(F) == 0) {
+        return;
+    }
+    // keep SCC end positions in sync, dropping SCCs left empty
+    auto pos = std::find(m_functionsBottomUp.begin(), m_functionsBottomUp.end(), F);
+    const unsigned index = pos - m_functionsBottomUp.begin();
+    m_functionsBottomUp.erase(pos);
+    for (auto& scc_end : m_sccEnds) {
+        if (scc_end > index) {
+            --scc_end;
+        }
+    }
+    m_sccEnds.erase(std::unique(m_sccEnds.begin(), m_sccEnds.end()), m_sccEnds.end());
+    if (!m_sccEnds.empty() && m_sccEnds.front() == 0) {
+        m_sccEnds.erase(m_sccEnds.begin());
+    }
+}
+
+void InputDependencyAnalysis::runOnInvalidated() const
+{
+    if (m_invalidatedFunctions.empty()) {
+        return;
+    }
+    FunctionSet toAnalyze;
+    for (const auto& F : m_invalidatedFunctions) {
+        // in lazy mode functions not analysed yet will be analysed on demand
+        if (m_isLazy && m_functionAnalisers.find(F) == m_functionAnalisers.end()
+                && m_moduleFunctions.find(F) != m_moduleFunctions.end()) {
+            continue;
+        }
+        toAnalyze.insert(F);
+    }
+    m_invalidatedFunctions.clear();
+
+    // Analyse bottom-up. When interface of a function changes, its callers are analysed again.
+    std::vector<llvm::Function*> analyzedFunctions;
+    FunctionSet formerCallees;
+    while (!toAnalyze.empty()) {
+        FunctionSet affectedCallers;
+        for (auto F : getBottomUpOrder(toAnalyze)) {
+            llvm::dbgs() << "Re-analysing invalidated function " << F->getName() << "\n";
+            analyzedFunctions.push_back(F);
+            affectedCallers.erase(F);
+            if (!reanalyzeFunction(F, formerCallees)) {
+                continue;
+            }
+            auto callers_pos = m_calleeCallersInfo.find(F);
+            if (callers_pos == m_calleeCallersInfo.end()) {
+                continue;
+            }
+            for (const auto& caller : callers_pos->second) {
+                if (caller != F) {
+                    affectedCallers.insert(caller);
+                }
+            }
+        }
+        toAnalyze = std::move(affectedCallers);
+    }
+
+    // finalize analysed functions top-down, once each
+    std::vector<llvm::Function*> functions;
+    FunctionSet added;
+    for (auto it = analyzedFunctions.rbegin(); it != analyzedFunctions.rend(); ++it) {
+        if (added.insert(*it).second) {
+            functions.push_back(*it);
+        }
+    }
+    // functions which are not called from analysed functions anymore get new context
+    for (const auto& callee : formerCallees) {
+        if (m_finalizationContexts.find(callee) != m_finalizationContexts.end() && added.insert(callee).second) {
+            functions.push_back(callee);
+        }
+    }
+    doFinalization(functions);
+}
+
+bool InputDependencyAnalysis::reanalyzeFunction(llvm::Function* F, FunctionSet& formerCallees) const
+{
+    FunctionAnaliser* analyzer = nullptr;
+    bool interfaceKnown = false;
+    uint64_t interfaceHash = 0;
+    auto pos = m_functionAnalisers.find(F);
+    if (pos != m_functionAnalisers.end()) {
+        for (const auto& callee : pos->second->getCallSitesData()) {
+            formerCallees.insert(callee);
+            auto callers_pos = m_calleeCallersInfo.find(callee);
+            if (callers_pos == m_calleeCallersInfo.end()) {
+                continue;
+            }
+            callers_pos->second.erase(F);
+            if (callers_pos->second.empty()) {
+                m_calleeCallersInfo.erase(callers_pos);
+            }
+        }
+        analyzer = pos->second->toFunctionAnalysisResult();
+    }
+    if (analyzer) {
+        FunctionSummary summary;
+        analyzer->collectSummaryInterface(summary);
+        interfaceHash = summary.interfaceHash;
+        interfaceKnown = true;
+        analyzer->reset();
+    } else {
+        // results inserted by transformations, e.g. for clones, are replaced with actual analysis results
+        InputDepResType analiser(new FunctionAnaliser(F, m_functionAnalysisGetter));
+        if (pos != m_functionAnalisers.end()) {
+            analiser->setIsExtractedFunction(pos->second->isExtractedFunction());
+        }
+        m_functionAnalisers[F] = analiser;
+        analyzer = analiser->toFunctionAnalysisResult();
+    }
+    m_finalizationContexts.erase(F);
+    m_refinalizationCounts.erase(F);
+    if (m_isLazy) {
+        for (auto& item : m_moduleCallers) {
+            item.second.erase(F);
+        }
+        for (const auto& calledF : collectCalledFunctions(F)) {
+            m_moduleCallers[calledF].insert(F);
+        }
+    }
+
+    setupFunctionAnaliser(F, analyzer);
+    analyzer->analyze();
+    releaseFunctionAnalyses(F);
+    mergeCallSitesData(F, analyzer->getCallSitesData());
+    if (InputDepConfig::get().has_summary_file()) {
+        uint64_t summaryKey = 0;
+        getFunctionSummaryKey(F, summaryKey);
+        createFunctionSummary(F, analyzer, summaryKey);
+    }
+    FunctionSummary summary;
+    analyzer->collectSummaryInterface(summary);
+    return !interfaceKnown || summary.interfaceHash != interfaceHash;
+}
+
+std::vector<llvm::Function*> InputDependencyAnalysis::getBottomUpOrder(const FunctionSet& functions) const
+{
+    // post order of call graph restricted to given functions
+    std::vector<llvm::Function*> order;
+    FunctionSet visited;
+    std::vector<std::pair<llvm::Function*, bool>> stack;
+    for (const auto& F : functions) {
+        stack.push_back(std::make_pair(F, false));
+        while (!stack.empty()) {
+            auto item = stack.back();
+            stack.pop_back();
+            if (item.second) {
+                order.push_back(item.first);
+                continue;
+            }
+            if (!visited.insert(item.first).second) {
+                continue;
+            }
+            stack.push_back(std::make_pair(item.first, true));
+            for (const auto& calledF : collectCalledFunctions(item.first)) {
+                if (functions.find(calledF) != functions.end() && visited.find(calledF) == visited.end()) {
+                    stack.push_back(std::make_pair(calledF, false));
+                }
+            }
+        }
+    }
+    return order;
+}
+
+void InputDependencyAnalysis::runOnFunction(llvm::Function* F) const
 {
     llvm::dbgs() << "Processing function " << F->getName() << "\n";
-    m_moduleFunctions.insert(m_moduleFunctions.begin(), F);
-    llvm::AAResults* AAR = m_aliasAnalysisInfoGetter(F);
-    llvm::LoopInfo* LI = m_loopInfoGetter(F);
-    const llvm::PostDominatorTree* PDom = m_postDomTreeGetter(F);
-    const llvm::DominatorTree* dom = m_domTreeGetter(F);
     InputDepResType analiser(new FunctionAnaliser(F, m_functionAnalysisGetter));
     auto res = m_functionAnalisers.insert(std::make_pair(F, analiser));
     assert(res.second);
     auto analyzer = res.first->second->toFunctionAnalysisResult();
-    analyzer->setAAResults(AAR);
-    analyzer->setLoopInfo(LI);
-    analyzer->setPostDomTree(PDom);
-    analyzer->setDomTree(dom);
-    analyzer->setVirtualCallSiteAnalysisResult(m_virtualCallSiteAnalysisRes);
-    analyzer->setIndirectCallSiteAnalysisResult(m_indirectCallSiteAnalysisRes);
-    analyzer->analyze();
+    uint64_t summaryKey = 0;
+    bool use_summaries = InputDepConfig::get().has_summary_file();
+    bool has_summary_key = use_summaries && getFunctionSummaryKey(F, summaryKey);
+    if (!has_summary_key || !loadFunctionSummary(F, analyzer, summaryKey)) {
+        setupFunctionAnaliser(F, analyzer);
+        analyzer->analyze();
+        releaseFunctionAnalyses(F);
+        if (use_summaries) {
+            createFunctionSummary(F, analyzer, summaryKey);
+        }
+    }
     const auto& calledFunctions = analyzer->getCallSitesData();
     mergeCallSitesData(F, calledFunctions);
 }
 
-void InputDependencyAnalysis::doFinalization()
+void InputDependencyAnalysis::doFinalization(const std::vector<llvm::Function*>& functions) const
 {
-    for (auto F : m_moduleFunctions) {
+    // Functions are finalized top-down. A callee finalized before its caller (e.g. in recursion) gets conservative
+    // context from that caller, thus is finalized again once the caller is finalized.
+    // Finalization is repeated only for functions whose incoming context has actually changed.
+    std::list<llvm::Function*> worklist(functions.begin(), functions.end());
+    std::unordered_set<llvm::Function*> in_worklist(functions.begin(), functions.end());
+    while (!worklist.empty()) {
+        llvm::Function* F = worklist.front();
+        worklist.pop_front();
+        in_worklist.erase(F);
         auto pos = m_functionAnalisers.find(F);
         if (pos == m_functionAnalisers.end()) {
             // log message
@@ -193,52 +705,171 @@ void InputDependencyAnalysis::doFinalization()
             llvm::dbgs() << "Mark extracted function. " << F->getName() << "\n";
             pos->second->setIsExtractedFunction(true);
         }
-        finalizeForGlobals(F, pos->second);
-        finalizeForArguments(F, pos->second);
+        if (!finalizeFunction(F, pos->second)) {
+            continue;
+        }
+        // callees not finalized yet will get the new context anyway
+        for (const auto& callee : pos->second->getCallSitesData()) {
+            if (m_finalizationContexts.find(callee) != m_finalizationContexts.end()
+                && in_worklist.insert(callee).second) {
+                worklist.push_back(callee);
+            }
+        }
+    }
+}
+
+void InputDependencyAnalysis::setupFunctionAnaliser(llvm::Function* F, FunctionAnaliser* analyzer) const
+{
+    analyzer->setAAResults(m_aliasAnalysisInfoGetter(F));
+    analyzer->setLoopInfo(m_loopInfoGetter(F));
+    analyzer->setPostDomTree(m_postDomTreeGetter(F));
+    analyzer->setDomTree(m_domTreeGetter(F));
+    analyzer->setVirtualCallSiteAnalysisResult(m_virtualCallSiteAnalysisRes);
+    analyzer->setIndirectCallSiteAnalysisResult(m_indirectCallSiteAnalysisRes);
+}
+
+void InputDependencyAnalysis::releaseFunctionAnalyses(llvm::Function* F) const
+{
+    // alias analysis and dominator trees are used only while analysing, not by finalization or queries
+    if (m_functionAnalysesReleaser) {
+        m_functionAnalysesReleaser(F);
     }
 }
 
-void InputDependencyAnalysis::finalizeForArguments(llvm::Function* F, InputDepResType& FA)
+bool InputDependencyAnalysis::finalizeFunction(llvm::Function* F, InputDepResType& FA) const
 {
     auto f_analiser = FA->toFunctionAnalysisResult();
     if (!f_analiser) {
-        return;
+        return false;
+    }
+    bool use_summaries = InputDepConfig::get().has_summary_file();
+    if (f_analiser->isLoadedFromSummary() && m_finalizationContexts.find(F) == m_finalizationContexts.end()) {
+        // loaded results are finalized for the context stored in summary
+        const auto& summary = m_functionSummaries[F];
+        m_finalizationContexts[F] = summary->contextHash;
+        if (summary->isInputDep) {
+            f_analiser->setIsInputDepFunction(true);
+        }
     }
 
-    if (m_calleeCallersInfo.find(F) == m_calleeCallersInfo.end()) {
-        auto& arguments = F->getArgumentList();
-        DependencyAnaliser::ArgumentDependenciesMap arg_deps;
-        for (auto& arg : arguments) {
-            arg_deps.insert(std::make_pair(&arg, ValueDepInfo(arg.getType(), DepInfo(DepInfo::INPUT_DEP))));
+    bool has_callers = (m_calleeCallersInfo.find(F) != m_calleeCallersInfo.end());
+    const auto& globalsInfo = getFunctionCallGlobalsInfo(F);
+    const auto& callInfo = has_callers ? getFunctionCallInfo(F) : getInputDepArgumentsInfo(F);
+    uint64_t contextHash = FunctionSummary::getContextHash(callInfo, globalsInfo);
+    auto context_pos = m_finalizationContexts.find(F);
+    if (context_pos != m_finalizationContexts.end()) {
+        if (context_pos->second == contextHash) {
+            return false;
         }
-        f_analiser->finalizeArguments(arg_deps);
-        if (F->getName() != "main") {
-            f_analiser->setIsInputDepFunction(true);
+        if (++m_refinalizationCounts[F] > max_refinalization_count) {
+            // results of previous finalization are conservative for the new context
+            llvm::dbgs() << "Reached finalization limit for " << F->getName() << "\n";
+            return false;
         }
-        return;
+        // finalization is destructive, analysis should be run again for new context
+        llvm::dbgs() << "Calling context of " << F->getName() << " has changed. Re-analysing\n";
+        f_analiser->reset();
+        setupFunctionAnaliser(F, f_analiser);
+        f_analiser->analyze();
+        if (use_summaries) {
+            createFunctionSummary(F, f_analiser, m_functionSummaries[F]->key);
+        }
+    }
+    m_finalizationContexts[F] = contextHash;
+    if (use_summaries) {
+        m_functionSummaries[F]->contextHash = contextHash;
     }
-    const auto& callInfo = getFunctionCallInfo(F);
+    f_analiser->finalizeGlobals(globalsInfo);
     f_analiser->finalizeArguments(callInfo);
+    if (!has_callers && F->getName() != "main") {
+        f_analiser->setIsInputDepFunction(true);
+    }
+    return true;
 }
 
-void InputDependencyAnalysis::finalizeForGlobals(llvm::Function* F, InputDepResType& FA)
+DependencyAnaliser::ArgumentDependenciesMap InputDependencyAnalysis::getInputDepArgumentsInfo(llvm::Function* F) const
 {
-    auto f_analiser = FA->toFunctionAnalysisResult();
-    if (!f_analiser) {
-        return;
+    auto& arguments = F->getArgumentList();
+    DependencyAnaliser::ArgumentDependenciesMap arg_deps;
+    for (auto& arg : arguments) {
+        arg_deps.insert(std::make_pair(&arg, ValueDepInfo(arg.getType(), DepInfo(DepInfo::INPUT_DEP))));
     }
-    const auto& globalsInfo = getFunctionCallGlobalsInfo(F);
-    f_analiser->finalizeGlobals(globalsInfo);
+    return arg_deps;
+}
+
+bool InputDependencyAnalysis::getFunctionSummaryKey(llvm::Function* F, uint64_t& key) const
+{
+    const auto& calledFunctions = collectCalledFunctions(F);
+    // order callees by name to get the same key between runs
+    std::map<std::string, llvm::Function*> orderedFunctions;
+    for (const auto& calledF : calledFunctions) {
+        orderedFunctions[calledF->getName().str()] = calledF;
+    }
+
+    key = Utils::hashCombine(m_libConfigHash, Utils::getFunctionHash(F));
+    for (const auto& item : orderedFunctions) {
+        key = Utils::hashString(item.first, key);
+        if (Utils::isLibraryFunction(item.second, m_module)) {
+            continue;
+        }
+        auto pos = m_functionSummaries.find(item.second);
+        if (pos == m_functionSummaries.end()) {
+            // callee has not been analysed yet, e.g. recursive call
+            return false;
+        }
+        key = Utils::hashCombine(key, pos->second->interfaceHash);
+    }
+    return true;
+}
+
+bool InputDependencyAnalysis::loadFunctionSummary(llvm::Function* F, FunctionAnaliser* analyzer, uint64_t key) const
+{
+    auto summary = m_summaryStore.find(F->getName().str());
+    if (!summary || summary->key != key) {
+        return false;
+    }
+    if (!analyzer->loadSummary(summary)) {
+        llvm::dbgs() << "Failed to load summary of function " << F->getName() << "\n";
+        return false;
+    }
+    llvm::dbgs() << "Loaded summary of function " << F->getName() << "\n";
+    m_functionSummaries[F] = summary;
+    return true;
+}
+
+void InputDependencyAnalysis::createFunctionSummary(llvm::Function* F, FunctionAnaliser* analyzer, uint64_t key) const
+{
+    auto summary = std::make_shared<FunctionSummary>();
+    summary->key = key;
+    analyzer->collectSummaryInterface(*summary);
+    m_functionSummaries[F] = summary;
+}
+
+void InputDependencyAnalysis::saveFunctionSummaries() const
+{
+    // summaries of functions which are not in the module anymore are dropped
+    m_summaryStore.clear();
+    for (auto& item : m_functionSummaries) {
+        auto pos = m_functionAnalisers.find(item.first);
+        assert(pos != m_functionAnalisers.end());
+        auto f_analiser = pos->second->toFunctionAnalysisResult();
+        if (!f_analiser->isLoadedFromSummary()) {
+            f_analiser->collectSummaryResults(*item.second);
+        }
+        item.second->isInputDep = f_analiser->isInputDepFunction();
+        m_summaryStore.insert(item.second);
+    }
+    m_summaryStore.save(InputDepConfig::get().get_summary_file());
 }
 
-void InputDependencyAnalysis::mergeCallSitesData(llvm::Function* caller, const FunctionSet& calledFunctions)
+void InputDependencyAnalysis::mergeCallSitesData(llvm::Function* caller, const FunctionSet& calledFunctions) const
 {
     for (const auto& F : calledFunctions) {
         m_calleeCallersInfo[F].insert(caller);
     }
 }
 
-DependencyAnaliser::ArgumentDependenciesMap InputDependencyAnalysis::getFunctionCallInfo(llvm::Function* F)
+DependencyAnaliser::ArgumentDependenciesMap InputDependencyAnalysis::getFunctionCallInfo(llvm::Function* F) const
 {
     DependencyAnaliser::ArgumentDependenciesMap argDeps;
     auto pos = m_calleeCallersInfo.find(F);
@@ -256,7 +887,7 @@ DependencyAnaliser::ArgumentDependenciesMap InputDependencyAnalysis::getFunction
         if (!f_analiser->areArgumentsFinalized()) {
             // if callee is finalized before caller, means caller was analyzed before callee.
             // this on its turn means callee callArgumentDeps should be input dep.
-            // proper fix would be making sure caller is finalized before callee
+            // callee is finalized again with precise info once caller is finalized (see doFinalization)
             for (auto& item : callInfo) {
                 if (item.second.isValueDep() || item.second.isInputArgumentDep()) {
                     item.second = ValueDepInfo(DepInfo(DepInfo::INPUT_DEP));
@@ -268,7 +899,7 @@ DependencyAnaliser::ArgumentDependenciesMap InputDependencyAnalysis::getFunction
     return argDeps;
 }
 
-DependencyAnaliser::GlobalVariableDependencyMap InputDependencyAnalysis::getFunctionCallGlobalsInfo(llvm::Function* F)
+DependencyAnaliser::GlobalVariableDependencyMap InputDependencyAnalysis::getFunctionCallGlobalsInfo(llvm::Function* F) const
 {
     DependencyAnaliser::GlobalVariableDependencyMap globalDeps;
     auto pos = m_calleeCallersInfo.find(F);
@@ -300,7 +931,7 @@ DependencyAnaliser::GlobalVariableDependencyMap InputDependencyAnalysis::getFunc
 }
 
 template <class DependencyMapType>
-void InputDependencyAnalysis::mergeDependencyMaps(DependencyMapType& mergeTo, const DependencyMapType& mergeFrom)
+void InputDependencyAnalysis::mergeDependencyMaps(DependencyMapType& mergeTo, const DependencyMapType& mergeFrom) const
 {
     for (const auto item : mergeFrom) {
         // only input dependent arguments were collected
@@ -314,7 +945,7 @@ void InputDependencyAnalysis::mergeDependencyMaps(DependencyMapType& mergeTo, co
     }
 }
 
-void InputDependencyAnalysis::addMissingGlobalsInfo(llvm::Function* F, DependencyAnaliser::GlobalVariableDependencyMap& globalDeps)
+void InputDependencyAnalysis::addMissingGlobalsInfo(llvm::Function* F, DependencyAnaliser::GlobalVariableDependencyMap& globalDeps) const
 {
     const std::string globalInitF("__cxx_global_var_init");
     llvm::Function* initF = m_module->getFunction(globalInitF);
@@ -2,6 +2,7 @@
 
 #include "InputDependencyAnalysisInterface.h"
 #include "DependencyAnaliser.h"
+#include "FunctionSummaryStore.h"
 
 namespace llvm {
 class CallGraph;
@@ -17,6 +18,7 @@ class DominatorTree;
 
 namespace input_dependency {
 
+class FunctionAnaliser;
 class VirtualCallSiteAnalysisResult;
 class IndirectCallSitesAnalysisResult;
 
@@ -26,10 +28,15 @@ public:
     using LoopInfoGetter = std::function<llvm::LoopInfo* (llvm::Function* F)>;
     using PostDominatorTreeGetter = std::function<const llvm::PostDominatorTree* (llvm::Function* F)>;
     using DominatorTreeGetter = std::function<const llvm::DominatorTree* (llvm::Function* F)>;
+    using FunctionAnalysesReleaser = std::function<void (llvm::Function* F)>;
+    using FunctionAnalysesInvalidator = std::function<void (llvm::Function* F)>;
 
 public:
     InputDependencyAnalysis(llvm::Module* M);
 
+    /// Analyse functions on demand, regardless of -input-dep-lazy.
+    void setIsLazy(bool isLazy);
+
     void setCallGraph(llvm::CallGraph* callGraph);
     void setVirtualCallSiteAnalysisResult(const VirtualCallSiteAnalysisResult* virtualCallSiteAnalysisRes);
     void setIndirectCallSiteAnalysisResult(const IndirectCallSitesAnalysisResult* indirectCallSiteAnalysisRes);
@@ -37,6 +44,11 @@ public:
     void setLoopInfoGetter(const LoopInfoGetter& loopInfoGetter);
     void setPostDominatorTreeGetter(const PostDominatorTreeGetter& postDomTreeGetter);
     void setDominatorTreeGetter(const DominatorTreeGetter& domTreeGetter);
+    /// Called when F has been analysed, so that analyses used only while analysing F are dropped.
+    /// Results of F keep using loop info given by the getter.
+    void setFunctionAnalysesReleaser(const FunctionAnalysesReleaser& releaser);
+    /// Called when F is invalidated or removed, so that analyses given by getters for former IR of F are dropped.
+    void setFunctionAnalysesInvalidator(const FunctionAnalysesInvalidator& invalidator);
 
 public:
     void run() override;
@@ -45,13 +57,22 @@ public:
     bool isInputDependent(llvm::Instruction* instr) const override;
     bool isInputDependent(llvm::BasicBlock* block) const override;
 
+    /// In lazy mode requesting whole module info runs analysis on all functions.
     const InputDependencyAnalysisInfo& getAnalysisInfo() const override
     {
+        runOnInvalidated();
+        if (m_isLazy) {
+            runOnAllFunctions();
+        }
         return m_functionAnalisers;
     }
 
     InputDependencyAnalysisInfo& getAnalysisInfo() override
     {
+        runOnInvalidated();
+        if (m_isLazy) {
+            runOnAllFunctions();
+        }
         return m_functionAnalisers;
     }
 
@@ -60,20 +81,65 @@ public:
 
     bool insertAnalysisInfo(llvm::Function* F, InputDepResType analysis_info) override;
 
-private:
-    void runOnFunction(llvm::Function* F);
-    void doFinalization();
+    void invalidate(llvm::Function* F) override;
+    void invalidateCallSite(llvm::Instruction* callSite) override;
+    void removeFunction(llvm::Function* F) override;
+
+    /// Returns given functions together with functions results of which depend on them:
+    /// transitive callers, and all functions called by any of these. Available in lazy mode.
+    FunctionSet getAffectedFunctions(const FunctionSet& functions) const;
+    /**
+     * \brief Replaces stale results, and results affected by them, with fresh results. Available in lazy mode.
+     * Stale functions and their transitive callers are analysed again. Functions called by these are refreshed only
+     * if the context they get from their callers has changed, thus propagation stops at unchanged contexts.
+     * Results are computed on demand, which analyses all callees of the refreshed functions as well, since cached results
+     * can not serve as callee results for analysis. A stale function called from main thus costs close to a full run.
+     * \return functions results of which have been replaced.
+     */
+    FunctionSet refresh(const FunctionSet& staleFunctions, InputDependencyAnalysisInfo& results);
 
-    void finalizeForArguments(llvm::Function* F, InputDepResType& FA);
-    void finalizeForGlobals(llvm::Function* F, InputDepResType& FA);
+private:
+    void runOnAllFunctions() const;
+    /// Analyses functions needed to get final results for F, when in lazy mode.
+    void runOnDemand(llvm::Function* F) const;
+    void runOnFunction(llvm::Function* F) const;
+    /// Finalizes given functions, which should be given in top-down order.
+    void doFinalization(const std::vector<llvm::Function*>& functions) const;
+    void collectModuleCallers();
+    FunctionSet collectCalledFunctions(llvm::Function* F) const;
+    FunctionSet collectTransitiveCallers(const FunctionSet& functions) const;
+    /// Non library functions transitively called by given functions, including given functions.
+    FunctionSet collectTransitiveCallees(const FunctionSet& functions) const;
+    std::vector<llvm::Function*> getBottomUpOrder(const FunctionSet& functions) const;
+    /// Hash of input dependency of arguments and globals at call sites of F in the given results.
+    uint64_t getCallersContextHash(llvm::Function* F, const InputDependencyAnalysisInfo& results) const;
+
+    /// Analyses invalidated functions and functions affected by them.
+    void runOnInvalidated() const;
+    /// Returns true if results of F callers depend on have changed.
+    bool reanalyzeFunction(llvm::Function* F, FunctionSet& formerCallees) const;
+    void setupFunctionAnaliser(llvm::Function* F, FunctionAnaliser* analyzer) const;
+    void releaseFunctionAnalyses(llvm::Function* F) const;
+
+    /// Returns false if function has already been finalized for the same context
+    bool finalizeFunction(llvm::Function* F, InputDepResType& FA) const;
+    DependencyAnaliser::ArgumentDependenciesMap getInputDepArgumentsInfo(llvm::Function* F) const;
+
+    /// \name Function summaries
+    /// \{
+    bool getFunctionSummaryKey(llvm::Function* F, uint64_t& key) const;
+    bool loadFunctionSummary(llvm::Function* F, FunctionAnaliser* analyzer, uint64_t key) const;
+    void createFunctionSummary(llvm::Function* F, FunctionAnaliser* analyzer, uint64_t key) const;
+    void saveFunctionSummaries() const;
+    /// \}
     using FunctionArgumentsDependencies = std::unordered_map<llvm::Function*, DependencyAnaliser::ArgumentDependenciesMap>;
-    void mergeCallSitesData(llvm::Function* caller, const FunctionSet& calledFunctions);
-    DependencyAnaliser::ArgumentDependenciesMap getFunctionCallInfo(llvm::Function* F);
-    DependencyAnaliser::GlobalVariableDependencyMap getFunctionCallGlobalsInfo(llvm::Function* F);
+    void mergeCallSitesData(llvm::Function* caller, const FunctionSet& calledFunctions) const;
+    DependencyAnaliser::ArgumentDependenciesMap getFunctionCallInfo(llvm::Function* F) const;
+    DependencyAnaliser::GlobalVariableDependencyMap getFunctionCallGlobalsInfo(llvm::Function* F) const;
 
     template <class DependencyMapType>
-    void mergeDependencyMaps(DependencyMapType& mergeTo, const DependencyMapType& mergeFrom);
-    void addMissingGlobalsInfo(llvm::Function* F, DependencyAnaliser::GlobalVariableDependencyMap& globalDeps);
+    void mergeDependencyMaps(DependencyMapType& mergeTo, const DependencyMapType& mergeFrom) const;
+    void addMissingGlobalsInfo(llvm::Function* F, DependencyAnaliser::GlobalVariableDependencyMap& globalDeps) const;
 
 private:
     llvm::Module* m_module;
@@ -85,12 +151,29 @@ private:
     AliasAnalysisInfoGetter m_aliasAnalysisInfoGetter;
     PostDominatorTreeGetter m_postDomTreeGetter;
     DominatorTreeGetter m_domTreeGetter;
+    FunctionAnalysesReleaser m_functionAnalysesReleaser;
+    FunctionAnalysesInvalidator m_functionAnalysesInvalidator;
     // keep these because function analysis is done with two phases, and need to preserve data
-    InputDependencyAnalysisInfo m_functionAnalisers;
-    FunctionArgumentsDependencies m_functionsCallInfo;
-    CalleeCallersMap m_calleeCallersInfo;
-    std::vector<llvm::Function*> m_moduleFunctions;
-    std::unordered_set<llvm::Function*> m_processedInputDepFunctions;
+    mutable InputDependencyAnalysisInfo m_functionAnalisers;
+    mutable FunctionArgumentsDependencies m_functionsCallInfo;
+    mutable CalleeCallersMap m_calleeCallersInfo;
+    // non library functions in call graph SCC order
+    std::vector<llvm::Function*> m_functionsBottomUp;
+    FunctionSet m_moduleFunctions;
+    // end positions of SCCs in m_functionsBottomUp
+    std::vector<unsigned> m_sccEnds;
+    // callers of functions collected from IR, used to find functions needed by on demand analysis
+    mutable CalleeCallersMap m_moduleCallers;
+    mutable bool m_isLazy;
+    mutable FunctionSet m_invalidatedFunctions;
+    mutable std::unordered_set<llvm::Function*> m_processedInputDepFunctions;
+    // hashes of contexts functions have been finalized with
+    mutable std::unordered_map<llvm::Function*, uint64_t> m_finalizationContexts;
+    mutable std::unordered_map<llvm::Function*, unsigned> m_refinalizationCounts;
+    mutable FunctionSummaryStore m_summaryStore;
+    // hash of library config contents, summaries are keyed with
+    uint64_t m_libConfigHash;
+    mutable std::unordered_map<llvm::Function*, FunctionSummaryStore::FunctionSummaryType> m_functionSummaries;
 }; // class InputDependencyAnalysis
 
 
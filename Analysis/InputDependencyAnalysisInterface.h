@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <unordered_map>
 
@@ -38,6 +39,17 @@ public:
     virtual InputDepResType getAnalysisInfo(llvm::Function* F) = 0;
     virtual const InputDepResType getAnalysisInfo(llvm::Function* F) const = 0;
     virtual bool insertAnalysisInfo(llvm::Function* F, InputDepResType analysis_info) = 0;
+
+    /// \name Invalidation interface for transformations changing analysed IR
+    /// \{
+    /// Marks results of F stale. F, and functions depending on its results, are analysed again on next query.
+    /// F may be a new function, e.g. a clone, which has not been analysed yet.
+    virtual void invalidate(llvm::Function* F) = 0;
+    /// Marks results of function containing callSite stale, e.g. after changing called function or arguments.
+    virtual void invalidateCallSite(llvm::Instruction* callSite) = 0;
+    /// Drops results of F, and any references to it. Called before F is erased from the module.
+    virtual void removeFunction(llvm::Function* F) = 0;
+    /// \}
 }; // class InputDependencyAnalysisInterface
 
 } // namespace input_dependency
@@ -1,11 +1,15 @@
 #include "InputDependencyAnalysisPass.h"
 
 #include "InputDependencyAnalysis.h"
+#include "AnalysisProfiler.h"
+#include "CacheFile.h"
 #include "CachedInputDependencyAnalysis.h"
 #include "InputDependencyStatistics.h"
 #include "IndirectCallSitesAnalysis.h"
 #include "InputDepConfig.h"
 #include "InputDepInstructionsRecorder.h"
+#include "ProfilingStatistics.h"
+#include "TraceRecorder.h"
 #include "constants.h"
 
 #include "llvm/Analysis/AliasAnalysis.h"
@@ -14,6 +18,7 @@
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/Debug.h"
@@ -52,17 +57,60 @@ static llvm::cl::opt<std::string> stats_file(
     llvm::cl::desc("Statistics file"),
     llvm::cl::value_desc("file name"));
 
+static llvm::cl::opt<unsigned> stats_top(
+    "dependency-stats-top",
+    llvm::cl::desc("Number of functions with largest memory usage to report in statistics"),
+    llvm::cl::value_desc("number"),
+    llvm::cl::init(10));
+
 static llvm::cl::opt<bool> use_cache(
     "use-cache",
     llvm::cl::desc("Cache input dependency results"),
     llvm::cl::value_desc("boolean flag"));
 
+static llvm::cl::opt<std::string> cache_file(
+    "input-dep-cache-file",
+    llvm::cl::desc("Binary file input dependency results are cached to with -transparent-cache, and read from with -use-cache"),
+    llvm::cl::value_desc("file name"));
+
+static llvm::cl::opt<std::string> summary_file(
+    "input-dep-summaries",
+    llvm::cl::desc("File to load function summaries from and store them to. Functions with unchanged summaries are not analysed again"),
+    llvm::cl::value_desc("file name"));
+
+static llvm::cl::opt<bool> lazy_analysis(
+    "input-dep-lazy",
+    llvm::cl::desc("Analyse functions on demand, when their results are requested"),
+    llvm::cl::value_desc("boolean flag"));
+
+static llvm::cl::list<std::string> query_functions(
+    "input-dep-query",
+    llvm::cl::desc("Functions results of which are requested once the pass has run. With -input-dep-lazy measures cost of on demand queries"),
+    llvm::cl::value_desc("function names"),
+    llvm::cl::CommaSeparated);
+
+static llvm::cl::opt<std::string> profile_file(
+    "input-dep-profile",
+    llvm::cl::desc("File to write time spent in analysis phases and operation counters to, per function. Uses -dependency-stats-format"),
+    llvm::cl::value_desc("file name"));
+
+static llvm::cl::opt<std::string> trace_file(
+    "input-dep-trace",
+    llvm::cl::desc("File to write Chrome trace events of analysis phases to"),
+    llvm::cl::value_desc("file name"));
+
 void configure_run()
 {
     InputDepInstructionsRecorder::get().set_record();
     InputDepConfig::get().set_goto_unsafe(goto_unsafe);
     InputDepConfig::get().set_lib_config_file(libfunction_config);
     InputDepConfig::get().set_use_cache(use_cache);
+    InputDepConfig::get().set_cache_file(cache_file);
+    InputDepConfig::get().set_summary_file(summary_file);
+    InputDepConfig::get().set_lazy_analysis(lazy_analysis);
+    InputDepConfig::get().set_memory_stats(stats);
+    AnalysisProfiler::get().setEnabled(!profile_file.empty());
+    TraceRecorder::get().setEnabled(!trace_file.empty());
 }
 
 char InputDependencyAnalysisPass::ID = 0;
@@ -73,24 +121,33 @@ bool InputDependencyAnalysisPass::runOnModule(llvm::Module& M)
     configure_run();
     m_module = &M;
 
-    llvm::Optional<llvm::BasicAAResult> BAR;
-    llvm::Optional<llvm::AAResults> AAR;
-    auto AARGetter = [&](llvm::Function* F) -> llvm::AAResults* {
-        BAR.emplace(llvm::createLegacyPMBasicAAResult(*this, *F));
-        AAR.emplace(llvm::createLegacyPMAAResults(*this, *F, *BAR));
-        return &*AAR;
-    };
+    // Lazy analysis and refresh of cached results run after runOnModule, thus function analyses are computed by the
+    // pass itself, from IR of a function at the time it is analysed. Module level analyses are captured here.
+    m_TLI = &getAnalysis<llvm::TargetLibraryInfoWrapperPass>().getTLI();
+    m_assumptionCacheTracker = &getAnalysis<llvm::AssumptionCacheTracker>();
+    m_functionAnalyses.clear();
 
-    if (use_cache && has_cached_input_dependency()) {
-        create_cached_input_dependency_analysis();
+    std::shared_ptr<CacheFile> cacheFile;
+    if (use_cache && InputDepConfig::get().has_cache_file()) {
+        cacheFile.reset(new CacheFile());
+        if (!cacheFile->load(InputDepConfig::get().get_cache_file())) {
+            cacheFile.reset();
+        }
+    }
+    if (use_cache && (cacheFile || has_cached_input_dependency())) {
+        create_cached_input_dependency_analysis(cacheFile);
     } else {
         if (use_cache) {
             llvm::dbgs() << "Bitcode does not contain cached information. Running normal input dependency\n";
         }
-        create_input_dependency_analysis(AARGetter);
+        m_analysis.reset(create_input_dependency_analysis());
+        m_analysis->run();
+    }
+    for (const auto& name : query_functions) {
+        if (auto* F = M.getFunction(name)) {
+            m_analysis->getAnalysisInfo(F);
+        }
     }
-
-    m_analysis->run();
     if (stats) {
         dump_statistics();
     }
@@ -98,20 +155,68 @@ bool InputDependencyAnalysisPass::runOnModule(llvm::Module& M)
     return false;
 }
 
+bool InputDependencyAnalysisPass::doFinalization(llvm::Module& M)
+{
+    // written at the end, as lazy analysis runs after runOnModule
+    if (!profile_file.empty()) {
+        dump_profile(M);
+    }
+    if (!trace_file.empty()) {
+        TraceRecorder::get().write(trace_file);
+    }
+    return false;
+}
+
 void InputDependencyAnalysisPass::getAnalysisUsage(llvm::AnalysisUsage& AU) const
 {
     AU.setPreservesCFG();
     AU.addRequired<IndirectCallSitesAnalysis>();
     AU.addRequired<llvm::AssumptionCacheTracker>(); // otherwise run-time error
-    llvm::getAAResultsAnalysisUsage(AU);
+    AU.addRequired<llvm::TargetLibraryInfoWrapperPass>();
     AU.addRequired<llvm::CallGraphWrapperPass>();
     AU.addPreserved<llvm::CallGraphWrapperPass>();
-    AU.addRequired<llvm::LoopInfoWrapperPass>();
-    AU.addRequired<llvm::PostDominatorTreeWrapperPass>();
-    AU.addRequired<llvm::DominatorTreeWrapperPass>();
     AU.setPreservesAll();
 }
 
+InputDependencyAnalysisPass::FunctionAnalyses& InputDependencyAnalysisPass::get_function_analyses(llvm::Function* F)
+{
+    auto pos = m_functionAnalyses.find(F);
+    if (pos != m_functionAnalyses.end() && pos->second.AAResults) {
+        return pos->second;
+    }
+    // released analyses are needed again only to analyse F again, which takes new loop info too
+    FunctionAnalyses& analyses = m_functionAnalyses[F];
+    analyses.domTree.reset(new llvm::DominatorTree(*F));
+    analyses.postDomTree.reset(new llvm::PostDominatorTree());
+    analyses.postDomTree->recalculate(*F);
+    analyses.loopInfo.reset(new llvm::LoopInfo(*analyses.domTree));
+    analyses.basicAAResult.reset(new llvm::BasicAAResult(m_module->getDataLayout(), *m_TLI,
+                                                         m_assumptionCacheTracker->getAssumptionCache(*F),
+                                                         analyses.domTree.get(), analyses.loopInfo.get()));
+    analyses.AAResults.reset(new llvm::AAResults(*m_TLI));
+    analyses.AAResults->addAAResult(*analyses.basicAAResult);
+    return analyses;
+}
+
+void InputDependencyAnalysisPass::release_function_analyses(llvm::Function* F)
+{
+    auto pos = m_functionAnalyses.find(F);
+    if (pos == m_functionAnalyses.end()) {
+        return;
+    }
+    pos->second.AAResults.reset();
+    pos->second.basicAAResult.reset();
+    pos->second.postDomTree.reset();
+    pos->second.domTree.reset();
+}
+
+void InputDependencyAnalysisPass::invalidate_function_analyses(llvm::Function* F)
+{
+    if (m_functionAnalyses.erase(F) != 0) {
+        m_assumptionCacheTracker->getAssumptionCache(*F).clear();
+    }
+}
+
 bool InputDependencyAnalysisPass::has_cached_input_dependency() const
 {
     bool is_cached = false;
@@ -127,23 +232,35 @@ bool InputDependencyAnalysisPass::has_cached_input_dependency() const
     return is_cached;
 }
 
-void InputDependencyAnalysisPass::create_input_dependency_analysis(const InputDependencyAnalysisInterface::AliasAnalysisInfoGetter& AARGetter)
+InputDependencyAnalysis* InputDependencyAnalysisPass::create_input_dependency_analysis()
 {
     llvm::CallGraph* CG = &getAnalysis<llvm::CallGraphWrapperPass>().getCallGraph();
     const auto& indirectCallAnalysis = getAnalysis<IndirectCallSitesAnalysis>();
     const VirtualCallSiteAnalysisResult* virtualCallsInfo = &indirectCallAnalysis.getVirtualsAnalysisResult();
     const IndirectCallSitesAnalysisResult* indirectCallsInfo = &indirectCallAnalysis.getIndirectsAnalysisResult();
+    const auto& AARGetter = [this] (llvm::Function* F)
+    {
+        return this->get_function_analyses(F).AAResults.get();
+    };
     const auto& loopInfoGetter = [this] (llvm::Function* F)
     {
-        return &this->getAnalysis<llvm::LoopInfoWrapperPass>(*F).getLoopInfo();
+        return this->get_function_analyses(F).loopInfo.get();
     };
     const auto& postDomTreeGetter = [this] (llvm::Function* F)
     {
-        return &this->getAnalysis<llvm::PostDominatorTreeWrapperPass>(*F).getPostDomTree();
+        return this->get_function_analyses(F).postDomTree.get();
     };
     const auto& domTreeGetter = [this] (llvm::Function* F)
     {
-        return &this->getAnalysis<llvm::DominatorTreeWrapperPass>(*F).getDomTree();
+        return this->get_function_analyses(F).domTree.get();
+    };
+    const auto& analysesReleaser = [this] (llvm::Function* F)
+    {
+        this->release_function_analyses(F);
+    };
+    const auto& analysesInvalidator = [this] (llvm::Function* F)
+    {
+        this->invalidate_function_analyses(F);
     };
     InputDependencyAnalysis* analysis = new InputDependencyAnalysis(m_module);
     analysis->setCallGraph(CG);
@@ -153,12 +270,22 @@ void InputDependencyAnalysisPass::create_input_dependency_analysis(const InputDe
     analysis->setLoopInfoGetter(loopInfoGetter);
     analysis->setPostDominatorTreeGetter(postDomTreeGetter);
     analysis->setDominatorTreeGetter(domTreeGetter);
-    m_analysis.reset(analysis);
+    analysis->setFunctionAnalysesReleaser(analysesReleaser);
+    analysis->setFunctionAnalysesInvalidator(analysesInvalidator);
+    return analysis;
 }
 
-void InputDependencyAnalysisPass::create_cached_input_dependency_analysis()
+void InputDependencyAnalysisPass::create_cached_input_dependency_analysis(const std::shared_ptr<CacheFile>& cacheFile)
 {
-    m_analysis.reset(new CachedInputDependencyAnalysis(m_module));
+    CachedInputDependencyAnalysis* cachedAnalysis = new CachedInputDependencyAnalysis(m_module, cacheFile);
+    m_analysis.reset(cachedAnalysis);
+    cachedAnalysis->run();
+    // Stale functions are found when their results, or results depending on them, are first requested.
+    // Only these and functions affected by them are analysed, fresh ones keep cached results
+    std::shared_ptr<InputDependencyAnalysis> analysis(create_input_dependency_analysis());
+    analysis->setIsLazy(true);
+    analysis->run();
+    cachedAnalysis->setRefreshAnalysis(analysis);
 }
 
 void InputDependencyAnalysisPass::dump_statistics()
@@ -169,10 +296,19 @@ void InputDependencyAnalysisPass::dump_statistics()
     }
     InputDependencyStatistics stats(stats_format, file_name, m_module, &m_analysis->getAnalysisInfo());
     stats.setSectionName("inputdep_stats");
+    stats.setMemoryTopCount(stats_top);
     stats.report();
     stats.flush();
 }
 
+void InputDependencyAnalysisPass::dump_profile(llvm::Module& M)
+{
+    ProfilingStatistics profile(stats_format, profile_file, &M);
+    profile.report();
+    profile.flush();
+    AnalysisProfiler::get().clear();
+}
+
 static llvm::RegisterPass<InputDependencyAnalysisPass> X("input-dep","runs input dependency analysis");
 
 }
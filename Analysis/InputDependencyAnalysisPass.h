@@ -1,18 +1,27 @@
 #pragma once
 
 #include "InputDependencyAnalysisInterface.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/BasicAliasAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/Pass.h"
 
 #include <memory>
 #include <unordered_map>
 
 namespace llvm {
+class AssumptionCacheTracker;
 class Module;
+class TargetLibraryInfo;
 }
 
 namespace input_dependency {
 
 //class InputDependencyAnalysisInterface;
+class CacheFile;
+class InputDependencyAnalysis;
 
 class InputDependencyAnalysisPass : public llvm::ModulePass
 {
@@ -24,12 +33,15 @@ public:
 
     InputDependencyAnalysisPass()
         : llvm::ModulePass(ID)
+        , m_TLI(nullptr)
+        , m_assumptionCacheTracker(nullptr)
     {
     }
 
 public:
     void getAnalysisUsage(llvm::AnalysisUsage& AU) const override;
     bool runOnModule(llvm::Module& M) override;
+    bool doFinalization(llvm::Module& M) override;
 
 public:
     InputDependencyAnalysisType getInputDependencyAnalysis()
@@ -43,14 +55,41 @@ public:
     }
     
 private:
+    /**
+     * \brief Analyses of a function input dependency analysis uses.
+     * These are computed by the pass itself when the function is analysed, as lazy analysis runs after runOnModule,
+     * when results of other passes are not available anymore. Analyses describe IR of a function at the time they
+     * were computed. Only loop info is used by results of an analysed function, the rest is released.
+     */
+    struct FunctionAnalyses
+    {
+        std::unique_ptr<llvm::DominatorTree> domTree;
+        std::unique_ptr<llvm::PostDominatorTree> postDomTree;
+        std::unique_ptr<llvm::LoopInfo> loopInfo;
+        std::unique_ptr<llvm::BasicAAResult> basicAAResult;
+        std::unique_ptr<llvm::AAResults> AAResults;
+    };
+
+private:
+    /// Computes analyses of F, if not computed yet or released.
+    FunctionAnalyses& get_function_analyses(llvm::Function* F);
+    /// Drops analyses of F needed only during its analysis, keeping loop info.
+    void release_function_analyses(llvm::Function* F);
+    /// Drops analyses of F, to compute them for new IR of F when needed again.
+    void invalidate_function_analyses(llvm::Function* F);
     bool has_cached_input_dependency() const;
-    void create_input_dependency_analysis(const InputDependencyAnalysisInterface::AliasAnalysisInfoGetter& AARGetter);
-    void create_cached_input_dependency_analysis();
+    InputDependencyAnalysis* create_input_dependency_analysis();
+    /// Stale cached functions are re-analysed together with functions affected by them.
+    void create_cached_input_dependency_analysis(const std::shared_ptr<CacheFile>& cacheFile);
     void dump_statistics();
+    void dump_profile(llvm::Module& M);
 
 private:
     llvm::Module* m_module;
     InputDependencyAnalysisType m_analysis;
+    llvm::TargetLibraryInfo* m_TLI;
+    llvm::AssumptionCacheTracker* m_assumptionCacheTracker;
+    std::unordered_map<llvm::Function*, FunctionAnalyses> m_functionAnalyses;
 };
 
 }
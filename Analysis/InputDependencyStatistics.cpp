@@ -1,6 +1,8 @@
 #include "InputDependencyStatistics.h"
 #include "InputDependencyAnalysisPass.h"
 #include "FunctionInputDependencyResultInterface.h"
+#include "FunctionAnaliser.h"
+#include "InputDepConfig.h"
 #include "Utils.h"
 
 #include "llvm/IR/Function.h"
@@ -13,6 +15,8 @@
 #include "llvm/PassRegistry.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
+#include <algorithm>
+
 namespace input_dependency {
 
 namespace {
@@ -24,6 +28,11 @@ unsigned get_function_instrs_count(llvm::Function& F)
     }
     return count;
 }
+
+unsigned to_kb(long unsigned bytes)
+{
+    return (bytes + 1023) / 1024;
+}
 }
 
 InputDependencyStatistics::InputDependencyStatistics(const std::string& format,
@@ -42,6 +51,7 @@ void InputDependencyStatistics::report()
     reportInputDependencyInfo();
     reportInputDepCoverage();
     reportInputInDepCoverage();
+    reportMemoryUsage();
 }
 
 void InputDependencyStatistics::reportInputDependencyInfo()
@@ -150,6 +160,42 @@ void InputDependencyStatistics::reportInputDepCoverage()
     unsetStatsTypeName();
 }
 
+void InputDependencyStatistics::reportMemoryUsage()
+{
+    if (!InputDepConfig::get().is_memory_stats()) {
+        return;
+    }
+    setStatsTypeName("memory_usage");
+    memory_usage_data module_data{m_module->getName(), 0, 0, 0, 0};
+    std::vector<memory_usage_data> functions_data;
+    for (const auto& F_inputDep : *m_IDA) {
+        // cloned and cached results do not track memory
+        auto* FA = F_inputDep.second->toFunctionAnalysisResult();
+        if (!FA) {
+            continue;
+        }
+        memory_usage_data data{F_inputDep.first->getName(), FA->get_memory_usage(), FA->get_peak_memory_usage(),
+                               FA->get_blocks_memory_usage(), FA->get_loops_memory_usage()};
+        module_data.held += data.held;
+        module_data.peak = std::max(module_data.peak, data.peak);
+        module_data.blocks += data.blocks;
+        module_data.loops += data.loops;
+        functions_data.push_back(data);
+    }
+    const unsigned top_count = std::min<unsigned>(m_memory_top_count, functions_data.size());
+    std::partial_sort(functions_data.begin(), functions_data.begin() + top_count, functions_data.end(),
+                      [] (const memory_usage_data& data1, const memory_usage_data& data2)
+                      { return data1.peak > data2.peak; });
+    std::vector<std::string> top_functions;
+    for (unsigned i = 0; i < top_count; ++i) {
+        report_memory_usage_data(functions_data[i]);
+        top_functions.push_back(functions_data[i].name);
+    }
+    report_memory_usage_data(module_data);
+    write_entry(module_data.name, "TopFunctions", top_functions);
+    unsetStatsTypeName();
+}
+
 void InputDependencyStatistics::invalidate_stats_data()
 {
     m_function_input_dep_function_coverage_data.clear();
@@ -194,6 +240,14 @@ void InputDependencyStatistics::report_input_dep_coverage_data(const input_dep_c
     write_entry(data.name, "InstrCoverage", instr_coverage);
 }
 
+void InputDependencyStatistics::report_memory_usage_data(const memory_usage_data& data)
+{
+    write_entry(data.name, "HeldKB", to_kb(data.held));
+    write_entry(data.name, "PeakKB", to_kb(data.peak));
+    write_entry(data.name, "BlocksKB", to_kb(data.blocks));
+    write_entry(data.name, "LoopsKB", to_kb(data.loops));
+}
+
 void InputDependencyStatistics::update_module_coverage_data(
                                      input_dep_coverage_data& module_coverage_data,
                                      const input_dep_coverage_data& function_coverage_data) const
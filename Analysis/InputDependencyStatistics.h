@@ -48,6 +48,15 @@ private:
         unsigned unreachable_instrs;
         unsigned all_instrs;
     };
+
+    struct memory_usage_data
+    {
+        std::string name;
+        long unsigned held;
+        long unsigned peak;
+        long unsigned blocks;
+        long unsigned loops;
+    };
 public:
     InputDependencyStatistics() = default;
     InputDependencyStatistics(const std::string& format,
@@ -75,13 +84,24 @@ public:
     /// by a call to \a invalidate_stats_data function.
     virtual void reportInputDepCoverage();
 
+    /// Reports memory held by results of the module and of \a setMemoryTopCount functions with the largest peak usage,
+    /// split into blocks and loops results. Sizes are estimated, \see MemoryUsage, and are available only if analysis
+    /// has been run with memory statistics enabled in InputDepConfig.
+    virtual void reportMemoryUsage();
+
     /// Invalidates stat data cached so far. Note cached data will persist, unless this function is called.
     virtual void invalidate_stats_data();
 
+    void setMemoryTopCount(unsigned count)
+    {
+        m_memory_top_count = count;
+    }
+
 private:
     void report_inputdep_data(const inputdep_data& data);
     void report_input_indep_coverage_data(const input_indep_coverage_data& data);
     void report_input_dep_coverage_data(const input_dep_coverage_data& data);
+    void report_memory_usage_data(const memory_usage_data& data);
     void update_module_coverage_data(input_dep_coverage_data& module_coverage_data,
                                      const input_dep_coverage_data& function_coverage_data) const;
     void update_module_coverage_data(input_indep_coverage_data& module_coverage_data,
@@ -90,6 +110,7 @@ private:
 private:
     llvm::Module* m_module;
     InputDependencyAnalysisInfo* m_IDA; 
+    unsigned m_memory_top_count = 10;
 
     // caching stats
     std::unordered_map<llvm::Function*, input_indep_coverage_data> m_function_input_indep_function_coverage_data;
@@ -104,6 +125,7 @@ public:
     void reportInputDependencyInfo() override {}
     void reportInputInDepCoverage() override {}
     void reportInputDepCoverage() override {}
+    void reportMemoryUsage() override {}
     void invalidate_stats_data() override {}
 
     void flush() override {}
@@ -1,5 +1,8 @@
 #include "LoopAnalysisResult.h"
 
+#include "AnalysisProfiler.h"
+#include "MemoryUsage.h"
+#include "TraceRecorder.h"
 #include "ReflectingBasicBlockAnaliser.h"
 #include "InputDependentBasicBlockAnaliser.h"
 #include "NonDeterministicReflectingBasicBlockAnaliser.h"
@@ -22,7 +25,6 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
-#include <chrono>
 
 namespace input_dependency {
 
@@ -63,8 +65,8 @@ DepInfo LoopAnalysisResult::getBlockDependencies() const
 
 void LoopAnalysisResult::gatherResults()
 {
-    typedef std::chrono::high_resolution_clock Clock;
-    auto tic = Clock::now();
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::LOOP_FIXPOINT, m_F);
+    TraceRecorder::ScopedSpan span("loop", m_F);
 
     LoopTraversalPathCreator pathCreator(m_LI, m_L);
     pathCreator.construct();
@@ -118,12 +120,6 @@ void LoopAnalysisResult::gatherResults()
     updateCallbacks();
     updateValueDependencies();
     reflectValueDepsOnLoopDeps();
-
-    auto toc = Clock::now();
-    // only for outer most loops, as it includes analysis of child loops
-    if (getenv("LOOP_TIME") && m_L.getLoopDepth() == 1) {
-        llvm::dbgs() << "Loop elapsed time " << std::chrono::duration_cast<std::chrono::nanoseconds>(toc - tic).count() << "\n";
-    }
 }
 
 void LoopAnalysisResult::finalizeResults(const DependencyAnaliser::ArgumentDependenciesMap& dependentArgs)
@@ -163,6 +159,7 @@ void LoopAnalysisResult::setLoopDependencies(const DepInfo& loopDeps)
 void LoopAnalysisResult::setInitialValueDependencies(
             const DependencyAnaliser::ValueDependencies& valueDependencies)
 {
+    AnalysisProfiler::get().count(AnalysisProfiler::MAP_COPIES);
     m_initialDependencies = valueDependencies;
 }
 
@@ -449,6 +446,29 @@ long unsigned LoopAnalysisResult::get_input_unknowns_count() const
     return count;
 }
 
+long unsigned LoopAnalysisResult::get_memory_usage() const
+{
+    long unsigned bytes = sizeof(LoopAnalysisResult)
+                        + MemoryUsage::heapOf(m_latches)
+                        + MemoryUsage::heapOf(m_outArgDependencies)
+                        + MemoryUsage::heapOf(m_returnValueDependencies)
+                        + MemoryUsage::heapOf(m_functionCallInfo)
+                        + MemoryUsage::heapOf(m_calledFunctions)
+                        + MemoryUsage::heapOf(m_initialDependencies)
+                        + MemoryUsage::heapOf(m_valueDependencies)
+                        + MemoryUsage::heapOf(m_functionValues)
+                        + MemoryUsage::heapOf(m_referencedGlobals)
+                        + MemoryUsage::heapOf(m_modifiedGlobals)
+                        + MemoryUsage::heapOf(m_loopBlocks)
+                        + MemoryUsage::heapOf(m_loopDependencies)
+                        + MemoryUsage::heapOf(m_BBAnalisers);
+    // results of blocks and nested loops are owned by the loop
+    for (const auto& analysisRes : m_BBAnalisers) {
+        bytes += analysisRes.second->get_memory_usage();
+    }
+    return bytes;
+}
+
 void LoopAnalysisResult::reflect(const DependencyAnaliser::ValueDependencies& dependencies, const DepInfo& mandatory_deps)
 {
     if (checkForLoopDependencies(dependencies)) {
@@ -467,8 +487,10 @@ bool LoopAnalysisResult::isSpecialLoopBlock(llvm::BasicBlock* B) const
 
 DependencyAnaliser::ValueDependencies LoopAnalysisResult::getBasicBlockPredecessorsDependencies(llvm::BasicBlock* B)
 {
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::PREDECESSOR_MERGE, m_F);
     // predecessor is outside of the loop
     if (m_L.getHeader() == B) {
+        AnalysisProfiler::get().count(AnalysisProfiler::MAP_COPIES);
         return m_initialDependencies;
     }
     // add only values modified (or referenced) in predecessor blocks
@@ -499,6 +521,8 @@ DependencyAnaliser::ValueDependencies LoopAnalysisResult::getBasicBlockPredecess
         } else {
             valueDeps = pos->second->getValuesDependencies();
         }
+        AnalysisProfiler::get().count(AnalysisProfiler::MAP_COPIES);
+        AnalysisProfiler::get().count(AnalysisProfiler::MERGES);
         for (auto& dep : valueDeps) {
             auto pos = deps.insert(dep);
             if (!pos.second) {
@@ -701,6 +725,8 @@ void LoopAnalysisResult::updateModifiedGlobals()
 
 void LoopAnalysisResult::reflect()
 {
+    AnalysisProfiler::ScopedTimer timer(AnalysisProfiler::REFLECTION, m_F);
+    TraceRecorder::ScopedSpan span("reflect", m_F);
     DependencyAnaliser::ValueDependencies valueDependencies;
     for (const auto& latch : m_latches) {
         auto pos = m_BBAnalisers.find(latch);
@@ -715,6 +741,8 @@ void LoopAnalysisResult::reflect()
         }
         assert(pos != m_BBAnalisers.end());
         auto valueDeps = pos->second->getValuesDependencies();
+        AnalysisProfiler::get().count(AnalysisProfiler::MAP_COPIES);
+        AnalysisProfiler::get().count(AnalysisProfiler::MERGES);
         for (const auto& dep : valueDeps) {
             auto res = valueDependencies.insert(dep);
             if (!res.second) {
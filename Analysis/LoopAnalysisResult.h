@@ -94,6 +94,7 @@ public:
     long unsigned get_input_dep_count() const override;
     long unsigned get_input_indep_count() const override;
     long unsigned get_input_unknowns_count() const override;
+    long unsigned get_memory_usage() const override;
 
     /// \}
 
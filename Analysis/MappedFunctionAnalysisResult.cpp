@@ -0,0 +1,318 @@
+#include "MappedFunctionAnalysisResult.h"
+
+#include "CachedFunctionAnalysisResult.h"
+#include "FunctionNumbering.h"
+#include "Utils.h"
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace input_dependency {
+
+MappedFunctionAnalysisResult::MappedFunctionAnalysisResult(llvm::Function* F,
+                                                           const std::shared_ptr<CacheFile>& cacheFile,
+                                                           const CacheFile::FunctionView& view)
+    : m_F(F)
+    , m_cacheFile(cacheFile)
+    , m_view(view)
+    , m_is_inputDep(view.isInputDep())
+    , m_is_extracted(view.isExtracted())
+{
+}
+
+MappedFunctionAnalysisResult::~MappedFunctionAnalysisResult()
+{
+}
+
+bool MappedFunctionAnalysisResult::isUpToDate() const
+{
+    return isValid() || m_fallback->isUpToDate();
+}
+
+llvm::Function* MappedFunctionAnalysisResult::getFunction()
+{
+    return m_F;
+}
+
+const llvm::Function* MappedFunctionAnalysisResult::getFunction() const
+{
+    return m_F;
+}
+
+bool MappedFunctionAnalysisResult::isInputDepFunction() const
+{
+    if (!isValid()) {
+        return m_fallback->isInputDepFunction();
+    }
+    return m_is_inputDep;
+}
+
+void MappedFunctionAnalysisResult::setIsInputDepFunction(bool isInputDep)
+{
+    if (!isValid()) {
+        m_fallback->setIsInputDepFunction(isInputDep);
+    }
+    m_is_inputDep = isInputDep;
+}
+
+bool MappedFunctionAnalysisResult::isExtractedFunction() const
+{
+    if (!isValid()) {
+        return m_fallback->isExtractedFunction();
+    }
+    return m_is_extracted;
+}
+
+void MappedFunctionAnalysisResult::setIsExtractedFunction(bool isExtracted)
+{
+    if (!isValid()) {
+        m_fallback->setIsExtractedFunction(isExtracted);
+    }
+    m_is_extracted = isExtracted;
+}
+
+bool MappedFunctionAnalysisResult::isInputDependent(llvm::Instruction* instr) const
+{
+    return isInputDependent(const_cast<const llvm::Instruction*>(instr));
+}
+
+bool MappedFunctionAnalysisResult::isInputDependent(const llvm::Instruction* instr) const
+{
+    if (!isValid()) {
+        return m_fallback->isInputDependent(instr);
+    }
+    if (isInputDepBlock(instr->getParent())) {
+        return true;
+    }
+    if (isUnreachableBlock(instr->getParent())) {
+        return false;
+    }
+    int index = getNumbering().getInstructionIndex(instr);
+    return index != -1 && m_view.isInputDepInstr(index);
+}
+
+bool MappedFunctionAnalysisResult::isInputIndependent(llvm::Instruction* instr) const
+{
+    return isInputIndependent(const_cast<const llvm::Instruction*>(instr));
+}
+
+bool MappedFunctionAnalysisResult::isInputIndependent(const llvm::Instruction* instr) const
+{
+    if (!isValid()) {
+        return m_fallback->isInputIndependent(instr);
+    }
+    if (isInputDepBlock(instr->getParent()) || isUnreachableBlock(instr->getParent())) {
+        return false;
+    }
+    int index = getNumbering().getInstructionIndex(instr);
+    return index != -1 && m_view.isInputIndepInstr(index);
+}
+
+bool MappedFunctionAnalysisResult::isInputDependentBlock(llvm::BasicBlock* block) const
+{
+    if (!isValid()) {
+        return m_fallback->isInputDependentBlock(block);
+    }
+    return isInputDepBlock(block);
+}
+
+FunctionSet MappedFunctionAnalysisResult::getCallSitesData() const
+{
+    if (!isValid()) {
+        return m_fallback->getCallSitesData();
+    }
+    FunctionSet calledFunctions;
+    for (const auto& callSite : m_view.getCallSites()) {
+        llvm::Instruction* instr = getNumbering().getInstruction(callSite.instrIndex);
+        if (auto* calledF = instr ? FunctionCacheData::getCalledFunction(instr) : nullptr) {
+            calledFunctions.insert(calledF);
+        }
+    }
+    return calledFunctions;
+}
+
+FunctionCallDepInfo MappedFunctionAnalysisResult::getFunctionCallDepInfo(llvm::Function* F) const
+{
+    if (!isValid()) {
+        return m_fallback->getFunctionCallDepInfo(F);
+    }
+    FunctionCallDepInfo callDepInfo(*F);
+    llvm::Module* M = m_F->getParent();
+    for (const auto& callSite : m_view.getCallSites()) {
+        llvm::Instruction* instr = getNumbering().getInstruction(callSite.instrIndex);
+        if (!instr || FunctionCacheData::getCalledFunction(instr) != F || callSite.argsCount != F->arg_size()) {
+            continue;
+        }
+        FunctionCallDepInfo::ArgumentDependenciesMap argDeps;
+        unsigned argNo = 0;
+        for (auto& arg : F->getArgumentList()) {
+            auto dep = FunctionCacheData::testBit(callSite.inputDepArgs, argNo++) ? DepInfo::INPUT_DEP : DepInfo::INPUT_INDEP;
+            argDeps.insert(std::make_pair(&arg, ValueDepInfo(arg.getType(), DepInfo(dep))));
+        }
+        FunctionCallDepInfo::GlobalVariableDependencyMap globalDeps;
+        for (const auto& name : callSite.inputDepGlobals) {
+            if (auto* global = M->getNamedGlobal(name)) {
+                globalDeps.insert(std::make_pair(global, ValueDepInfo(global->getType(), DepInfo(DepInfo::INPUT_DEP))));
+            }
+        }
+        for (const auto& name : callSite.inputIndepGlobals) {
+            if (auto* global = M->getNamedGlobal(name)) {
+                globalDeps.insert(std::make_pair(global, ValueDepInfo(global->getType(), DepInfo(DepInfo::INPUT_INDEP))));
+            }
+        }
+        callDepInfo.addCall(instr, argDeps);
+        callDepInfo.addCall(instr, globalDeps);
+    }
+    return callDepInfo;
+}
+
+bool MappedFunctionAnalysisResult::changeFunctionCall(const llvm::Instruction* callInstr, llvm::Function* oldF, llvm::Function* newF)
+{
+    if (!isValid()) {
+        return m_fallback->changeFunctionCall(callInstr, oldF, newF);
+    }
+    llvm::Instruction* instr = const_cast<llvm::Instruction*>(callInstr);
+    if (FunctionCacheData::getCalledFunction(instr) != oldF) {
+        return false;
+    }
+    if (auto call = llvm::dyn_cast<llvm::CallInst>(instr)) {
+        call->setCalledFunction(newF);
+    } else if (auto invoke = llvm::dyn_cast<llvm::InvokeInst>(instr)) {
+        invoke->setCalledFunction(newF);
+    }
+    return true;
+}
+
+long unsigned MappedFunctionAnalysisResult::get_input_dep_blocks_count() const
+{
+    if (!isValid()) {
+        return m_fallback->get_input_dep_blocks_count();
+    }
+    long unsigned count = 0;
+    for (auto& B : *m_F) {
+        count += isInputDepBlock(&B);
+    }
+    return count;
+}
+
+long unsigned MappedFunctionAnalysisResult::get_input_indep_blocks_count() const
+{
+    if (!isValid()) {
+        return m_fallback->get_input_indep_blocks_count();
+    }
+    long unsigned count = 0;
+    for (auto& B : *m_F) {
+        count += !isInputDepBlock(&B) && !isUnreachableBlock(&B);
+    }
+    return count;
+}
+
+long unsigned MappedFunctionAnalysisResult::get_unreachable_blocks_count() const
+{
+    if (!isValid()) {
+        return m_fallback->get_unreachable_blocks_count();
+    }
+    long unsigned count = 0;
+    for (auto& B : *m_F) {
+        count += isUnreachableBlock(&B);
+    }
+    return count;
+}
+
+long unsigned MappedFunctionAnalysisResult::get_unreachable_instructions_count() const
+{
+    if (!isValid()) {
+        return m_fallback->get_unreachable_instructions_count();
+    }
+    long unsigned count = 0;
+    for (auto& B : *m_F) {
+        if (isUnreachableBlock(&B)) {
+            count += B.size();
+        }
+    }
+    return count;
+}
+
+long unsigned MappedFunctionAnalysisResult::get_input_dep_count() const
+{
+    if (!isValid()) {
+        return m_fallback->get_input_dep_count();
+    }
+    long unsigned count = 0;
+    for (auto& B : *m_F) {
+        for (auto& I : B) {
+            count += isInputDependent(&I);
+        }
+    }
+    return count;
+}
+
+long unsigned MappedFunctionAnalysisResult::get_input_indep_count() const
+{
+    if (!isValid()) {
+        return m_fallback->get_input_indep_count();
+    }
+    long unsigned count = 0;
+    for (auto& B : *m_F) {
+        for (auto& I : B) {
+            count += isInputIndependent(&I);
+        }
+    }
+    return count;
+}
+
+long unsigned MappedFunctionAnalysisResult::get_input_unknowns_count() const
+{
+    if (!isValid()) {
+        return m_fallback->get_input_unknowns_count();
+    }
+    long unsigned count = 0;
+    for (auto& B : *m_F) {
+        if (isUnreachableBlock(&B)) {
+            continue;
+        }
+        for (auto& I : B) {
+            count += !isInputDependent(&I) && !isInputIndependent(&I);
+        }
+    }
+    return count;
+}
+
+// Function is numbered and checked against cached IR hash on first query.
+// Functions changed since caching are answered from IR metadata.
+bool MappedFunctionAnalysisResult::isValid() const
+{
+    std::call_once(m_validated, [this] () {
+        if (m_view.getHash() == Utils::getFunctionHash(m_F)) {
+            m_numbering.reset(new FunctionNumbering(m_F));
+            return;
+        }
+        llvm::dbgs() << "Outdated cache file entry for function " << m_F->getName() << "\n";
+        m_fallback.reset(new CachedFunctionAnalysisResult(m_F));
+    });
+    return m_fallback == nullptr;
+}
+
+const FunctionNumbering& MappedFunctionAnalysisResult::getNumbering() const
+{
+    return *m_numbering;
+}
+
+bool MappedFunctionAnalysisResult::isInputDepBlock(const llvm::BasicBlock* block) const
+{
+    int index = getNumbering().getBlockIndex(block);
+    return index != -1 && m_view.isInputDepBlock(index);
+}
+
+bool MappedFunctionAnalysisResult::isUnreachableBlock(const llvm::BasicBlock* block) const
+{
+    int index = getNumbering().getBlockIndex(block);
+    return index != -1 && m_view.isUnreachableBlock(index);
+}
+
+} // namespace input_dependency
+
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "CacheFile.h"
+#include "FunctionInputDependencyResultInterface.h"
+
+#include <memory>
+#include <mutex>
+
+namespace llvm {
+class Function;
+class BasicBlock;
+class Instruction;
+}
+
+namespace input_dependency {
+
+class CachedFunctionAnalysisResult;
+class FunctionNumbering;
+
+/**
+ * \class MappedFunctionAnalysisResult
+ * \brief Input dependency results of a function answered directly from memory mapped cache file.
+ * Neither IR metadata nor results are decoded, queries map instructions to their ordinals and test bits in the file.
+ * The function is validated against the cached IR hash on the first query.
+ */
+class MappedFunctionAnalysisResult final : public FunctionInputDependencyResultInterface
+{
+public:
+    MappedFunctionAnalysisResult(llvm::Function* F,
+                                 const std::shared_ptr<CacheFile>& cacheFile,
+                                 const CacheFile::FunctionView& view);
+    ~MappedFunctionAnalysisResult();
+
+    /// Returns false if both cached file entry and IR metadata are outdated. Validates the function on first call.
+    bool isUpToDate() const;
+
+public:
+    llvm::Function* getFunction() override;
+    const llvm::Function* getFunction() const override;
+    bool isInputDepFunction() const override;
+    void setIsInputDepFunction(bool isInputDep) override;
+    bool isExtractedFunction() const override;
+    void setIsExtractedFunction(bool isExtracted) override;
+    bool isInputDependent(llvm::Instruction* instr) const override;
+    bool isInputDependent(const llvm::Instruction* instr) const override;
+    bool isInputIndependent(llvm::Instruction* instr) const override;
+    bool isInputIndependent(const llvm::Instruction* instr) const override;
+    bool isInputDependentBlock(llvm::BasicBlock* block) const override;
+    FunctionSet getCallSitesData() const override;
+    FunctionCallDepInfo getFunctionCallDepInfo(llvm::Function* F) const override;
+    bool changeFunctionCall(const llvm::Instruction* callInstr, llvm::Function* oldF, llvm::Function* newF) override;
+
+    long unsigned get_input_dep_blocks_count() const override;
+    long unsigned get_input_indep_blocks_count() const override;
+    long unsigned get_unreachable_blocks_count() const override;
+    long unsigned get_unreachable_instructions_count() const override;
+    long unsigned get_input_dep_count() const override;
+    long unsigned get_input_indep_count() const override;
+    long unsigned get_input_unknowns_count() const override;
+
+private:
+    bool isValid() const;
+    const FunctionNumbering& getNumbering() const;
+    bool isInputDepBlock(const llvm::BasicBlock* block) const;
+    bool isUnreachableBlock(const llvm::BasicBlock* block) const;
+
+private:
+    llvm::Function* m_F;
+    // keeps mapped file alive
+    std::shared_ptr<CacheFile> m_cacheFile;
+    CacheFile::FunctionView m_view;
+    bool m_is_inputDep;
+    bool m_is_extracted;
+    mutable std::once_flag m_validated;
+    // created on first query
+    mutable std::unique_ptr<FunctionNumbering> m_numbering;
+    // results read from IR metadata, if function has changed since caching
+    mutable std::unique_ptr<CachedFunctionAnalysisResult> m_fallback;
+}; // class MappedFunctionAnalysisResult
+
+} // namespace input_dependency
+
@@ -0,0 +1,23 @@
+#include "MemoryUsage.h"
+
+#include "FunctionCallDepInfo.h"
+
+namespace input_dependency {
+
+long unsigned MemoryUsage::heapOf(const DepInfo& depInfo)
+{
+    return heapOf(depInfo.getArgumentDependencies()) + heapOf(depInfo.getValueDependencies());
+}
+
+long unsigned MemoryUsage::heapOf(const ValueDepInfo& depInfo)
+{
+    return heapOf(depInfo.getValueDep()) + heapOf(depInfo.getCompositeValueDeps());
+}
+
+long unsigned MemoryUsage::heapOf(const FunctionCallDepInfo& callDepInfo)
+{
+    return callDepInfo.get_memory_usage() - sizeof(FunctionCallDepInfo);
+}
+
+} // namespace input_dependency
+
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ValueDepInfo.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace input_dependency {
+
+class FunctionCallDepInfo;
+
+/**
+ * \class MemoryUsage
+ * \brief Estimates bytes held by analysis results from sizes of their containers.
+ * Estimates count elements, hash buckets and per node bookkeeping of standard containers, not allocator overhead.
+ */
+class MemoryUsage
+{
+public:
+    // next pointer and cached hash of unordered containers nodes
+    static const long unsigned node_overhead = 2 * sizeof(void*);
+
+public:
+    /// Bytes held by the object, including the object itself.
+    template <class T>
+    static long unsigned of(const T& object)
+    {
+        return sizeof(T) + heapOf(object);
+    }
+
+    /// \name Bytes allocated by the object, excluding the object itself.
+    /// \{
+    template <class T>
+    static long unsigned heapOf(const T&)
+    {
+        return 0;
+    }
+
+    static long unsigned heapOf(const DepInfo& depInfo);
+    static long unsigned heapOf(const ValueDepInfo& depInfo);
+    static long unsigned heapOf(const FunctionCallDepInfo& callDepInfo);
+
+    template <class T>
+    static long unsigned heapOf(const std::vector<T>& elements)
+    {
+        long unsigned bytes = elements.capacity() * sizeof(T);
+        for (const auto& element : elements) {
+            bytes += heapOf(element);
+        }
+        return bytes;
+    }
+
+    template <class Key, class... Rest>
+    static long unsigned heapOf(const std::unordered_set<Key, Rest...>& set)
+    {
+        return set.bucket_count() * sizeof(void*) + set.size() * (sizeof(Key) + node_overhead);
+    }
+
+    template <class Key, class Value, class... Rest>
+    static long unsigned heapOf(const std::unordered_map<Key, Value, Rest...>& map)
+    {
+        long unsigned bytes = map.bucket_count() * sizeof(void*)
+                            + map.size() * (sizeof(std::pair<const Key, Value>) + node_overhead);
+        for (const auto& item : map) {
+            bytes += heapOf(item.second);
+        }
+        return bytes;
+    }
+    /// \}
+}; // class MemoryUsage
+
+} // namespace input_dependency
+
@@ -0,0 +1,56 @@
+#include "ProfilingStatistics.h"
+
+#include "llvm/IR/Module.h"
+
+namespace input_dependency {
+
+namespace {
+
+double to_milliseconds(uint64_t nanoseconds)
+{
+    return nanoseconds / 1000000.0;
+}
+
+}
+
+ProfilingStatistics::ProfilingStatistics(const std::string& format,
+                                         const std::string& file_name,
+                                         llvm::Module* M)
+    : Statistics(format, file_name)
+    , m_module(M)
+{
+    setSectionName("input_dependency_profile");
+}
+
+void ProfilingStatistics::report()
+{
+    report_profile_data(m_module->getName().str(), AnalysisProfiler::get().getModuleProfile());
+    for (const auto& item : AnalysisProfiler::get().getFunctionProfiles()) {
+        report_profile_data(item.second.name, item.second.data);
+    }
+    unsetStatsTypeName();
+}
+
+void ProfilingStatistics::report_profile_data(const std::string& name, const AnalysisProfiler::ProfileData& data)
+{
+    setStatsTypeName("time_ms");
+    for (unsigned i = 0; i < AnalysisProfiler::PHASES_COUNT; ++i) {
+        const auto& phase_data = data.phases[i];
+        if (phase_data.calls == 0) {
+            continue;
+        }
+        const std::string phase_name = AnalysisProfiler::getPhaseName(static_cast<AnalysisProfiler::Phase>(i));
+        write_entry(name, phase_name, to_milliseconds(phase_data.inclusiveNs));
+        write_entry(name, phase_name + "_self", to_milliseconds(phase_data.selfNs));
+        write_entry(name, phase_name + "_calls", static_cast<unsigned>(phase_data.calls));
+    }
+    setStatsTypeName("counters");
+    for (unsigned i = 0; i < AnalysisProfiler::COUNTERS_COUNT; ++i) {
+        write_entry(name,
+                    AnalysisProfiler::getCounterName(static_cast<AnalysisProfiler::Counter>(i)),
+                    static_cast<unsigned>(data.counters[i]));
+    }
+}
+
+} // namespace input_dependency
+
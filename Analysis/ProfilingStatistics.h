@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Statistics.h"
+#include "AnalysisProfiler.h"
+
+#include <string>
+
+namespace llvm {
+class Module;
+}
+
+namespace input_dependency {
+
+/// Reports phase times and counters collected by AnalysisProfiler, per function and for the whole module.
+class ProfilingStatistics : public Statistics
+{
+public:
+    ProfilingStatistics(const std::string& format,
+                        const std::string& file_name,
+                        llvm::Module* M);
+
+public:
+    void report() override;
+
+private:
+    void report_profile_data(const std::string& name, const AnalysisProfiler::ProfileData& data);
+
+private:
+    llvm::Module* m_module;
+};
+
+} // namespace input_dependency
+
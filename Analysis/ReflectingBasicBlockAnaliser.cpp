@@ -1,6 +1,7 @@
 #include "ReflectingBasicBlockAnaliser.h"
 
 #include "IndirectCallSitesAnalysis.h"
+#include "MemoryUsage.h"
 #include "value_dependence_graph.h"
 
 #include "llvm/ADT/SCCIterator.h"
@@ -287,6 +288,19 @@ void ReflectingBasicBlockAnaliser::setOutArguments(const ArgumentDependenciesMap
     }
 }
 
+long unsigned ReflectingBasicBlockAnaliser::get_memory_usage() const
+{
+    return sizeof(ReflectingBasicBlockAnaliser)
+        + getDependenciesMemoryUsage()
+        + MemoryUsage::heapOf(m_valueDependentInstrs)
+        + MemoryUsage::heapOf(m_valueDependentOutArguments)
+        + MemoryUsage::heapOf(m_valueDependentFunctionCallArguments)
+        + MemoryUsage::heapOf(m_valueDependentFunctionInvokeArguments)
+        + MemoryUsage::heapOf(m_valueDependentCallGlobals)
+        + MemoryUsage::heapOf(m_valueDependentInvokeGlobals)
+        + MemoryUsage::heapOf(m_instructionValueDependencies);
+}
+
 DepInfo ReflectingBasicBlockAnaliser::getInstructionDependencies(llvm::Instruction* instr)
 {
     auto deppos = m_inputDependentInstrs.find(instr);
@@ -43,6 +43,7 @@ public:
     DepInfo getInstructionDependencies(llvm::Instruction* instr) const override;
     void markAllInputDependent() override;
     void setOutArguments(const ArgumentDependenciesMap& outArgs) override;
+    long unsigned get_memory_usage() const override;
 
     /// \name Implementation of DependencyAnaliser interface
     /// \{
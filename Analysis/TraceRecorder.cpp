@@ -0,0 +1,127 @@
+#include "TraceRecorder.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "json/json.hpp"
+
+#include <fstream>
+
+using json = nlohmann::json;
+
+namespace input_dependency {
+
+namespace {
+
+// buffer of the current thread, owned by the recorder
+thread_local TraceRecorder::ThreadBuffer* thread_buffer = nullptr;
+
+}
+
+TraceRecorder::ScopedSpan::ScopedSpan(const char* category, const llvm::Function* F)
+    : m_active(TraceRecorder::get().isEnabled())
+    , m_category(category)
+{
+    if (!m_active) {
+        return;
+    }
+    m_name = F ? std::string(category) + " " + F->getName().str() : std::string(category);
+    m_start = Clock::now();
+}
+
+TraceRecorder::ScopedSpan::ScopedSpan(const char* category, const std::string& name)
+    : m_active(TraceRecorder::get().isEnabled())
+    , m_category(category)
+{
+    if (!m_active) {
+        return;
+    }
+    m_name = name;
+    m_start = Clock::now();
+}
+
+TraceRecorder::ScopedSpan::~ScopedSpan()
+{
+    if (!m_active) {
+        return;
+    }
+    auto& recorder = TraceRecorder::get();
+    double start = recorder.toMicroseconds(m_start);
+    double end = recorder.toMicroseconds(Clock::now());
+    recorder.addEvent(Event{std::move(m_name), m_category, start, end - start});
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    ThreadBuffer* buffer = m_buffers.load();
+    while (buffer) {
+        ThreadBuffer* next = buffer->next;
+        delete buffer;
+        buffer = next;
+    }
+}
+
+void TraceRecorder::setEnabled(bool enabled)
+{
+    if (enabled && !m_enabled) {
+        m_start = Clock::now();
+    }
+    m_enabled = enabled;
+}
+
+bool TraceRecorder::write(const std::string& file_name)
+{
+    std::ofstream ofs(file_name, std::ofstream::out);
+    if (!ofs.is_open()) {
+        llvm::dbgs() << "Could not open trace file " << file_name << "\n";
+        return false;
+    }
+    json events = json::array();
+    for (ThreadBuffer* buffer = m_buffers.load(); buffer; buffer = buffer->next) {
+        for (const auto& event : buffer->events) {
+            json value;
+            value["name"] = event.name;
+            value["cat"] = event.category;
+            value["ph"] = "X";
+            value["ts"] = event.start;
+            value["dur"] = event.duration;
+            value["pid"] = 1;
+            value["tid"] = buffer->threadId;
+            events.push_back(value);
+        }
+        buffer->events.clear();
+    }
+    json root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+    ofs << root.dump();
+    return true;
+}
+
+void TraceRecorder::addEvent(Event&& event)
+{
+    getThreadBuffer()->events.push_back(std::move(event));
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::getThreadBuffer()
+{
+    if (thread_buffer) {
+        return thread_buffer;
+    }
+    ThreadBuffer* buffer = new ThreadBuffer{m_threadsCount++, std::vector<Event>(), nullptr};
+    // buffers are only added, never removed while tracing, thus simple push is enough
+    buffer->next = m_buffers.load();
+    while (!m_buffers.compare_exchange_weak(buffer->next, buffer)) {
+    }
+    thread_buffer = buffer;
+    return buffer;
+}
+
+double TraceRecorder::toMicroseconds(Clock::time_point time) const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_start).count() / 1000.0;
+}
+
+} // namespace input_dependency
+
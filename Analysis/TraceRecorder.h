@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Function;
+}
+
+namespace input_dependency {
+
+/**
+ * \class TraceRecorder
+ * \brief Records spans of analysis work and writes them as Chrome trace events JSON,
+ * viewable in chrome://tracing or Perfetto.
+ * Each thread appends completed spans to its own buffer without locking. Buffers are registered once per thread
+ * with an atomic push, and are written out by \a write, which should be called once traced work has finished.
+ */
+class TraceRecorder
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Event
+    {
+        std::string name;
+        const char* category;
+        // microseconds since recorder has been enabled
+        double start;
+        double duration;
+    };
+
+    struct ThreadBuffer
+    {
+        unsigned threadId;
+        std::vector<Event> events;
+        ThreadBuffer* next;
+    };
+
+    /// Records a span for its lifetime. Span name is the category followed by function name, if any.
+    class ScopedSpan
+    {
+    public:
+        ScopedSpan(const char* category, const llvm::Function* F);
+        ScopedSpan(const char* category, const std::string& name);
+        ~ScopedSpan();
+
+        ScopedSpan(const ScopedSpan&) = delete;
+        ScopedSpan& operator =(const ScopedSpan&) = delete;
+
+    private:
+        bool m_active;
+        const char* m_category;
+        std::string m_name;
+        Clock::time_point m_start;
+    };
+
+public:
+    static TraceRecorder& get()
+    {
+        static TraceRecorder recorder;
+        return recorder;
+    }
+
+    ~TraceRecorder();
+
+public:
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const
+    {
+        return m_enabled;
+    }
+
+    /// Writes all recorded events and clears buffers. Returns false if file can not be written.
+    bool write(const std::string& file_name);
+
+private:
+    TraceRecorder() = default;
+
+    void addEvent(Event&& event);
+    ThreadBuffer* getThreadBuffer();
+    double toMicroseconds(Clock::time_point time) const;
+
+private:
+    bool m_enabled = false;
+    Clock::time_point m_start;
+    std::atomic<ThreadBuffer*> m_buffers{nullptr};
+    std::atomic<unsigned> m_threadsCount{0};
+};
+
+} // namespace input_dependency
+
@@ -3,6 +3,9 @@
 #include "InputDependencyAnalysisInterface.h"
 #include "FunctionInputDependencyResultInterface.h"
 #include "BasicBlocksUtils.h"
+#include "CacheFile.h"
+#include "InputDepConfig.h"
+#include "FunctionCacheData.h"
 
 #include "Utils.h"
 #include "constants.h"
@@ -10,11 +13,17 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Metadata.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace input_dependency {
 
+static llvm::cl::opt<bool> per_instruction_cache(
+    "cache-per-instruction",
+    llvm::cl::desc("Cache input dependency results as metadata attached to each instruction, instead of one compact metadata tuple per function"),
+    llvm::cl::value_desc("boolean flag"));
+
 void TransparentCachingPass::getAnalysisUsage(llvm::AnalysisUsage& AU) const
 {
     AU.addRequired<InputDependencyAnalysisPass>();
@@ -27,7 +36,26 @@ bool TransparentCachingPass::runOnModule(llvm::Module& M)
     auto IDA = getAnalysis<InputDependencyAnalysisPass>().getInputDependencyAnalysis();
     const auto& functionAnalisers = IDA->getAnalysisInfo();
 
+    if (InputDepConfig::get().has_cache_file()) {
+        CacheFile::FunctionsData functions_data;
+        for (auto& FA_item : functionAnalisers) {
+            functions_data.push_back(std::make_pair(FA_item.first->getName().str(),
+                                                    FunctionCacheData::collect(FA_item.first, *FA_item.second)));
+        }
+        CacheFile::write(InputDepConfig::get().get_cache_file(), functions_data);
+    }
+
     M.addModuleFlag(llvm::Module::ModFlagBehavior::Error, metadata_strings::cached_input_dep, true);
+    if (!per_instruction_cache) {
+        for (auto& FA_item : functionAnalisers) {
+            llvm::Function* F = FA_item.first;
+            llvm::dbgs() << "Caching input dependency for function " << F->getName() << "\n";
+            const auto& data = FunctionCacheData::collect(F, *FA_item.second);
+            F->setMetadata(metadata_strings::input_dep_cache, data.toMetadata(M.getContext()));
+        }
+        return true;
+    }
+
     auto* input_dep_function_md_str = llvm::MDString::get(M.getContext(), metadata_strings::input_dep_function);
     llvm::MDNode* input_dep_function_md = llvm::MDNode::get(M.getContext(), input_dep_function_md_str);
     auto* input_indep_function_md_str = llvm::MDString::get(M.getContext(), metadata_strings::input_indep_function);
@@ -85,7 +113,7 @@ bool TransparentCachingPass::runOnModule(llvm::Module& M)
             }
         }
     }
-
+    return true;
 }
 
 char TransparentCachingPass::ID = 0;
@@ -1,9 +1,12 @@
 #include "Utils.h"
 
 #include "DependencyInfo.h"
+#include "FunctionNumbering.h"
 
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/Argument.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 
 #include "llvm/Support/Debug.h"
@@ -109,5 +112,72 @@ std::string Utils::demangle_name(const std::string& name)
     return std::string();
 }
 
+uint64_t Utils::hashCombine(uint64_t seed, uint64_t value)
+{
+    // FNV-1a over bytes of value
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t hash = seed ? seed : 14695981039346656037ULL;
+    for (unsigned i = 0; i < sizeof(value); ++i) {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= prime;
+    }
+    return hash;
+}
+
+uint64_t Utils::hashString(const std::string& str, uint64_t seed)
+{
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t hash = seed ? seed : 14695981039346656037ULL;
+    for (const auto& c : str) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= prime;
+    }
+    return hashCombine(hash, str.size());
 }
 
+uint64_t Utils::getFunctionHash(llvm::Function* F)
+{
+    auto type_to_string = [] (llvm::Type* type) {
+        std::string str;
+        llvm::raw_string_ostream stream(str);
+        type->print(stream);
+        return stream.str();
+    };
+
+    FunctionNumbering numbering(F);
+    uint64_t hash = hashString(type_to_string(F->getFunctionType()));
+    hash = hashCombine(hash, numbering.getBlocksCount());
+    for (auto& B : *F) {
+        hash = hashCombine(hash, B.size());
+        for (auto& I : B) {
+            hash = hashCombine(hash, I.getOpcode());
+            hash = hashString(type_to_string(I.getType()), hash);
+            if (auto* cmp = llvm::dyn_cast<llvm::CmpInst>(&I)) {
+                hash = hashCombine(hash, cmp->getPredicate());
+            }
+            for (auto& op : I.operands()) {
+                llvm::Value* val = op.get();
+                if (auto* instr = llvm::dyn_cast<llvm::Instruction>(val)) {
+                    hash = hashCombine(hashCombine(hash, 1), numbering.getInstructionIndex(instr));
+                } else if (auto* block = llvm::dyn_cast<llvm::BasicBlock>(val)) {
+                    hash = hashCombine(hashCombine(hash, 2), numbering.getBlockIndex(block));
+                } else if (auto* arg = llvm::dyn_cast<llvm::Argument>(val)) {
+                    hash = hashCombine(hashCombine(hash, 3), arg->getArgNo());
+                } else if (auto* global = llvm::dyn_cast<llvm::GlobalValue>(val)) {
+                    hash = hashString(global->getName().str(), hashCombine(hash, 4));
+                } else if (auto* constant = llvm::dyn_cast<llvm::Constant>(val)) {
+                    std::string str;
+                    llvm::raw_string_ostream stream(str);
+                    constant->print(stream);
+                    hash = hashString(stream.str(), hashCombine(hash, 5));
+                } else {
+                    // metadata operands are ignored
+                    hash = hashCombine(hash, 6);
+                }
+            }
+        }
+    }
+    return hash;
+}
+
+}
@@ -3,6 +3,9 @@
 #include "definitions.h"
 #include "DependencyAnaliser.h"
 
+#include <cstdint>
+#include <string>
+
 namespace llvm {
 class Loop;
 }
@@ -23,6 +26,14 @@ public:
     static int getLoopDepthDiff(llvm::Loop* loop1, llvm::Loop* loop2);
 
     static std::string demangle_name(const std::string& name);
+
+    /// \name Stable hashing helpers, results do not change between runs
+    /// \{
+    static uint64_t hashCombine(uint64_t seed, uint64_t value);
+    static uint64_t hashString(const std::string& str, uint64_t seed = 0);
+    /// Structural hash of function body. Ignores value names and metadata.
+    static uint64_t getFunctionHash(llvm::Function* F);
+    /// \}
 }; // class Utils
 
 } // namespace input_dependency
@@ -3,6 +3,7 @@
 namespace input_dependency {
 
 const std::string metadata_strings::cached_input_dep = "cached_input_dep";
+const std::string metadata_strings::input_dep_cache = "input_dep_cache";
 const std::string metadata_strings::input_dep_function = "input_dep_function";
 const std::string metadata_strings::input_indep_function = "input_indep_function";
 const std::string metadata_strings::input_dep_block = "input_dep_block";
@@ -9,6 +9,7 @@ namespace input_dependency {
 class metadata_strings {
 public:
     const static std::string cached_input_dep;
+    const static std::string input_dep_cache;
     const static std::string input_dep_function;
     const static std::string input_indep_function;
     const static std::string input_dep_block;
@@ -9,22 +9,87 @@
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/Debug.h" 
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Analysis/LoopInfo.h"
 
 //#include "CutVertice/CutVerticesPass.h"
 #include "Analysis/InputDependencyAnalysis.h"
 
+#include <unordered_map>
+#include <vector>
+
 using namespace llvm;
+
+static cl::opt<bool> InlineHash(
+    "oh-inline-hash",
+    cl::desc("Accumulate hash of a function inline, adding it to the global hash at function exits, calls and check points, instead of calling hashMe functions"),
+    cl::value_desc("boolean flag"));
+
+static cl::opt<bool> LoopHash(
+    "oh-loop-hash",
+    cl::desc("Hash loop invariant values once in loop preheaders, and other values of a loop block with one combined update per iteration"),
+    cl::value_desc("boolean flag"));
+
+static cl::opt<unsigned> LoopHashStride(
+    "oh-loop-stride",
+    cl::desc("With -oh-loop-hash, update hash in innermost loops only every n-th iteration. 0 or 1 for every iteration"),
+    cl::value_desc("stride"),
+    cl::init(0));
+
+static cl::opt<bool> ThreadHash(
+    "oh-threads",
+    cl::desc("Hash into thread local accumulators of rtlib. Enabled by default for modules creating threads"),
+    cl::value_desc("boolean flag"));
+
 namespace {
 	struct OHPass : public FunctionPass {
 		static char ID;
 
                 unsigned count;
+		// module creates threads, thus hash is updated with thread safe functions of rtlib
+		bool threadedModule;
+		// accumulator of the function hash in inline hashing mode
+		AllocaInst* localHash;
+		// iteration counters of innermost loops, used for sampling with -oh-loop-stride
+		std::unordered_map<Loop*, AllocaInst*> strideCounters;
+		// combined loop block updates, sampled once all blocks are instrumented, as sampling splits blocks
+		struct SampledUpdate {
+			Value* condition;
+			Value* value;
+			Instruction* insertBefore;
+		};
+		std::vector<SampledUpdate> sampledUpdates;
 		OHPass()
                     : FunctionPass(ID)
                     , count(0)
+                    , threadedModule(false)
+                    , localHash(nullptr)
                 {}
+		virtual bool doInitialization(Module &M){
+			threadedModule = ThreadHash || createsThreads(M);
+			if (threadedModule) {
+				dbgs() << "Hashing with thread local accumulators\n";
+			}
+			return false;
+		}
 		virtual bool runOnFunction(Function &F){
 			bool didModify = false;
+			if (InlineHash) {
+				createLocalHash(F);
+				didModify = true;
+			}
+			std::vector<Instruction*> flushPoints;
+			LoopInfo& LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+			strideCounters.clear();
+			sampledUpdates.clear();
+			// instructions are collected first, as hashing inserts new ones after them, and in loop preheaders
+			std::unordered_map<BasicBlock*, std::vector<Instruction*>> blockInstructions;
+			for (auto& B : F) {
+				auto& instructions = blockInstructions[&B];
+				for (auto& I : B) {
+					instructions.push_back(&I);
+				}
+			}
 			for (auto& B : F) {
                 auto FI = getAnalysis<input_dependency::InputDependencyAnalysisPass>().getInputDependencyAnalysis()->getAnalysisInfo(&F);
 				//std::vector<const char*> CutVertices=getAnalysis<CutVerticesPass>().getArray();
@@ -32,28 +97,50 @@ namespace {
 				//	B.getName())!=CutVertices.end()){
 				//	errs() << "Cut Vertices: " << B.getName() << "\n";
 				//}
-				for (auto& I : B) {
-					//dbgs() << I << I.getOpcodeName() << "\n";
-                                        if (FI->isInputDependent(&I)) {
+				const auto& instructions = blockInstructions[&B];
+				Loop* L = LoopHash ? LI.getLoopFor(&B) : nullptr;
+				std::vector<Value*> loopValues;
+				for (auto* I : instructions) {
+					//dbgs() << *I << I->getOpcodeName() << "\n";
+					if (needsFlush(I)) {
+						if (InlineHash) {
+							flushPoints.push_back(I);
+						}
+						// callee check points see values hashed so far
+						updateLoopHash(L, loopValues, I);
+					}
+                                        if (FI->isInputDependent(I)) {
                                             continue;
                                         }
-					if (auto* op = dyn_cast<BinaryOperator>(&I)) {
+					if (L) {
+						didModify |= collectLoopHash(L, I, loopValues);
+						continue;
+					}
+					if (auto* op = dyn_cast<BinaryOperator>(I)) {
 						// Insert *after* `op`.
-						updateHash(&B, &I, op, false);
+						updateHash(&B, I, op, false);
 						didModify =true;
-					} else if (CmpInst* cmpInst = dyn_cast<CmpInst>(&I)){
+					} else if (CmpInst* cmpInst = dyn_cast<CmpInst>(I)){
 						didModify = handleCmp(cmpInst,&B);
-					} else if (StoreInst* storeInst = dyn_cast<StoreInst>(&I)){
+					} else if (StoreInst* storeInst = dyn_cast<StoreInst>(I)){
 						didModify = handleStore(storeInst, &B);
 					} //TODO: else if (handle switch case and other conditions)
 					//terminator indicates the last block
-					//else if(ReturnInst *RI = dyn_cast<ReturnInst>(&I)){
+					//else if(ReturnInst *RI = dyn_cast<ReturnInst>(I)){
 					//	// Insert *before* ret
 					//	dbgs() << "**returnInst**\n";
 					//	printHash(&B, RI, true);	
 					//	didModify = true;
 					//}
 				}
+				updateLoopHash(L, loopValues, B.getTerminator());
+			}
+			for (const auto& update : sampledUpdates) {
+				auto* thenTerm = SplitBlockAndInsertIfThen(update.condition, update.insertBefore, false);
+				updateHash(thenTerm->getParent(), thenTerm, update.value, true);
+			}
+			for (auto* I : flushPoints) {
+				flushLocalHash(I);
 			}
                         printHash(&F.back(), count);
                         ++count;
@@ -63,7 +150,11 @@ namespace {
 		virtual void getAnalysisUsage(AnalysisUsage &AU) const {
 			//AU.addRequired<CutVerticesPass>();
 			AU.addRequired<input_dependency::InputDependencyAnalysisPass>();
-			AU.setPreservesAll();
+			AU.addRequired<LoopInfoWrapperPass>();
+			// sampled calls of hashMe functions are guarded by branches
+			if (!samplesWithBranches()) {
+				AU.setPreservesAll();
+			}
 		}
 
 		bool handleStore(StoreInst *storeInst, BasicBlock *BB){
@@ -101,33 +192,185 @@ namespace {
 		}
 		void updateHash(BasicBlock *BB, Instruction *I, 
 				Value *value, bool insertBeforeInstruction){
+			if (InlineHash) {
+				updateLocalHash(BB, I, value, insertBeforeInstruction);
+				return;
+			}
 			LLVMContext& Ctx = BB->getParent()->getContext();
 			// get BB parent -> Function -> get parent -> Module	
 			Constant* hashFunc;
                         if (value->getType()->isIntegerTy(32)) {
                             llvm::dbgs() << "hash me for integer\n";
                             hashFunc = BB->getParent()->getParent()->getOrInsertFunction(
-                                    "hashMeInt", Type::getVoidTy(Ctx), Type::getInt32Ty(Ctx), NULL);
+                                    threadedModule ? "hashMeIntMT" : "hashMeInt", Type::getVoidTy(Ctx), Type::getInt32Ty(Ctx), NULL);
                         } else if (value->getType()->isIntegerTy(64)) {
                             llvm::dbgs() << "hash me for long integer\n";
                             hashFunc = BB->getParent()->getParent()->getOrInsertFunction(
-                                    "hashMeLong", Type::getVoidTy(Ctx), Type::getInt64Ty(Ctx), NULL);
+                                    threadedModule ? "hashMeLongMT" : "hashMeLong", Type::getVoidTy(Ctx), Type::getInt64Ty(Ctx), NULL);
                         } else {
                             llvm::dbgs() << "skip hashing for type " << *value->getType();
                             return;
                         }
 
 			IRBuilder <> builder(I);
-			auto insertPoint = ++builder.GetInsertPoint();
-			if(insertBeforeInstruction){
-				insertPoint--;
-				insertPoint--;
+			if(!insertBeforeInstruction){
+				builder.SetInsertPoint(BB, ++builder.GetInsertPoint());
 			}
 			Value *args = {value};
-			builder.SetInsertPoint(BB, insertPoint);
 			//printArg(BB, &builder, value->getName());
 			builder.CreateCall(hashFunc, args);
 		}
+		// Value hashed for instruction, matching handleStore and handleCmp
+		Value* getHashedValue(Instruction *I){
+			Value* value = nullptr;
+			if (isa<BinaryOperator>(I)) {
+				value = I;
+			} else if (auto* cmpInst = dyn_cast<CmpInst>(I)) {
+				value = cmpInst->getOperand(0);
+			} else if (auto* storeInst = dyn_cast<StoreInst>(I)) {
+				value = storeInst->getValueOperand();
+			}
+			if (!value || (!value->getType()->isIntegerTy(32) && !value->getType()->isIntegerTy(64))) {
+				return nullptr;
+			}
+			return value;
+		}
+		// Hashes loop invariant value of I in the preheader of the outermost loop it is invariant in.
+		// Other values are collected to be hashed with one update per block execution.
+		bool collectLoopHash(Loop *L, Instruction *I, std::vector<Value*>& loopValues){
+			Value* value = getHashedValue(I);
+			if (!value) {
+				return false;
+			}
+			Loop* hoistLoop = nullptr;
+			while (L && L->isLoopInvariant(value) && L->getLoopPreheader()) {
+				hoistLoop = L;
+				L = L->getParentLoop();
+			}
+			if (hoistLoop) {
+				auto* preheader = hoistLoop->getLoopPreheader();
+				updateHash(preheader, preheader->getTerminator(), value, true);
+			} else {
+				loopValues.push_back(value);
+			}
+			return true;
+		}
+		// All collected values dominate insertBefore, as they are defined in, or used by, its block before it
+		void updateLoopHash(Loop *L, std::vector<Value*>& loopValues, Instruction *insertBefore){
+			if (loopValues.empty()) {
+				return;
+			}
+			LLVMContext& Ctx = insertBefore->getContext();
+			IRBuilder <> builder(insertBefore);
+			Value* hash = nullptr;
+			for (auto* value : loopValues) {
+				Value* hashValue = builder.CreateSExt(value, Type::getInt64Ty(Ctx));
+				hash = hash ? builder.CreateAdd(hash, hashValue) : hashValue;
+			}
+			loopValues.clear();
+			if (LoopHashStride <= 1 || !L->getSubLoops().empty()) {
+				updateHash(insertBefore->getParent(), insertBefore, hash, true);
+				return;
+			}
+			Value* iteration = builder.CreateLoad(getStrideCounter(L));
+			Value* stride = ConstantInt::get(Type::getInt64Ty(Ctx), LoopHashStride);
+			Value* sampled = builder.CreateICmpEQ(builder.CreateURem(iteration, stride),
+			                                      ConstantInt::get(Type::getInt64Ty(Ctx), 0));
+			if (samplesWithBranches()) {
+				sampledUpdates.push_back(SampledUpdate{sampled, hash, insertBefore});
+				return;
+			}
+			// inline update is cheaper than a branch, and keeps the CFG
+			hash = builder.CreateSelect(sampled, hash, ConstantInt::get(Type::getInt64Ty(Ctx), 0));
+			updateHash(insertBefore->getParent(), insertBefore, hash, true);
+		}
+		bool samplesWithBranches() const {
+			return LoopHash && LoopHashStride > 1 && !InlineHash;
+		}
+		// Counter is incremented in the loop header, and is not reset on loop entry
+		AllocaInst* getStrideCounter(Loop *L){
+			auto pos = strideCounters.find(L);
+			if (pos != strideCounters.end()) {
+				return pos->second;
+			}
+			Function* F = L->getHeader()->getParent();
+			LLVMContext& Ctx = F->getContext();
+			IRBuilder<> builder(&*F->getEntryBlock().getFirstInsertionPt());
+			auto* counter = builder.CreateAlloca(Type::getInt64Ty(Ctx), nullptr, "oh.iteration");
+			builder.CreateStore(ConstantInt::get(Type::getInt64Ty(Ctx), 0), counter);
+			builder.SetInsertPoint(&*L->getHeader()->getFirstInsertionPt());
+			Value* iteration = builder.CreateAdd(builder.CreateLoad(counter), ConstantInt::get(Type::getInt64Ty(Ctx), 1));
+			builder.CreateStore(iteration, counter);
+			strideCounters.insert(std::make_pair(L, counter));
+			return counter;
+		}
+		// Inline hashing keeps the hash of the function in a local accumulator, which is promoted to a register
+		// by mem2reg, and adds it to the global hash of rtlib only where the global hash may be observed.
+		void createLocalHash(Function &F){
+			LLVMContext& Ctx = F.getContext();
+			IRBuilder<> builder(&*F.getEntryBlock().getFirstInsertionPt());
+			localHash = builder.CreateAlloca(Type::getInt64Ty(Ctx), nullptr, "oh.hash");
+			builder.CreateStore(ConstantInt::get(Type::getInt64Ty(Ctx), 0), localHash);
+		}
+		void updateLocalHash(BasicBlock *BB, Instruction *I,
+				Value *value, bool insertBeforeInstruction){
+			// same values as hashed by hashMeInt and hashMeLong
+			if (!value->getType()->isIntegerTy(32) && !value->getType()->isIntegerTy(64)) {
+				llvm::dbgs() << "skip hashing for type " << *value->getType();
+				return;
+			}
+			LLVMContext& Ctx = BB->getParent()->getContext();
+			IRBuilder <> builder(I);
+			if(!insertBeforeInstruction){
+				builder.SetInsertPoint(BB, ++builder.GetInsertPoint());
+			}
+			Value *hashValue = builder.CreateSExt(value, Type::getInt64Ty(Ctx));
+			Value *hash = builder.CreateLoad(localHash);
+			builder.CreateStore(builder.CreateAdd(hash, hashValue), localHash);
+		}
+		// Global hash is observed by check points, i.e. logHash calls, which may be reached through any call
+		bool needsFlush(Instruction *I){
+			if (isa<ReturnInst>(I) || isa<ResumeInst>(I)) {
+				return true;
+			}
+			Function* calledF = nullptr;
+			if (auto* callInst = dyn_cast<CallInst>(I)) {
+				calledF = callInst->getCalledFunction();
+			} else if (auto* invokeInst = dyn_cast<InvokeInst>(I)) {
+				calledF = invokeInst->getCalledFunction();
+			} else {
+				return false;
+			}
+			return !calledF || !calledF->isIntrinsic();
+		}
+		void flushLocalHash(Instruction *I){
+			LLVMContext& Ctx = I->getContext();
+			Type* hashType = Type::getInt64Ty(Ctx);
+			IRBuilder <> builder(I);
+			if (threadedModule) {
+				// global hash would be updated concurrently
+				Constant* hashFunc = I->getModule()->getOrInsertFunction(
+						"hashMeLongMT", Type::getVoidTy(Ctx), hashType, NULL);
+				Value *args = {builder.CreateLoad(localHash)};
+				builder.CreateCall(hashFunc, args);
+				builder.CreateStore(ConstantInt::get(hashType, 0), localHash);
+				return;
+			}
+			Value* globalHash = I->getModule()->getOrInsertGlobal("hash", hashType);
+			Value *hash = builder.CreateAdd(builder.CreateLoad(globalHash), builder.CreateLoad(localHash));
+			builder.CreateStore(hash, globalHash);
+			builder.CreateStore(ConstantInt::get(hashType, 0), localHash);
+		}
+		// Threads may also be created in other modules, -oh-threads is needed for those
+		bool createsThreads(Module &M){
+			for (auto& F : M) {
+				const auto& name = F.getName();
+				if (name == "pthread_create" || name == "thrd_create" || name.startswith("_ZNSt6thread")) {
+					return true;
+				}
+			}
+			return false;
+		}
 		void printArg(BasicBlock *BB, IRBuilder<> *builder, std::string valueName){
 			LLVMContext &context = BB->getParent()->getContext();;
 			std::vector<llvm::Type *> args;
@@ -158,7 +401,10 @@ namespace {
                         std::vector<llvm::Value*> arg_values;
                         arg_values.push_back(llvm::ConstantInt::get(llvm::Type::getInt32Ty(Ctx), count));
                         llvm::ArrayRef<llvm::Value*> args(arg_values);
-			builder.CreateCall(logHashFunc, args);	
+			auto* logHashCall = builder.CreateCall(logHashFunc, args);	
+			if (InlineHash) {
+				flushLocalHash(logHashCall);
+			}
 		}
 	};
 }
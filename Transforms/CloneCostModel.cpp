@@ -0,0 +1,238 @@
+#include "CloneCostModel.h"
+#include "Utils.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace oh {
+
+CloneCostModel::CloneCostModel(const Options& options, unsigned module_instrs_count)
+    : m_options(options)
+    , m_module_instrs_count(module_instrs_count)
+    , m_reservedInstrs(0)
+{
+}
+
+namespace {
+
+FunctionClone::mask get_all_input_dep_mask(unsigned size)
+{
+    FunctionClone::mask m(size);
+    for (unsigned i = 0; i < size; ++i) {
+        m.set(i);
+    }
+    return m;
+}
+
+}
+
+void CloneCostModel::addCallSite(llvm::Function* callee, const FunctionClone::mask& m, llvm::Instruction* callSite)
+{
+    // no clone is made for all input dependent arguments.
+    // Masks of callees without arguments can not be merged to the original, they are cloned as they are.
+    if (m.empty() || m.all()) {
+        return;
+    }
+    auto& masks = m_functionMasks[callee];
+    auto res = masks.insert(std::make_pair(m, MaskInfo{0, m}));
+    res.first->second.calls += getCallCount(callSite);
+}
+
+void CloneCostModel::plan()
+{
+    for (auto& item : m_functionMasks) {
+        m_decisions.requested_masks += item.second.size();
+        planFunction(item.first, item.second);
+    }
+    allocateBudget();
+}
+
+const FunctionClone::mask& CloneCostModel::getCloneMask(llvm::Function* callee, const FunctionClone::mask& m) const
+{
+    auto f_pos = m_functionMasks.find(callee);
+    if (f_pos == m_functionMasks.end()) {
+        return m;
+    }
+    auto pos = f_pos->second.find(m);
+    if (pos == f_pos->second.end()) {
+        return m;
+    }
+    return pos->second.clone_mask;
+}
+
+bool CloneCostModel::reserveClone(llvm::Function* callee, const FunctionClone::mask& clone_mask)
+{
+    const unsigned instrs_count = getInstrsCount(callee);
+    auto pos = m_plannedClones.find(callee);
+    const bool is_planned = pos != m_plannedClones.end() && pos->second.find(clone_mask) != pos->second.end();
+    if (!is_planned) {
+        if (m_options.growth_budget != 0 && m_reservedInstrs + instrs_count > getBudget()) {
+            ++m_decisions.rejected_clones;
+            return false;
+        }
+        m_reservedInstrs += instrs_count;
+    }
+    m_decisions.cloned_instrs += instrs_count;
+    return true;
+}
+
+void CloneCostModel::allocateBudget()
+{
+    if (m_options.growth_budget == 0) {
+        return;
+    }
+    struct PlannedClone
+    {
+        llvm::Function* F;
+        FunctionClone::mask clone_mask;
+        double benefit;
+    };
+    std::vector<PlannedClone> clones;
+    for (auto& item : m_functionMasks) {
+        std::unordered_map<FunctionClone::mask, uint64_t, FunctionClone::mask::Hasher> clone_calls;
+        for (const auto& mask_item : item.second) {
+            if (!mask_item.second.clone_mask.all()) {
+                clone_calls[mask_item.second.clone_mask] += mask_item.second.calls;
+            }
+        }
+        const double instrs_count = std::max(getInstrsCount(item.first), 1u);
+        for (const auto& clone_item : clone_calls) {
+            const double benefit = getBenefit(clone_item.first, MaskInfo{clone_item.second, clone_item.first});
+            clones.push_back(PlannedClone{item.first, clone_item.first, benefit / instrs_count});
+        }
+    }
+    std::sort(clones.begin(), clones.end(),
+              [] (const PlannedClone& clone1, const PlannedClone& clone2)
+              {
+                  // names and masks break ties, to make decisions independent of hashing
+                  if (clone1.benefit != clone2.benefit) {
+                      return clone1.benefit > clone2.benefit;
+                  }
+                  if (clone1.F != clone2.F) {
+                      return clone1.F->getName() < clone2.F->getName();
+                  }
+                  return clone1.clone_mask < clone2.clone_mask;
+              });
+    const uint64_t budget = getBudget();
+    for (const auto& clone : clones) {
+        const unsigned instrs_count = getInstrsCount(clone.F);
+        if (m_reservedInstrs + instrs_count <= budget) {
+            m_reservedInstrs += instrs_count;
+            m_plannedClones[clone.F].insert(clone.clone_mask);
+            continue;
+        }
+        // calls of a clone without budget use the original function
+        ++m_decisions.rejected_clones;
+        for (auto& mask_item : m_functionMasks[clone.F]) {
+            if (mask_item.second.clone_mask == clone.clone_mask) {
+                mask_item.second.clone_mask = get_all_input_dep_mask(clone.clone_mask.size());
+            }
+        }
+    }
+}
+
+unsigned CloneCostModel::getInstrsCount(llvm::Function* F)
+{
+    auto pos = m_instrsCount.find(F);
+    if (pos == m_instrsCount.end()) {
+        pos = m_instrsCount.insert(std::make_pair(F, Utils::get_function_instrs_count(*F))).first;
+    }
+    return pos->second;
+}
+
+uint64_t CloneCostModel::getBudget() const
+{
+    return static_cast<uint64_t>(m_module_instrs_count) * m_options.growth_budget / 100;
+}
+
+uint64_t CloneCostModel::getCallCount(llvm::Instruction* callSite)
+{
+    uint64_t count = 0;
+    if (callSite->extractProfTotalWeight(count)) {
+        return count;
+    }
+    // without call site weights every call of a function is assumed to run as often as the function itself
+    auto* prof = callSite->getParent()->getParent()->getMetadata(llvm::LLVMContext::MD_prof);
+    if (prof && prof->getNumOperands() == 2) {
+        auto* name = llvm::dyn_cast<llvm::MDString>(prof->getOperand(0));
+        if (name && name->getString() == "function_entry_count") {
+            auto* entry_count = llvm::mdconst::dyn_extract<llvm::ConstantInt>(prof->getOperand(1));
+            if (entry_count) {
+                return entry_count->getZExtValue();
+            }
+        }
+    }
+    return 1;
+}
+
+void CloneCostModel::planFunction(llvm::Function* F, FunctionMasks& masks)
+{
+    if (masks.empty()) {
+        return;
+    }
+    std::vector<FunctionMasks::iterator> ordered;
+    for (auto it = masks.begin(); it != masks.end(); ++it) {
+        ordered.push_back(it);
+    }
+    std::sort(ordered.begin(), ordered.end(),
+              [] (const FunctionMasks::iterator& it1, const FunctionMasks::iterator& it2)
+              {
+                  const double benefit1 = getBenefit(it1->first, it1->second);
+                  const double benefit2 = getBenefit(it2->first, it2->second);
+                  // masks order breaks ties, to make decisions independent of hashing
+                  return benefit1 > benefit2 || (benefit1 == benefit2 && it1->first < it2->first);
+              });
+
+    const double instrs_count = std::max(getInstrsCount(F), 1u);
+    std::vector<FunctionMasks::iterator> kept;
+    std::vector<FunctionMasks::iterator> merged;
+    for (const auto& it : ordered) {
+        const bool low_benefit = getBenefit(it->first, it->second) / instrs_count < m_options.min_benefit;
+        const bool over_limit = m_options.max_masks != 0 && kept.size() >= m_options.max_masks;
+        if (low_benefit || over_limit) {
+            merged.push_back(it);
+        } else {
+            kept.push_back(it);
+        }
+    }
+    if (merged.empty()) {
+        return;
+    }
+    // merged clone takes a slot of the least beneficial kept mask
+    if (m_options.max_masks != 0 && kept.size() == m_options.max_masks) {
+        merged.push_back(kept.back());
+        kept.pop_back();
+    }
+    FunctionClone::mask superset;
+    uint64_t calls = 0;
+    for (const auto& it : merged) {
+        superset |= it->first;
+        calls += it->second.calls;
+    }
+    // calls of a low benefit merged clone, including a single low benefit mask, use the original function
+    if (getBenefit(superset, MaskInfo{calls, superset}) / instrs_count < m_options.min_benefit) {
+        superset = get_all_input_dep_mask(superset.size());
+    } else if (merged.size() == 1) {
+        return;
+    }
+    for (auto& it : merged) {
+        it->second.clone_mask = superset;
+    }
+    m_decisions.merged_masks += merged.size();
+}
+
+double CloneCostModel::getBenefit(const FunctionClone::mask& m, const MaskInfo& info)
+{
+    // calls with more input independent arguments make more of the clone input independent
+    const unsigned indep_args = m.size() - m.count();
+    return static_cast<double>(info.calls) * (indep_args + 1);
+}
+
+}
+
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "FunctionClone.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace llvm {
+class Function;
+class Instruction;
+}
+
+namespace oh {
+
+/**
+ * \class CloneCostModel
+ * \brief Decides which argument masks of a function are worth a clone.
+ *
+ * Benefit of a mask is the number of its calls, taken from PGO !prof metadata if present, weighted by the number of
+ * input independent arguments it makes known. Cost of each clone is the instruction count of the original function.
+ * Per function, masks with benefit per cloned instruction below the minimum, and masks beyond the most beneficial
+ * \a max_masks, are merged into a single conservative clone, treating an argument input dependent if it is input
+ * dependent in any merged mask. If the merged clone, or a single merged mask, is itself below the minimum benefit,
+ * its calls use the original function. Code growth of all clones is limited by a budget relative to module size,
+ * given to planned clones of the whole module in order of their benefit per cloned instruction.
+ */
+class CloneCostModel
+{
+public:
+    struct Options
+    {
+        // allowed growth of module instructions count in percent, 0 for no limit
+        unsigned growth_budget;
+        // maximum number of clones per function, including the merged one, 0 for no limit
+        unsigned max_masks;
+        // minimum benefit per cloned instruction, masks with lower benefit are merged
+        double min_benefit;
+    };
+
+    struct Decisions
+    {
+        unsigned requested_masks = 0;
+        unsigned merged_masks = 0;
+        unsigned rejected_clones = 0;
+        unsigned cloned_instrs = 0;
+    };
+
+public:
+    CloneCostModel(const Options& options, unsigned module_instrs_count);
+
+public:
+    /// Registers call of \p callee for argument mask \p m at \p callSite. Callees without arguments are not registered.
+    void addCallSite(llvm::Function* callee, const FunctionClone::mask& m, llvm::Instruction* callSite);
+
+    /// Decides masks to clone for, and reserves budget for their clones, once all call sites are registered.
+    void plan();
+
+    /// Returns mask to clone \p callee for, when called with argument mask \p m.
+    /// Masks not registered before planning are cloned as they are, as long as budget allows.
+    const FunctionClone::mask& getCloneMask(llvm::Function* callee, const FunctionClone::mask& m) const;
+
+    /// Reserves budget for a clone of \p callee for \p clone_mask. Returns false if clone would exceed the budget.
+    /// Budget of planned clones is reserved by planning, unplanned ones take what remains.
+    bool reserveClone(llvm::Function* callee, const FunctionClone::mask& clone_mask);
+
+    const Decisions& getDecisions() const
+    {
+        return m_decisions;
+    }
+
+    /// Number of calls of \p callSite from PGO metadata, or from entry count of its function. 1 if not profiled.
+    static uint64_t getCallCount(llvm::Instruction* callSite);
+
+private:
+    struct MaskInfo
+    {
+        uint64_t calls;
+        FunctionClone::mask clone_mask;
+    };
+    using FunctionMasks = std::unordered_map<FunctionClone::mask, MaskInfo, FunctionClone::mask::Hasher>;
+    using MaskSet = std::unordered_set<FunctionClone::mask, FunctionClone::mask::Hasher>;
+
+    void planFunction(llvm::Function* F, FunctionMasks& masks);
+    /// Gives growth budget to planned clones by benefit. Calls of clones left without budget use the original.
+    void allocateBudget();
+    unsigned getInstrsCount(llvm::Function* F);
+    uint64_t getBudget() const;
+    static double getBenefit(const FunctionClone::mask& m, const MaskInfo& info);
+
+private:
+    Options m_options;
+    unsigned m_module_instrs_count;
+    std::unordered_map<llvm::Function*, FunctionMasks> m_functionMasks;
+    std::unordered_map<llvm::Function*, unsigned> m_instrsCount;
+    // clone masks budget is reserved for by planning
+    std::unordered_map<llvm::Function*, MaskSet> m_plannedClones;
+    uint64_t m_reservedInstrs;
+    Decisions m_decisions;
+}; // class CloneCostModel
+
+}
+
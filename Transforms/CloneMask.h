@@ -0,0 +1,158 @@
+#pragma once
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+
+#include <cstdint>
+#include <string>
+
+namespace oh {
+
+/**
+ * \class CloneMask
+ * \brief Packed bitmask of input dependent arguments of a call.
+ * Masks of up to 64 arguments are stored inline, wider masks, e.g. of variadic calls, fall back to heap storage.
+ * Bits past the size are kept zero, so that masks can be compared and hashed word by word.
+ */
+class CloneMask
+{
+public:
+    class Hasher
+    {
+    public:
+        std::size_t operator() (const CloneMask& m) const
+        {
+            uint64_t hash = m.m_size;
+            for (const auto& word : m.m_words) {
+                hash ^= word + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+            }
+            return hash;
+        }
+    };
+
+public:
+    CloneMask()
+        : m_size(0)
+    {
+    }
+
+    explicit CloneMask(unsigned size)
+        : m_size(size)
+        , m_words(getWordsCount(size), 0)
+    {
+    }
+
+public:
+    unsigned size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    /// New bits are false.
+    void resize(unsigned size)
+    {
+        m_words.resize(getWordsCount(size), 0);
+        m_size = size;
+        clearUnusedBits();
+    }
+
+    bool test(unsigned index) const
+    {
+        return (m_words[index / word_bits] >> (index % word_bits)) & 1;
+    }
+
+    void set(unsigned index, bool value = true)
+    {
+        const uint64_t bit = uint64_t(1) << (index % word_bits);
+        if (value) {
+            m_words[index / word_bits] |= bit;
+        } else {
+            m_words[index / word_bits] &= ~bit;
+        }
+    }
+
+    /// Returns true if mask is not empty and all its bits are set.
+    bool all() const
+    {
+        return !empty() && count() == m_size;
+    }
+
+    /// Number of set bits.
+    unsigned count() const
+    {
+        unsigned bits = 0;
+        for (const auto& word : m_words) {
+            bits += llvm::countPopulation(word);
+        }
+        return bits;
+    }
+
+    /// Union of masks, the result has size of the wider one.
+    CloneMask& operator |=(const CloneMask& m)
+    {
+        if (m_size < m.m_size) {
+            resize(m.m_size);
+        }
+        for (unsigned i = 0; i < m.m_words.size(); ++i) {
+            m_words[i] |= m.m_words[i];
+        }
+        return *this;
+    }
+
+    bool operator ==(const CloneMask& m) const
+    {
+        return m_size == m.m_size && m_words == m.m_words;
+    }
+
+    bool operator !=(const CloneMask& m) const
+    {
+        return !(*this == m);
+    }
+
+    bool operator <(const CloneMask& m) const
+    {
+        if (m_size != m.m_size) {
+            return m_size < m.m_size;
+        }
+        return m_words < m.m_words;
+    }
+
+    /// Bits as 0 and 1 characters, first argument first.
+    std::string to_string() const
+    {
+        std::string str(m_size, '0');
+        for (unsigned i = 0; i < m_size; ++i) {
+            if (test(i)) {
+                str[i] = '1';
+            }
+        }
+        return str;
+    }
+
+private:
+    static const unsigned word_bits = 64;
+
+    static unsigned getWordsCount(unsigned size)
+    {
+        return (size + word_bits - 1) / word_bits;
+    }
+
+    void clearUnusedBits()
+    {
+        if (m_size % word_bits != 0) {
+            m_words.back() &= (uint64_t(1) << (m_size % word_bits)) - 1;
+        }
+    }
+
+private:
+    unsigned m_size;
+    llvm::SmallVector<uint64_t, 1> m_words;
+}; // class CloneMask
+
+}
+
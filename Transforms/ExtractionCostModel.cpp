@@ -0,0 +1,190 @@
+#include "ExtractionCostModel.h"
+
+#include "Analysis/FunctionInputDependencyResultInterface.h"
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+
+#include <unordered_set>
+
+namespace oh {
+
+namespace {
+
+// a call and a return, plus per argument its pointer handling in the extracted function and the store back
+const unsigned call_overhead = 2;
+const unsigned argument_overhead = 6;
+
+}
+
+ExtractionCostModel::ExtractionCostModel(const Options& options, llvm::Function& F, const InputDepRes& input_dep_info)
+    : m_options(options)
+    , m_F(F)
+    , m_input_dep_info(input_dep_info)
+    , m_domTree(F)
+    , m_loopInfo(m_domTree)
+    , m_probabilityInfo(F, m_loopInfo)
+    , m_frequencyInfo(F, m_probabilityInfo, m_loopInfo)
+{
+}
+
+ExtractionCostModel::SnippetList ExtractionCostModel::plan(const SnippetList& snippets)
+{
+    SnippetList planned;
+    std::unordered_set<llvm::Loop*> hoisted_loops;
+    std::unordered_set<llvm::Loop*> kept_loops;
+    std::unordered_set<Snippet*> loop_snippets;
+    for (const auto& snippet : snippets) {
+        // single instruction snippets are never extracted
+        if (!snippet || snippet->is_single_instr_snippet()) {
+            planned.push_back(snippet);
+            continue;
+        }
+        llvm::BasicBlock* block = snippet->get_begin_block();
+        if (!is_hot(block) || is_cheap(*snippet)) {
+            planned.push_back(snippet);
+            ++m_decisions.extracted;
+            continue;
+        }
+        llvm::Loop* L = get_hoist_loop(m_loopInfo.getLoopFor(block));
+        if (hoisted_loops.find(L) != hoisted_loops.end()) {
+            ++m_decisions.hoisted;
+            continue;
+        }
+        if (kept_loops.find(L) != kept_loops.end()) {
+            ++m_decisions.kept;
+            continue;
+        }
+        SnippetType loop_snippet = create_loop_snippet(L, snippets);
+        if (!loop_snippet) {
+            kept_loops.insert(L);
+            ++m_decisions.kept;
+            continue;
+        }
+        hoisted_loops.insert(L);
+        ++m_decisions.hoisted;
+        ++m_decisions.hoisted_loops;
+        loop_snippets.insert(loop_snippet.get());
+        planned.push_back(loop_snippet);
+    }
+    // cold snippets planned before their loop got hoisted are extracted with the loop
+    for (auto& snippet : planned) {
+        if (!snippet || snippet->is_single_instr_snippet() || loop_snippets.find(snippet.get()) != loop_snippets.end()) {
+            continue;
+        }
+        for (const auto& L : hoisted_loops) {
+            if (L->contains(snippet->get_begin_block())) {
+                snippet.reset();
+                --m_decisions.extracted;
+                ++m_decisions.hoisted;
+                break;
+            }
+        }
+    }
+    return planned;
+}
+
+double ExtractionCostModel::get_frequency(const llvm::BasicBlock* block) const
+{
+    const uint64_t entry_frequency = m_frequencyInfo.getEntryFreq();
+    if (entry_frequency == 0) {
+        return 0;
+    }
+    return static_cast<double>(m_frequencyInfo.getBlockFreq(block).getFrequency()) / entry_frequency;
+}
+
+bool ExtractionCostModel::is_hot(const llvm::BasicBlock* block) const
+{
+    return m_loopInfo.getLoopDepth(block) != 0 && get_frequency(block) >= m_options.hot_frequency;
+}
+
+bool ExtractionCostModel::is_cheap(const Snippet& snippet) const
+{
+    if (m_options.max_overhead == 0) {
+        return true;
+    }
+    Snippet::ValueSet used_values;
+    snippet.compute_used_values(nullptr, used_values);
+    const unsigned overhead = call_overhead + argument_overhead * used_values.size();
+    return overhead * 100 <= m_options.max_overhead * snippet.get_instructions_number();
+}
+
+llvm::Loop* ExtractionCostModel::get_hoist_loop(llvm::Loop* L) const
+{
+    // the extracted loop is called once per execution of its preheader
+    while (L->getParentLoop()) {
+        llvm::BasicBlock* preheader = L->getLoopPreheader();
+        if (preheader && !is_hot(preheader)) {
+            break;
+        }
+        L = L->getParentLoop();
+    }
+    return L;
+}
+
+ExtractionCostModel::SnippetType ExtractionCostModel::create_loop_snippet(llvm::Loop* L, const SnippetList& snippets) const
+{
+    if (!L->getExitBlock() || !L->getLoopPreheader() || !can_hoist(L, snippets)) {
+        return SnippetType();
+    }
+    // validated as snippets collected by SnippetsCreator
+    SnippetType loop_snippet(new BasicBlocksSnippet(&m_F,
+                                                    L->getHeader()->getIterator(),
+                                                    L->getExitBlock()->getIterator(),
+                                                    InstructionsSnippet()));
+    if (!loop_snippet->is_valid_snippet()) {
+        return SnippetType();
+    }
+    loop_snippet->expand();
+    loop_snippet->adjust_end();
+    if (!loop_snippet->is_valid_snippet()) {
+        return SnippetType();
+    }
+    return loop_snippet;
+}
+
+bool ExtractionCostModel::can_hoist(llvm::Loop* L, const SnippetList& snippets) const
+{
+    llvm::BasicBlock* exit_block = L->getExitBlock();
+    for (const auto& snippet : snippets) {
+        if (!snippet) {
+            continue;
+        }
+        // snippets starting in the loop are extracted with it, thus may not leave it
+        if (L->contains(snippet->get_begin_block())) {
+            llvm::BasicBlock* end_block = snippet->get_end_block();
+            if (end_block != exit_block && !L->contains(end_block)) {
+                return false;
+            }
+            continue;
+        }
+        // snippets starting before the loop would extract its blocks twice
+        if (L->contains(snippet->get_end_block())) {
+            return false;
+        }
+        for (auto* block : L->blocks()) {
+            if (snippet->contains_block(block)) {
+                return false;
+            }
+        }
+    }
+    unsigned instrs_count = 0;
+    unsigned input_dep_count = 0;
+    for (auto* block : L->blocks()) {
+        instrs_count += block->size();
+        if (m_input_dep_info->isInputDependentBlock(block)) {
+            input_dep_count += block->size();
+            continue;
+        }
+        for (auto& I : *block) {
+            if (m_input_dep_info->isInputDependent(&I)) {
+                ++input_dep_count;
+            }
+        }
+    }
+    return input_dep_count * 100 >= m_options.hoist_min_dep * instrs_count;
+}
+
+}
+
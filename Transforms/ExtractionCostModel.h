@@ -0,0 +1,98 @@
+#pragma once
+
+#include "FunctionSnippet.h"
+#include "Analysis/InputDependencyAnalysisInterface.h"
+
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+
+#include <memory>
+#include <vector>
+
+namespace llvm {
+class BasicBlock;
+class Function;
+}
+
+namespace oh {
+
+/**
+ * \class ExtractionCostModel
+ * \brief Decides whether snippets of a function are extracted, hoisted to their enclosing loop, or left in place.
+ *
+ * Extraction adds a call and argument marshaling to every execution of a snippet. A snippet in a loop block running at
+ * least \a hot_frequency times per function entry, estimated from !prof metadata or from static loop heuristics, is
+ * extracted only if this overhead is at most \a max_overhead percent of its size. Otherwise its enclosing loop, up to
+ * the innermost one entered from a cold block, is extracted as a whole, if at least \a hoist_min_dep percent of the
+ * loop instructions are input dependent. Remaining hot snippets are left in place.
+ */
+class ExtractionCostModel
+{
+public:
+    struct Options
+    {
+        // allowed instructions added per execution of a hot snippet, in percent of its size. 0 for no limit
+        unsigned max_overhead;
+        // executions per function entry from which a loop block is hot
+        double hot_frequency;
+        // minimum percent of input dependent instructions of a loop extracted instead of its hot snippets
+        unsigned hoist_min_dep;
+    };
+
+    struct Decisions
+    {
+        unsigned extracted = 0;
+        unsigned hoisted = 0;
+        unsigned hoisted_loops = 0;
+        unsigned kept = 0;
+
+        Decisions& operator +=(const Decisions& decisions)
+        {
+            extracted += decisions.extracted;
+            hoisted += decisions.hoisted;
+            hoisted_loops += decisions.hoisted_loops;
+            kept += decisions.kept;
+            return *this;
+        }
+    };
+
+    using SnippetType = std::shared_ptr<Snippet>;
+    using SnippetList = std::vector<SnippetType>;
+    using InputDepRes = input_dependency::InputDependencyAnalysisInterface::InputDepResType;
+
+public:
+    /// Reads IR only, thus models of different functions can be built in parallel.
+    ExtractionCostModel(const Options& options, llvm::Function& F, const InputDepRes& input_dep_info);
+
+public:
+    /// Returns snippets to extract. Hot snippets are dropped, or replaced by snippets of loops they are hoisted to.
+    SnippetList plan(const SnippetList& snippets);
+
+    const Decisions& getDecisions() const
+    {
+        return m_decisions;
+    }
+
+private:
+    double get_frequency(const llvm::BasicBlock* block) const;
+    bool is_hot(const llvm::BasicBlock* block) const;
+    bool is_cheap(const Snippet& snippet) const;
+    llvm::Loop* get_hoist_loop(llvm::Loop* L) const;
+    SnippetType create_loop_snippet(llvm::Loop* L, const SnippetList& snippets) const;
+    bool can_hoist(llvm::Loop* L, const SnippetList& snippets) const;
+
+private:
+    Options m_options;
+    llvm::Function& m_F;
+    InputDepRes m_input_dep_info;
+    llvm::DominatorTree m_domTree;
+    llvm::LoopInfo m_loopInfo;
+    llvm::BranchProbabilityInfo m_probabilityInfo;
+    llvm::BlockFrequencyInfo m_frequencyInfo;
+    Decisions m_decisions;
+}; // class ExtractionCostModel
+
+}
+
@@ -27,7 +27,16 @@ llvm::Function* FunctionClone::getClonedFunction(const mask& m) const
 {
     auto pos = m_clones.find(m);
     assert(pos != m_clones.end());
-    return pos->second.first;
+    return pos->second.F;
+}
+
+const llvm::ValueToValueMapTy* FunctionClone::getValueMap(const mask& m) const
+{
+    auto pos = m_clones.find(m);
+    if (pos == m_clones.end()) {
+        return nullptr;
+    }
+    return pos->second.VMap.get();
 }
 
 llvm::Function* FunctionClone::doCloneForMask(const mask& m)
@@ -35,23 +44,24 @@ llvm::Function* FunctionClone::doCloneForMask(const mask& m)
     if (hasCloneForMask(m)) {
         return getClonedFunction(m);
     }
-    llvm::ValueToValueMapTy* VMap = new llvm::ValueToValueMapTy();
+    std::unique_ptr<llvm::ValueToValueMapTy> VMap(new llvm::ValueToValueMapTy());
     llvm::Function* newF = llvm::CloneFunction(m_originalF, *VMap);
     newF->setName(getCloneFunctionName(m_originalF->getName(), m));
-    m_clones.insert(std::make_pair(m, clone_info(newF, VMap)));
+    m_clones.insert(std::make_pair(m, clone_info{newF, std::move(VMap)}));
     return newF;
 }
 
 bool FunctionClone::addClone(const mask& m, llvm::Function* F)
 {
-    return m_clones.insert(std::make_pair(m, clone_info(F, new llvm::ValueToValueMapTy()))).second;
+    // clones made by analysis have no value map
+    return m_clones.insert(std::make_pair(m, clone_info{F, nullptr})).second;
 }
 
 void FunctionClone::dump() const
 {
     llvm::dbgs() << m_originalF->getName() << "\n";
     for (const auto& clone : m_clones) {
-        llvm::dbgs() << "   mask: " <<  mask_to_string(clone.first) << " clone: " << clone.second.first->getName() << "\n";
+        llvm::dbgs() << "   mask: " <<  mask_to_string(clone.first) << " clone: " << clone.second.F->getName() << "\n";
     }
 }
 
@@ -67,15 +77,15 @@ FunctionClone::mask FunctionClone::createMaskForCall(const input_dependency::Fun
         unsigned index = argDep.first->getArgNo();
         if (is_variadic) {
             if (index >= size) {
-                callSiteMask.resize(index);
+                callSiteMask.resize(index + 1);
             }
         } else {
             assert(index < size);
         }
         if (argDep.second.isInputIndep()) {
-            callSiteMask[index] = false;
+            callSiteMask.set(index, false);
         } else if (argDep.second.isInputDep() || argDep.second.isInputArgumentDep()) {
-            callSiteMask[index] = true;
+            callSiteMask.set(index);
         } else {
             assert(false);
         }
@@ -83,13 +93,24 @@ FunctionClone::mask FunctionClone::createMaskForCall(const input_dependency::Fun
     return callSiteMask;
 }
 
-std::string FunctionClone::mask_to_string(const FunctionClone::mask& m)
+input_dependency::FunctionCallDepInfo::ArgumentDependenciesMap
+FunctionClone::createArgumentDependencies(const mask& m, llvm::Function* F)
 {
-    std::string mask_str;
-    for (const auto& b : m) {
-        mask_str += std::to_string(b);
+    input_dependency::FunctionCallDepInfo::ArgumentDependenciesMap argDeps;
+    for (auto& arg : F->getArgumentList()) {
+        if (arg.getArgNo() >= m.size()) {
+            break;
+        }
+        auto dep = m.test(arg.getArgNo()) ? input_dependency::DepInfo::INPUT_DEP : input_dependency::DepInfo::INPUT_INDEP;
+        argDeps.insert(std::make_pair(&arg, input_dependency::ValueDepInfo(arg.getType(),
+                                                                           input_dependency::DepInfo(dep))));
     }
-    return mask_str;
+    return argDeps;
+}
+
+std::string FunctionClone::mask_to_string(const FunctionClone::mask& m)
+{
+    return m.to_string();
 }
 
 }
@@ -1,9 +1,11 @@
 #pragma once
 
+#include "CloneMask.h"
 #include "Analysis/FunctionCallDepInfo.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
 
-#include <vector>
+#include <memory>
+#include <unordered_map>
 
 namespace llvm {
 class Instruction;
@@ -16,7 +18,7 @@ namespace oh {
 class FunctionClone
 {
 public:
-    using mask = std::vector<bool>;
+    using mask = CloneMask;
 
 public:
     FunctionClone(llvm::Function* F);
@@ -32,10 +34,15 @@ public:
                                   unsigned size,
                                   bool is_variadic);
     static std::string mask_to_string(const mask& m);
+    /// Argument dependencies of \p F matching mask \p m, for cloning with masks not coming from a single call site.
+    static input_dependency::FunctionCallDepInfo::ArgumentDependenciesMap createArgumentDependencies(const mask& m,
+                                                                                                    llvm::Function* F);
 
 public:
     bool hasCloneForMask(const mask& m) const;
     llvm::Function* getClonedFunction(const mask& m) const;
+    /// Value map of the clone for \p m, or null if the clone has not been made by \a doCloneForMask.
+    const llvm::ValueToValueMapTy* getValueMap(const mask& m) const;
     llvm::Function* doCloneForMask(const mask& m);
 
     bool addClone(const mask& m, llvm::Function* F);
@@ -44,8 +51,12 @@ public:
     
 private:
     llvm::Function* m_originalF;
-    using clone_info = std::pair<llvm::Function*, llvm::ValueToValueMapTy*>;
-    std::unordered_map<mask, clone_info> m_clones;
+    struct clone_info
+    {
+        llvm::Function* F;
+        std::unique_ptr<llvm::ValueToValueMapTy> VMap;
+    };
+    std::unordered_map<mask, clone_info, mask::Hasher> m_clones;
 };
 
 }
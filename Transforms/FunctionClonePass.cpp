@@ -10,11 +10,17 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
 
 #include "llvm/PassRegistry.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
+#include <atomic>
+#include <thread>
+
+#define DEBUG_TYPE "clone-functions"
+
 
 namespace oh {
 
@@ -33,6 +39,10 @@ void CloneStatistics::report()
     write_entry(m_module_name, "NumOfInstAfterCloning", m_numOfInstAfterCloning);
     write_entry(m_module_name, "NumOfInDepInstAfterCloning", m_numOfInDepInstAfterCloning);
     write_entry(m_module_name, "ClonnedFunctions", m_clonnedFuncs);
+    write_entry(m_module_name, "NumOfRequestedMasks", m_numOfRequestedMasks);
+    write_entry(m_module_name, "NumOfMergedMasks", m_numOfMergedMasks);
+    write_entry(m_module_name, "NumOfClonesOverBudget", m_numOfRejectedClones);
+    write_entry(m_module_name, "GrowthBudget", m_growthBudget);
     flush();
 }
 
@@ -51,6 +61,30 @@ static llvm::cl::opt<std::string> stats_file(
     llvm::cl::desc("Statistics file"),
     llvm::cl::value_desc("file name"));
 
+static llvm::cl::opt<unsigned> growth_budget(
+    "clone-growth-budget",
+    llvm::cl::desc("Allowed growth of module instructions count by clones, in percent. 0 for no limit"),
+    llvm::cl::value_desc("percent"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned> max_masks(
+    "clone-max-masks",
+    llvm::cl::desc("Maximum number of clones of a function. Least beneficial masks are merged into one conservative clone. 0 for no limit"),
+    llvm::cl::value_desc("number"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<double> min_benefit(
+    "clone-min-benefit",
+    llvm::cl::desc("Minimum number of calls, weighted by input independent arguments, per cloned instruction. Masks with lower benefit are merged into one conservative clone"),
+    llvm::cl::value_desc("number"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned> clone_threads(
+    "clone-threads",
+    llvm::cl::desc("Number of threads planning clones. 0 for number of hardware threads"),
+    llvm::cl::value_desc("number"),
+    llvm::cl::init(0));
+
 char FunctionClonePass::ID = 0;
 
 void FunctionClonePass::getAnalysisUsage(llvm::AnalysisUsage& AU) const
@@ -71,14 +105,119 @@ bool FunctionClonePass::runOnModule(llvm::Module& M)
     m_coverageStatistics->reportInputInDepCoverage();
     //m_coverageStatistics->flush();
 
-    auto it = M.begin();
+    // first decide what to clone, reading analysis results only, then change IR
+    planClones(M);
+    materializeClones(M);
+
+    llvm::dbgs() << "Finished function clonning transofrmation\n\n";
+    //dump();
+    if (stats) {
+        // callers of clones are analysed again before their coverage is reported
+        IDA->getAnalysisInfo();
+    }
+    m_coverageStatistics->setSectionName("input_indep_coverage_after_clonning");
+    m_coverageStatistics->reportInputInDepCoverage();
+    //m_coverageStatistics->flush();
+    m_cloneStatistics->set_costModelDecisions(m_costModel->getDecisions(), growth_budget);
+    m_cloneStatistics->report();
+    return isChanged;
+}
+
+// Collects call sites of all functions and argument masks they would be cloned for.
+// Functions are planned in parallel, as planning only reads analysis results.
+void FunctionClonePass::planClones(llvm::Module& M)
+{
+    std::vector<llvm::Function*> functions;
+    unsigned module_instrs_count = 0;
+    for (auto& F : M) {
+        module_instrs_count += Utils::get_function_instrs_count(F);
+        // arguments are built lazily on first access, which is not thread safe.
+        // Call dependency info of a callee, e.g. of cached results, is built over its arguments
+        F.arg_begin();
+        if (!F.isDeclaration()) {
+            functions.push_back(&F);
+        }
+    }
+    // analyses all functions in lazy mode, so that results are not changed while planning
+    const auto& analysisInfo = IDA->getAnalysisInfo();
+    std::vector<FunctionPlan> plans(functions.size());
+    std::atomic<unsigned> next_function(0);
+    auto plan_functions = [&] () {
+        for (unsigned i = next_function++; i < functions.size(); i = next_function++) {
+            auto pos = analysisInfo.find(functions[i]);
+            if (pos != analysisInfo.end()) {
+                plans[i] = planFunction(pos->second);
+            }
+        }
+    };
+    unsigned threads_count = clone_threads ? clone_threads : std::thread::hardware_concurrency();
+    threads_count = std::max(1u, std::min<unsigned>(threads_count, functions.size()));
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threads_count; ++i) {
+        threads.emplace_back(plan_functions);
+    }
+    plan_functions();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    m_costModel.reset(new CloneCostModel(CloneCostModel::Options{growth_budget, max_masks, min_benefit},
+                                         module_instrs_count));
+    for (unsigned i = 0; i < functions.size(); ++i) {
+        for (const auto& callee_plan : plans[i].callees) {
+            for (const auto& callsite_plan : callee_plan.callSites) {
+                if (!callsite_plan.input_dep_block) {
+                    m_costModel->addCallSite(callee_plan.callee, callsite_plan.mask,
+                                             const_cast<llvm::Instruction*>(callsite_plan.callSite));
+                }
+            }
+        }
+        m_functionPlans.insert(std::make_pair(functions[i], std::move(plans[i])));
+    }
+    m_costModel->plan();
+}
+
+FunctionClonePass::FunctionPlan FunctionClonePass::planFunction(const InputDepRes& analiser) const
+{
+    FunctionPlan plan;
+    plan.analiser = analiser;
+    if (!analiser || analiser->isInputDepFunction() || analiser->isExtractedFunction()) {
+        return plan;
+    }
+    for (const auto& callee : analiser->getCallSitesData()) {
+        if (callee->isDeclaration() || callee->isIntrinsic()) {
+            continue;
+        }
+        plan.callees.push_back(CalleePlan{callee, analiser->getFunctionCallDepInfo(callee), {}});
+        auto& callee_plan = plan.callees.back();
+        for (const auto& argDepItem : callee_plan.callDepInfo.getCallsArgumentDependencies()) {
+            llvm::BasicBlock* callsite_block = const_cast<llvm::BasicBlock*>(argDepItem.first->getParent());
+            CallSitePlan callsite_plan{argDepItem.first, analiser->isInputDependentBlock(callsite_block), FunctionClone::mask()};
+            if (!callsite_plan.input_dep_block) {
+                // function type is used as arguments list may be built lazily, which is not thread safe
+                callsite_plan.mask = FunctionClone::createMaskForCall(argDepItem.second,
+                                                                      callee->getFunctionType()->getNumParams(),
+                                                                      callee->isVarArg());
+            }
+            callee_plan.callSites.push_back(std::move(callsite_plan));
+        }
+    }
+    return plan;
+}
+
+// Clones functions following the plan. Clones are planned when they are reached, as they did not exist before.
+// Call sites are changed to call clones once all clones are made.
+void FunctionClonePass::materializeClones(llvm::Module& M)
+{
+    std::vector<llvm::Function*> functions;
+    for (auto& F : M) {
+        functions.push_back(&F);
+    }
     FunctionSet to_process;
     FunctionSet processed;
     std::unordered_map<llvm::Function*, bool> original_uses;
     FunctionSet unused_originals;
-    while (it != M.end()) {
-        auto F = &*it;
-        ++it;
+    for (auto F : functions) {
         if (skip_function(F, processed)) {
             continue;
         }
@@ -86,65 +225,63 @@ bool FunctionClonePass::runOnModule(llvm::Module& M)
         m_cloneStatistics->add_numOfInstAfterCloning(Utils::get_function_instrs_count(*F));
         while (!to_process.empty()) {
             auto pos = to_process.begin();
-            auto& currentF = *pos;
+            auto currentF = *pos;
             llvm::dbgs() << "Cloning functions called in " << currentF->getName() << "\n";
             processed.insert(currentF);
+            to_process.erase(pos);
 
-            auto f_analysisInfo = getFunctionInputDepInfo(currentF);
+            FunctionPlan plan;
+            auto plan_pos = m_functionPlans.find(currentF);
+            if (plan_pos != m_functionPlans.end()) {
+                plan = std::move(plan_pos->second);
+                m_functionPlans.erase(plan_pos);
+            } else {
+                plan = planFunction(getFunctionInputDepInfo(currentF));
+            }
+            const auto& f_analysisInfo = plan.analiser;
             if (f_analysisInfo == nullptr) {
                 llvm::dbgs() << "Skip function: No input dependency info\n";
                 original_uses[currentF] = true;
                 unused_originals.erase(currentF);
-                to_process.erase(currentF);
                 continue;
             }
             m_cloneStatistics->add_numOfInDepInstAfterCloning(f_analysisInfo->get_input_indep_count());
             if (f_analysisInfo->isInputDepFunction()) {
                 llvm::dbgs() << "Skip function: input dependent\n";
                 original_uses[currentF] = true;
-                to_process.erase(currentF);
                 continue;
             } else if (f_analysisInfo->isExtractedFunction()) {
                 llvm::dbgs() << "Skip function: extracted\n";
                 original_uses[currentF] = true;
-                to_process.erase(currentF);
                 continue;
             }
-            const auto& callSites = f_analysisInfo->getCallSitesData();
-            for (const auto& callSite : callSites) {
-                if (callSite->isDeclaration() || callSite->isIntrinsic()) {
-                    continue;
-                }
-                if (f_analysisInfo->isInputDepFunction() || f_analysisInfo->isExtractedFunction()) {
-                    original_uses[callSite] = true;
-                    continue;
-                }
-                original_uses.insert(std::make_pair(callSite, false));
+            for (const auto& callee_plan : plan.callees) {
+                original_uses.insert(std::make_pair(callee_plan.callee, false));
                 bool uses_original = false;
-                const auto& clonedFunctions = doClone(f_analysisInfo, callSite, uses_original);
-                original_uses[callSite] |= uses_original;
+                const auto& clonedFunctions = doClone(f_analysisInfo, callee_plan, uses_original);
+                original_uses[callee_plan.callee] |= uses_original;
                 to_process.insert(clonedFunctions.begin(), clonedFunctions.end());
             }
-            to_process.erase(currentF);
         }
     }
+    // callers are analysed again on next query, giving clones the context of their call sites.
+    // Clones keep results projected from their originals, thus are not invalidated.
+    for (const auto& rewrite : m_callRewrites) {
+        rewrite.caller->changeFunctionCall(rewrite.callSite, rewrite.oldF, rewrite.newF);
+        IDA->invalidate(const_cast<llvm::Function*>(rewrite.callSite->getParent()->getParent()));
+    }
+    m_callRewrites.clear();
     remove_unused_originals(original_uses);
-    llvm::dbgs() << "Finished function clonning transofrmation\n\n";
-    //dump();
-    m_coverageStatistics->setSectionName("input_indep_coverage_after_clonning");
-    m_coverageStatistics->reportInputInDepCoverage();
-    //m_coverageStatistics->flush();
-    m_cloneStatistics->report();
-    return isChanged;
 }
 
 // Do clonning for the given called functions.
 // Will clone for all sets of input dependent arguments.
 // Returns set of clonned functions.
 FunctionClonePass::FunctionSet FunctionClonePass::doClone(const InputDepRes& caller_analiser,
-                                                          llvm::Function* calledF,
+                                                          const CalleePlan& callee_plan,
                                                           bool& uses_original)
 {
+    llvm::Function* calledF = callee_plan.callee;
     llvm::dbgs() << "   Clone " << calledF->getName() << "\n";
     llvm::dbgs() << "---------------------------\n";
     FunctionSet clonedFunctions;
@@ -161,20 +298,25 @@ FunctionClonePass::FunctionSet FunctionClonePass::doClone(const InputDepRes& cal
         uses_original = true;
         return clonedFunctions;
     }
+    // Clones are specialised from results computed per argument context. Cached, cloned and extracted function results
+    // are finalized for a single context, thus their callers keep the original.
+    if (!calledFunctionAnaliser->toFunctionAnalysisResult()) {
+        llvm::dbgs() << "   No per context results for " << calledF->getName() << ". Use original\n";
+        uses_original = true;
+        return clonedFunctions;
+    }
     auto emplace_res = m_functionCloneInfo.emplace(calledF, FunctionClone(calledF));
     auto& clone = emplace_res.first->second;
 
-    auto functionCallDepInfo = caller_analiser->getFunctionCallDepInfo(cloned_calledF);
-    auto& callArgDeps = functionCallDepInfo.getCallsArgumentDependencies();
-
-    for (auto& argDepItem : callArgDeps) {
-        const llvm::BasicBlock* callsite_block = argDepItem.first->getParent();
-        if (caller_analiser->isInputDependentBlock(const_cast<llvm::BasicBlock*>(callsite_block))) {
+    const auto& callArgDeps = callee_plan.callDepInfo.getCallsArgumentDependencies();
+    for (const auto& callsite_plan : callee_plan.callSites) {
+        if (callsite_plan.input_dep_block) {
             uses_original = true;
             continue;
         }
-        //llvm::dbgs() << "   Clone for call site " << *argDepItem.first << "\n";
-        auto clone_res = doCloneForArguments(calledF, calledFunctionAnaliser, clone, argDepItem.second);
+        //llvm::dbgs() << "   Clone for call site " << *callsite_plan.callSite << "\n";
+        const auto& argDeps = callArgDeps.find(callsite_plan.callSite)->second;
+        auto clone_res = doCloneForArguments(calledF, calledFunctionAnaliser, clone, callsite_plan.mask, argDeps);
         if (!clone_res.first && !clone_res.second) {
             uses_original = true;
             continue;
@@ -186,10 +328,10 @@ FunctionClonePass::FunctionSet FunctionClonePass::doClone(const InputDepRes& cal
             clonedFunctions.insert(F);
             // add to analysis info
         }
-        uses_original = (cloned_calledF == F);
+        // an earlier call site may still use the original
+        uses_original |= (cloned_calledF == F);
         if (cloned_calledF != F) {
-            //llvm::dbgs() << "   Change call site to call cloned function\n";
-            caller_analiser->changeFunctionCall(argDepItem.first, cloned_calledF, F);
+            m_callRewrites.push_back(CallRewrite{caller_analiser, callsite_plan.callSite, cloned_calledF, F});
         }
     }
     //llvm::dbgs() << "\n";
@@ -210,35 +352,44 @@ std::pair<llvm::Function*, bool> FunctionClonePass::doCloneForArguments(
                                                        llvm::Function* calledF,
                                                        InputDepRes original_analiser,
                                                        FunctionClone& clone,
+                                                       const FunctionClone::mask& mask,
                                                        const input_dependency::FunctionCallDepInfo::ArgumentDependenciesMap& argDeps)
 {
-    const FunctionClone::mask& mask = FunctionClone::createMaskForCall(argDeps,
-                                                                       calledF->getArgumentList().size(),
-                                                                       calledF->isVarArg());
     // no need to clone for all input dep arguments
-    if (!mask.empty() && std::all_of(mask.begin(), mask.end(), [] (bool b) {return b;})) {
+    if (mask.all()) {
         return std::make_pair(nullptr, false);
     }
     //llvm::dbgs() << "   Argument dependency mask is: " << FunctionClone::mask_to_string(mask) << "\n";
+    // low benefit masks are cloned for conservative superset of them
+    const FunctionClone::mask& clone_mask = m_costModel->getCloneMask(calledF, mask);
+    if (clone_mask.all()) {
+        return std::make_pair(nullptr, false);
+    }
     llvm::Function* F = nullptr;
-    if (clone.hasCloneForMask(mask)) {
-        F = clone.getClonedFunction(mask);
+    if (clone.hasCloneForMask(clone_mask)) {
+        F = clone.getClonedFunction(clone_mask);
         //llvm::dbgs() << "   Has clone for mask " << F->getName() << ". reuse..\n";
         return std::make_pair(F, false);
     }
     auto original_f_analiser = original_analiser->toFunctionAnalysisResult();
-    if (!original_f_analiser) {
-        // no cloning for already cloned function or for extracted function.
+    assert(original_f_analiser);
+    if (!m_costModel->reserveClone(calledF, clone_mask)) {
+        DEBUG(llvm::dbgs() << "   Clone growth budget exceeded. Use original " << calledF->getName() << "\n");
         return std::make_pair(nullptr, false);
     }
-    InputDepRes cloned_analiser(original_f_analiser->cloneForArguments(argDeps));
+    // results are projected onto the clone through its value map, so the function is copied only once
+    F = clone.doCloneForMask(clone_mask);
+    const llvm::ValueToValueMapTy& VMap = *clone.getValueMap(clone_mask);
+    InputDepRes cloned_analiser(clone_mask == mask
+                                ? original_f_analiser->cloneForArguments(argDeps, F, VMap)
+                                : original_f_analiser->cloneForArguments(
+                                        FunctionClone::createArgumentDependencies(clone_mask, calledF), F, VMap));
     // call sites at input dep blocks are filtered out, thus if we got to this point, means call site is input indep
     cloned_analiser->setIsInputDepFunction(false);
-    F = cloned_analiser->getFunction();
-    std::string newName = calledF->getName();
-    newName += mask.empty() ? "_indep" : FunctionClone::mask_to_string(mask);
-    F->setName(newName);
-    clone.addClone(mask, F);
+    if (clone_mask.empty()) {
+        std::string newName = calledF->getName();
+        F->setName(newName + "_indep");
+    }
     bool add_to_input_dep = IDA->insertAnalysisInfo(F, cloned_analiser);
     m_cloneStatistics->add_numOfInDepInstAfterCloning(cloned_analiser->get_input_indep_count());
     unsigned function_instr_count = Utils::get_function_instrs_count(*F);
@@ -277,7 +428,7 @@ void FunctionClonePass::remove_unused_originals(const std::unordered_map<llvm::F
         //llvm::Function* f = functionsToErase.back();
         llvm::dbgs() << "Remove unused function analysis info " << f->getName() << "\n";
         //functionsToErase.pop_back();
-        IDA->getAnalysisInfo().erase(f);
+        IDA->removeFunction(f);
         if (f->user_empty()) {
             m_cloneStatistics->remove_numOfInstAfterCloning(Utils::get_function_instrs_count(*f));
             f->dropAllReferences();
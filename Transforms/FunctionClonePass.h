@@ -1,5 +1,6 @@
 #pragma once
 
+#include "CloneCostModel.h"
 #include "FunctionClone.h"
 #include "Analysis/InputDependencyAnalysisPass.h"
 #include "Analysis/Statistics.h"
@@ -30,6 +31,10 @@ public:
         , m_numOfClonnedInst(0)
         , m_numOfInstAfterCloning(0)
         , m_numOfInDepInstAfterCloning(0)
+        , m_numOfRequestedMasks(0)
+        , m_numOfMergedMasks(0)
+        , m_numOfRejectedClones(0)
+        , m_growthBudget(0)
     {
     }
 
@@ -38,6 +43,10 @@ public:
         , m_numOfClonnedInst(0)
         , m_numOfInstAfterCloning(0)
         , m_numOfInDepInstAfterCloning(0)
+        , m_numOfRequestedMasks(0)
+        , m_numOfMergedMasks(0)
+        , m_numOfRejectedClones(0)
+        , m_growthBudget(0)
     {
     }
 
@@ -78,11 +87,24 @@ public:
         m_clonnedFuncs.push_back(name);
     }
 
+    /// Records decisions of the clone cost model
+    virtual void set_costModelDecisions(const CloneCostModel::Decisions& decisions, unsigned growth_budget)
+    {
+        m_numOfRequestedMasks = decisions.requested_masks;
+        m_numOfMergedMasks = decisions.merged_masks;
+        m_numOfRejectedClones = decisions.rejected_clones;
+        m_growthBudget = growth_budget;
+    }
+
 private:
     std::string m_module_name;
     unsigned m_numOfClonnedInst;
     unsigned m_numOfInstAfterCloning;
     unsigned m_numOfInDepInstAfterCloning;
+    unsigned m_numOfRequestedMasks;
+    unsigned m_numOfMergedMasks;
+    unsigned m_numOfRejectedClones;
+    unsigned m_growthBudget;
     std::vector<std::string> m_clonnedFuncs;
 }; // class CloneStatistics
 
@@ -108,6 +130,9 @@ public:
 
     void add_clonnedFunction(const std::string& name) override
     {}
+
+    void set_costModelDecisions(const CloneCostModel::Decisions& decisions, unsigned growth_budget) override
+    {}
 };
 
 class FunctionClonePass : public llvm::ModulePass
@@ -127,14 +152,49 @@ public:
 private:
     using FunctionSet = std::unordered_set<llvm::Function*>;
     using InputDepRes = input_dependency::InputDependencyAnalysis::InputDepResType;
+
+    struct CallSitePlan
+    {
+        const llvm::Instruction* callSite;
+        bool input_dep_block;
+        // argument mask, set only for call sites in input independent blocks
+        FunctionClone::mask mask;
+    };
+
+    struct CalleePlan
+    {
+        llvm::Function* callee;
+        input_dependency::FunctionCallDepInfo callDepInfo;
+        std::vector<CallSitePlan> callSites;
+    };
+
+    struct FunctionPlan
+    {
+        InputDepRes analiser;
+        // empty for input dependent and extracted functions
+        std::vector<CalleePlan> callees;
+    };
+
+    struct CallRewrite
+    {
+        InputDepRes caller;
+        const llvm::Instruction* callSite;
+        llvm::Function* oldF;
+        llvm::Function* newF;
+    };
+
+    void planClones(llvm::Module& M);
+    FunctionPlan planFunction(const InputDepRes& analiser) const;
+    void materializeClones(llvm::Module& M);
     FunctionSet doClone(const InputDepRes& analiser,
-                        llvm::Function* calledF,
+                        const CalleePlan& callee_plan,
                         bool& uses_original);
     InputDepRes getFunctionInputDepInfo(llvm::Function* F) const;
     std::pair<llvm::Function*, bool> doCloneForArguments(
                                             llvm::Function* calledF,
                                             InputDepRes original_analiser,
                                             FunctionClone& clone,
+                                            const FunctionClone::mask& mask,
                                             const input_dependency::FunctionCallDepInfo::ArgumentDependenciesMap& argDeps);
 
     void remove_unused_originals(const std::unordered_map<llvm::Function*, bool>& original_uses);
@@ -146,6 +206,10 @@ private:
     using FunctionCloneInfo = std::unordered_map<llvm::Function*, FunctionClone>;
     FunctionCloneInfo m_functionCloneInfo;
     std::unordered_map<llvm::Function*, llvm::Function*> m_clone_to_original;
+    std::unique_ptr<CloneCostModel> m_costModel;
+    // plans of functions not cloned yet
+    std::unordered_map<llvm::Function*, FunctionPlan> m_functionPlans;
+    std::vector<CallRewrite> m_callRewrites;
     using CloneStatisticsType = std::shared_ptr<CloneStatistics>;
     CloneStatisticsType m_cloneStatistics;
     using CoverageStatisticsType = std::shared_ptr<input_dependency::InputDependencyStatistics>;
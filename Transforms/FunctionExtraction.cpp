@@ -15,13 +15,17 @@
 
 #include "FunctionSnippet.h"
 #include "Utils.h"
+#include "Analysis/ClonedFunctionAnalysisResult.h"
 #include "Analysis/FunctionAnaliser.h"
-#include "Analysis/InputDependentFunctionAnalysisResult.h"
+#include "Analysis/FunctionNumbering.h"
 #include "Analysis/BasicBlocksUtils.h"
 #include "Analysis/InputDepConfig.h"
 
-#include <vector>
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <vector>
 
 namespace oh {
 
@@ -38,6 +42,7 @@ public:
 public:
     SnippetsCreator(llvm::Function& F)
         : m_F(F)
+        , m_numbering(&F)
         , m_is_whole_function_snippet(false)
     {
     }
@@ -57,11 +62,33 @@ public:
         return m_snippets;
     }
 
+    void set_snippets(snippet_list&& snippets)
+    {
+        m_snippets = std::move(snippets);
+    }
+
     bool is_whole_function_snippet() const
     {
         return m_is_whole_function_snippet;
     }
 
+    const input_dependency::FunctionNumbering& get_numbering() const
+    {
+        return m_numbering;
+    }
+
+    struct SnippetValues
+    {
+        Snippet::InstructionList instructions;
+        Snippet::BlockList blocks;
+    };
+
+    /// Instructions and blocks of \p snippet, collected before it is extracted.
+    SnippetValues get_snippet_values(const Snippet& snippet) const;
+    /// Drops ordinals of values erased by extraction,
+    /// as instructions created by following extractions may reuse their addresses.
+    void forget_extracted(const SnippetValues& values);
+
 public:
     void collect_snippets(bool expand);
     void expand_snippets();
@@ -79,6 +106,8 @@ private:
 
 private:
     llvm::Function& m_F;
+    // numbering of the function before extraction, snippets are intervals of its instruction ordinals
+    input_dependency::FunctionNumbering m_numbering;
     bool m_is_whole_function_snippet;
     InputDependencyAnalysisInfo m_input_dep_info;
     llvm::PostDominatorTree* m_pdom;
@@ -86,9 +115,25 @@ private:
     std::unordered_set<llvm::Instruction*> derived_input_dep_instructions;
 };
 
+SnippetsCreator::SnippetValues SnippetsCreator::get_snippet_values(const Snippet& snippet) const
+{
+    SnippetValues values;
+    snippet.collect_contained_values(values.instructions, values.blocks);
+    return values;
+}
+
+void SnippetsCreator::forget_extracted(const SnippetValues& values)
+{
+    for (const auto& I : values.instructions) {
+        m_numbering.forgetInstruction(I);
+    }
+    for (const auto& B : values.blocks) {
+        m_numbering.forgetBlock(B);
+    }
+}
+
 void SnippetsCreator::collect_snippets(bool expand)
 {
-    llvm::dbgs() << "Start collecting snippets\n";
     std::unordered_set<const llvm::BasicBlock*> processed_blocks;
     auto it = m_F.begin();
     while (it != m_F.end()) {
@@ -111,10 +156,8 @@ void SnippetsCreator::collect_snippets(bool expand)
         }
         // assert back end iter is block's terminator
         auto blocks_range = get_blocks_snippet(it);
-        if (!BasicBlocksSnippet::is_valid_snippet(blocks_range.first, blocks_range.second, &m_F)) {
-            llvm::dbgs() << "Failed to create snippet out of blocks, starting with block "
-                         << B->getName() << "\n";
-        } else {
+        // snippets are collected on worker threads, hence invalid block snippets are skipped silently
+        if (BasicBlocksSnippet::is_valid_snippet(blocks_range.first, blocks_range.second, &m_F)) {
             auto back = block_snippets.back();
             block_snippets.pop_back();
             update_processed_blocks(&*blocks_range.first, &*blocks_range.second, processed_blocks);
@@ -227,7 +270,7 @@ SnippetsCreator::snippet_list SnippetsCreator::collect_block_snippets(llvm::Func
         }
         if (!is_input_dep) {
             if (InstructionsSnippet::is_valid_snippet(begin, end, block)) {
-                snippets.push_back(Snippet_type(new InstructionsSnippet(block, begin, end)));
+                snippets.push_back(Snippet_type(new InstructionsSnippet(block, begin, end, &m_numbering)));
                 begin = block->end();
                 end = block->end();
             }
@@ -249,7 +292,7 @@ SnippetsCreator::snippet_list SnippetsCreator::collect_block_snippets(llvm::Func
         ++it;
     }
     if (InstructionsSnippet::is_valid_snippet(begin, end, block)) {
-        snippets.push_back(Snippet_type(new InstructionsSnippet(block, begin, end)));
+        snippets.push_back(Snippet_type(new InstructionsSnippet(block, begin, end, &m_numbering)));
     }
     return snippets;
 }
@@ -361,22 +404,179 @@ void SnippetsCreator::update_processed_blocks(const llvm::BasicBlock* block,
     }
 }
 
-void run_on_function(llvm::Function& F,
-                     llvm::PostDominatorTree* PDom,
-                     const SnippetsCreator::InputDependencyAnalysisInfo& input_dep_info,
-                     std::unordered_map<llvm::Function*, unsigned>& extracted_functions)
+/**
+ * \class InputDependencySnapshot
+ * \brief Input dependency results of a function, taken before snippets are extracted from it.
+ * Results of extracted functions are mapped from the snapshot, as original instructions are erased by extraction.
+ * Results are kept by ordinals of the snippets numbering, which drops ordinals of erased instructions,
+ * thus instructions created by extraction at addresses of erased ones are not mistaken for them.
+ */
+class InputDependencySnapshot
+{
+public:
+    using InputDependencyAnalysisInfo = SnippetsCreator::InputDependencyAnalysisInfo;
+
+public:
+    InputDependencySnapshot(llvm::Function& F,
+                            const InputDependencyAnalysisInfo& input_dep_info,
+                            const input_dependency::FunctionNumbering& numbering)
+        : m_numbering(numbering)
+        , m_input_deps(numbering.getInstructionsCount(), false)
+        , m_input_indeps(numbering.getInstructionsCount(), false)
+        , m_input_dep_blocks(numbering.getBlocksCount(), false)
+    {
+        for (auto& B : F) {
+            const int block_idx = m_numbering.getBlockIndex(&B);
+            if (block_idx != -1 && input_dep_info->isInputDependentBlock(&B)) {
+                m_input_dep_blocks[block_idx] = true;
+            }
+            for (auto& I : B) {
+                const int idx = m_numbering.getInstructionIndex(&I);
+                if (idx == -1) {
+                    continue;
+                }
+                if (input_dep_info->isInputDependent(&I)) {
+                    m_input_deps[idx] = true;
+                } else if (input_dep_info->isInputIndependent(&I)) {
+                    m_input_indeps[idx] = true;
+                }
+            }
+        }
+        for (const auto& callee : input_dep_info->getCallSitesData()) {
+            const auto& callDepInfo = input_dep_info->getFunctionCallDepInfo(callee);
+            for (const auto& callsite_entry : callDepInfo.getCallsArgumentDependencies()) {
+                const int idx = m_numbering.getInstructionIndex(callsite_entry.first);
+                if (idx != -1) {
+                    m_call_arg_deps[idx] = callsite_entry.second;
+                }
+            }
+        }
+    }
+
+    /// Instructions and blocks without an original, e.g. argument handling ones, are considered input dependent.
+    /// Must be called before ordinals of the extracted snippet are dropped from the numbering.
+    InputDependencyAnalysisInfo get_extracted_function_results(llvm::Function* extracted_F,
+                                                               const Snippet::ValueMap& extracted_values) const
+    {
+        input_dependency::InstrSet inputDeps;
+        input_dependency::InstrSet inputIndeps;
+        std::unordered_set<llvm::BasicBlock*> inputDepBlocks;
+        input_dependency::FunctionSet calledFunctions;
+        std::unordered_map<llvm::Function*, input_dependency::FunctionCallDepInfo> callDepInfos;
+        for (auto& B : *extracted_F) {
+            const int block_idx = get_original_block_index(&B, extracted_values);
+            if (block_idx == -1 || m_input_dep_blocks[block_idx]) {
+                inputDepBlocks.insert(&B);
+            }
+            for (auto& I : B) {
+                const int idx = get_original_index(&I, extracted_values);
+                if (idx != -1 && m_input_indeps[idx]) {
+                    inputIndeps.insert(&I);
+                } else if (idx == -1 || m_input_deps[idx]) {
+                    inputDeps.insert(&I);
+                }
+                llvm::Function* calledF = nullptr;
+                if (auto* callInst = llvm::dyn_cast<llvm::CallInst>(&I)) {
+                    calledF = callInst->getCalledFunction();
+                } else if (auto* invokeInst = llvm::dyn_cast<llvm::InvokeInst>(&I)) {
+                    calledF = invokeInst->getCalledFunction();
+                }
+                if (!calledF) {
+                    continue;
+                }
+                calledFunctions.insert(calledF);
+                auto call_pos = callDepInfos.insert(std::make_pair(calledF, input_dependency::FunctionCallDepInfo(*calledF))).first;
+                // dependencies on values of original function are meaningless in extracted function
+                input_dependency::FunctionCallDepInfo::ArgumentDependenciesMap argDeps;
+                auto deps_pos = idx != -1 ? m_call_arg_deps.find(idx) : m_call_arg_deps.end();
+                for (auto& arg : calledF->getArgumentList()) {
+                    bool is_input_indep = deps_pos != m_call_arg_deps.end();
+                    if (is_input_indep) {
+                        auto arg_pos = deps_pos->second.find(&arg);
+                        is_input_indep = arg_pos != deps_pos->second.end() && arg_pos->second.isInputIndep();
+                    }
+                    auto dep = is_input_indep ? input_dependency::DepInfo::INPUT_INDEP : input_dependency::DepInfo::INPUT_DEP;
+                    argDeps.insert(std::make_pair(&arg, input_dependency::ValueDepInfo(arg.getType(), input_dependency::DepInfo(dep))));
+                }
+                call_pos->second.addCall(&I, argDeps);
+                call_pos->second.addCall(&I, input_dependency::FunctionCallDepInfo::GlobalVariableDependencyMap());
+            }
+        }
+        auto results = new input_dependency::ClonedFunctionAnalysisResult(extracted_F);
+        results->setInputDepInstrs(std::move(inputDeps));
+        results->setInputIndepInstrs(std::move(inputIndeps));
+        results->setInputDependentBasicBlocks(std::move(inputDepBlocks));
+        results->setCalledFunctions(calledFunctions);
+        results->setFunctionCallDepInfo(std::move(callDepInfos));
+        results->setIsExtractedFunction(true);
+        return InputDependencyAnalysisInfo(results);
+    }
+
+private:
+    // originals are erased by extraction, hence are only cast to look up their ordinals, never dereferenced
+    int get_original_index(llvm::Instruction* I, const Snippet::ValueMap& extracted_values) const
+    {
+        auto pos = extracted_values.find(I);
+        if (pos == extracted_values.end()) {
+            return -1;
+        }
+        return m_numbering.getInstructionIndex(static_cast<const llvm::Instruction*>(pos->second));
+    }
+
+    int get_original_block_index(llvm::BasicBlock* B, const Snippet::ValueMap& extracted_values) const
+    {
+        auto pos = extracted_values.find(B);
+        if (pos == extracted_values.end()) {
+            return -1;
+        }
+        return m_numbering.getBlockIndex(static_cast<const llvm::BasicBlock*>(pos->second));
+    }
+
+private:
+    const input_dependency::FunctionNumbering& m_numbering;
+    std::vector<bool> m_input_deps;
+    std::vector<bool> m_input_indeps;
+    std::vector<bool> m_input_dep_blocks;
+    std::unordered_map<unsigned, input_dependency::FunctionCallDepInfo::ArgumentDependenciesMap> m_call_arg_deps;
+};
+
+/// Finds snippets of \p F to extract. Reads IR and analysis results only, thus runs for many functions in parallel.
+/// If \p cost_options are given, snippets are filtered by ExtractionCostModel, which reports its \p decisions.
+std::unique_ptr<SnippetsCreator> collect_function_snippets(llvm::Function& F,
+                                                           const SnippetsCreator::InputDependencyAnalysisInfo& input_dep_info,
+                                                           const ExtractionCostModel::Options* cost_options,
+                                                           ExtractionCostModel::Decisions& decisions)
+{
+    // post dominator tree is built here, as analyses of legacy pass manager can not be queried from other threads
+    llvm::PostDominatorTree PDom;
+    PDom.recalculate(F);
+    std::unique_ptr<SnippetsCreator> creator(new SnippetsCreator(F));
+    creator->set_input_dep_info(input_dep_info);
+    creator->set_post_dom_tree(&PDom);
+    creator->collect_snippets(true);
+    creator->set_post_dom_tree(nullptr);
+    if (creator->is_whole_function_snippet()) {
+        input_dependency::InputDepConfig::get().add_extracted_function(&F);
+    } else if (cost_options) {
+        ExtractionCostModel cost_model(*cost_options, F, input_dep_info);
+        creator->set_snippets(cost_model.plan(creator->get_snippets()));
+        decisions = cost_model.getDecisions();
+    }
+    return creator;
+}
+
+void extract_function_snippets(llvm::Function& F,
+                               SnippetsCreator& creator,
+                               const SnippetsCreator::InputDependencyAnalysisInfo& input_dep_info,
+                               std::unordered_map<llvm::Function*, unsigned>& extracted_functions,
+                               std::unordered_map<llvm::Function*, SnippetsCreator::InputDependencyAnalysisInfo>& extracted_results)
 {
-    // map from block to snippets?
-    SnippetsCreator creator(F);
-    creator.set_input_dep_info(input_dep_info);
-    creator.set_post_dom_tree(PDom);
-    creator.collect_snippets(true);
     if (creator.is_whole_function_snippet()) {
         llvm::dbgs() << "Whole function " << F.getName() << " is input dependent\n";
-        input_dependency::InputDepConfig::get().add_extracted_function(&F);
         return;
     }
     const auto& snippets = creator.get_snippets();
+    const InputDependencySnapshot snapshot(F, input_dep_info, creator.get_numbering());
 
     //llvm::dbgs() << "number of snippets " << snippets.size() << "\n";
     for (auto& snippet : snippets) {
@@ -395,6 +595,7 @@ void run_on_function(llvm::Function& F,
         //    llvm::dbgs() << "\n";
         //}
         // **** DEBUG END
+        const auto snippet_values = creator.get_snippet_values(*snippet);
         auto extracted_function = snippet->to_function();
         if (!extracted_function) {
             continue;
@@ -402,6 +603,9 @@ void run_on_function(llvm::Function& F,
         input_dependency::InputDepConfig::get().add_extracted_function(extracted_function);
         //llvm::dbgs() << "Extracted to function " << *extracted_function << "\n";
         extracted_functions.insert(std::make_pair(extracted_function, snippet->get_instructions_number()));
+        extracted_results[extracted_function] = snapshot.get_extracted_function_results(
+                                                        extracted_function, snippet->get_extracted_values_map());
+        creator.forget_extracted(snippet_values);
     }
 }
 
@@ -413,6 +617,11 @@ void ExtractionStatistics::report()
     write_entry(m_module_name, "NumOfExtractedInst", m_numOfExtractedInst);
     write_entry(m_module_name, "NumOfMediateInst", m_numOfMediateInst);
     write_entry(m_module_name, "ExtractedFuncs", m_extractedFuncs);
+    write_entry(m_module_name, "NumOfExtractedSnippets", m_costModelDecisions.extracted);
+    write_entry(m_module_name, "NumOfHoistedSnippets", m_costModelDecisions.hoisted);
+    write_entry(m_module_name, "NumOfHoistedLoops", m_costModelDecisions.hoisted_loops);
+    write_entry(m_module_name, "NumOfKeptSnippets", m_costModelDecisions.kept);
+    write_entry(m_module_name, "MaxOverhead", m_maxOverhead);
     flush();
 }
 
@@ -431,14 +640,36 @@ static llvm::cl::opt<std::string> stats_file(
     llvm::cl::desc("Statistics file"),
     llvm::cl::value_desc("file name"));
 
+static llvm::cl::opt<unsigned> max_overhead(
+    "extraction-max-overhead",
+    llvm::cl::desc("Instructions extraction may add per execution of a snippet in a hot loop, in percent of snippet size. Hotter snippets are extracted with their loop or left in place. 0 for no limit"),
+    llvm::cl::value_desc("percent"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<double> hot_frequency(
+    "extraction-hot-frequency",
+    llvm::cl::desc("Number of executions of a loop block per function entry, from which the block is hot"),
+    llvm::cl::value_desc("number"),
+    llvm::cl::init(8));
+
+static llvm::cl::opt<unsigned> hoist_min_dep(
+    "extraction-hoist-min-dep",
+    llvm::cl::desc("Minimum input dependent instructions of a loop to extract it instead of its hot snippets, in percent"),
+    llvm::cl::value_desc("percent"),
+    llvm::cl::init(50));
+
+static llvm::cl::opt<unsigned> extraction_threads(
+    "extraction-threads",
+    llvm::cl::desc("Number of threads collecting snippets to extract. 0 for number of hardware threads"),
+    llvm::cl::value_desc("number"),
+    llvm::cl::init(0));
+
 char FunctionExtractionPass::ID = 0;
 
 void FunctionExtractionPass::getAnalysisUsage(llvm::AnalysisUsage& AU) const
 {
-    AU.addRequired<llvm::PostDominatorTreeWrapperPass>();
-    // FunctionExtractionPass does not preserve results of InputDependency Analysis.
-    // While it adds extracted functions as input dependent functions, the CFG of old functions change, thus input
-    // dependency results are invalidated.
+    // FunctionExtractionPass adds results of extracted functions, mapped from original functions.
+    // CFG of original functions changes, thus their results are invalidated, and computed again on next query.
     AU.addRequired<input_dependency::InputDependencyAnalysisPass>();
 }
 
@@ -450,28 +681,70 @@ bool FunctionExtractionPass::runOnModule(llvm::Module& M)
     createStatistics(M, *input_dep);
     m_coverageStatistics->setSectionName("input_dep_coverage_before_extraction");
     m_coverageStatistics->reportInputDepCoverage();
-    std::unordered_map<llvm::Function*, unsigned> extracted_functions;
+    // snippets of all functions are collected in parallel, reading IR only, then extracted one function at a time
+    struct FunctionSnippets
+    {
+        llvm::Function* F;
+        SnippetsCreator::InputDependencyAnalysisInfo input_dep_info;
+        std::unique_ptr<SnippetsCreator> creator;
+        ExtractionCostModel::Decisions decisions;
+    };
+    std::vector<FunctionSnippets> functions;
     for (auto& F : M) {
-        llvm::dbgs() << "\nStart function extraction on function " << F.getName() << "\n";
         if (F.isDeclaration()) {
             llvm::dbgs() << "Skip: Declaration function " << F.getName() << "\n";
             continue;
         }
+        // results are queried here, as in lazy mode the query runs the analysis
         auto f_input_dep_info = input_dep->getAnalysisInfo(&F);
         if (f_input_dep_info == nullptr) {
             llvm::dbgs() << "Skip: No input dep info for function " << F.getName() << "\n";
             continue;
         }
-        //auto f_input_dep_info = input_dep_info->toFunctionAnalysisResult();
-        if (!f_input_dep_info) {
-            continue;
-        }
         if (f_input_dep_info->isInputDepFunction()) {
             llvm::dbgs() << "Skip: Input dependent function " << F.getName() << "\n";
             continue;
         }
-        llvm::PostDominatorTree* PDom = &getAnalysis<llvm::PostDominatorTreeWrapperPass>(F).getPostDomTree();
-        run_on_function(F, PDom, f_input_dep_info, extracted_functions);
+        functions.push_back(FunctionSnippets{&F, f_input_dep_info, nullptr, ExtractionCostModel::Decisions()});
+    }
+    const ExtractionCostModel::Options cost_options{max_overhead, hot_frequency, hoist_min_dep};
+    std::atomic<unsigned> next_function(0);
+    auto collect_snippets = [&] () {
+        set_snippet_debug_output(false);
+        for (unsigned i = next_function++; i < functions.size(); i = next_function++) {
+            functions[i].creator = collect_function_snippets(*functions[i].F, functions[i].input_dep_info,
+                                                             max_overhead ? &cost_options : nullptr,
+                                                             functions[i].decisions);
+        }
+    };
+    unsigned threads_count = extraction_threads ? extraction_threads : std::thread::hardware_concurrency();
+    threads_count = std::max(1u, std::min<unsigned>(threads_count, functions.size()));
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threads_count; ++i) {
+        threads.emplace_back(collect_snippets);
+    }
+    collect_snippets();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // snippets are extracted sequentially on this thread
+    set_snippet_debug_output(true);
+
+    ExtractionCostModel::Decisions decisions;
+    std::unordered_map<llvm::Function*, unsigned> extracted_functions;
+    std::unordered_map<llvm::Function*, SnippetsCreator::InputDependencyAnalysisInfo> extracted_results;
+    for (auto& function : functions) {
+        decisions += function.decisions;
+        llvm::Function& F = *function.F;
+        llvm::dbgs() << "\nStart function extraction on function " << F.getName() << "\n";
+        const unsigned extracted_count = extracted_functions.size();
+        extract_function_snippets(F, *function.creator, function.input_dep_info, extracted_functions, extracted_results);
+        if (extracted_functions.size() != extracted_count) {
+            // F calls extracted functions now, thus is analysed again on next query
+            input_dep->invalidate(&F);
+        }
+        // snippets refer to numbering of the function, thus are released together
+        function.creator.reset();
         modified = true;
         llvm::dbgs() << "Done function extraction on function " << F.getName() << "\n";
     }
@@ -481,9 +754,8 @@ bool FunctionExtractionPass::runOnModule(llvm::Module& M)
         llvm::Function* extracted_f = f.first;
         m_extracted_functions.insert(extracted_f);
         llvm::dbgs() << extracted_f->getName() << "\n";
-        input_dep->insertAnalysisInfo(
-                extracted_f, input_dependency::InputDependencyAnalysis::InputDepResType(new
-                input_dependency::InputDependentFunctionAnalysisResult(extracted_f)));
+        // results are mapped from the original function, no need to analyze extracted function again
+        input_dep->insertAnalysisInfo(extracted_f, extracted_results[extracted_f]);
         if (stats) {
             unsigned f_instr_num = Utils::get_function_instrs_count(*extracted_f);
             m_extractionStatistics->add_numOfExtractedInst(f.second);
@@ -491,9 +763,14 @@ bool FunctionExtractionPass::runOnModule(llvm::Module& M)
             m_extractionStatistics->add_extractedFunction(extracted_f->getName());
         }
     }
+    if (stats) {
+        // functions snippets were extracted from are analysed again before their coverage is reported
+        input_dep->getAnalysisInfo();
+    }
     m_coverageStatistics->setSectionName("input_dep_coverage_after_extraction");
     m_coverageStatistics->invalidate_stats_data();
     m_coverageStatistics->reportInputDepCoverage();
+    m_extractionStatistics->set_costModelDecisions(decisions, max_overhead);
     m_extractionStatistics->report();
 
     //Utils::check_module(M);
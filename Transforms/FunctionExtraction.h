@@ -1,5 +1,6 @@
 #pragma once
 
+#include "ExtractionCostModel.h"
 #include "Analysis/Statistics.h"
 #include "Analysis/InputDependencyStatistics.h"
 #include "Analysis/InputDependencyAnalysisPass.h"
@@ -21,6 +22,7 @@ public:
         , m_module_name(module_name)
         , m_numOfExtractedInst(0)
         , m_numOfMediateInst(0)
+        , m_maxOverhead(0)
     {
     }
 
@@ -28,6 +30,7 @@ public:
         : Statistics(writer)
         , m_numOfExtractedInst(0)
         , m_numOfMediateInst(0)
+        , m_maxOverhead(0)
     {
     }
 
@@ -54,11 +57,19 @@ public:
         m_extractedFuncs.push_back(name);
     }
 
+    virtual void set_costModelDecisions(const ExtractionCostModel::Decisions& decisions, unsigned max_overhead)
+    {
+        m_costModelDecisions = decisions;
+        m_maxOverhead = max_overhead;
+    }
+
 private:
     std::string m_module_name;
     unsigned m_numOfExtractedInst;
     unsigned m_numOfMediateInst;
     std::vector<std::string> m_extractedFuncs;
+    ExtractionCostModel::Decisions m_costModelDecisions;
+    unsigned m_maxOverhead;
 }; // class CloneStatistics
 
 class DummyExtractionStatistics :  public ExtractionStatistics
@@ -71,6 +82,8 @@ public:
     void add_numOfExtractedInst(unsigned num) override {}
     void add_numOfMediateInst(unsigned num) override {}
     void add_extractedFunction(const std::string& name) override {}
+    void set_costModelDecisions(const ExtractionCostModel::Decisions& decisions, unsigned max_overhead) override
+    {}
 };
 
 /**
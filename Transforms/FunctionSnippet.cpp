@@ -2,6 +2,7 @@
 
 #include "Utils.h"
 #include "Analysis/BasicBlocksUtils.h"
+#include "Analysis/FunctionNumbering.h"
 
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IRBuilder.h"
@@ -16,10 +17,15 @@
 
 #include <unordered_map>
 
+#define DEBUG_TYPE "function-snippet"
+#define SNIPPET_DEBUG(X) DEBUG(if (snippet_debug_output) { X; })
+
 namespace oh {
 
 namespace {
 
+thread_local bool snippet_debug_output = true;
+
 class unique_name_generator
 {
 public:
@@ -136,10 +142,9 @@ void collect_values(llvm::Value* val,
     }
 
     if (llvm::dyn_cast<llvm::AllocaInst>(instr)) {
+        // allocas inside snippet are extracted with it
         if (!snippet.contains_block(instr->getParent())) {
             values.insert(instr);
-        } else {
-            llvm::dbgs() << "**** Skip value as alloca is inside snippet " << *instr << "\n";
         }
         return;
     } else if (!snippet.contains_instruction(instr) && !llvm::dyn_cast<llvm::BranchInst>(instr)) {
@@ -228,6 +233,27 @@ void create_value_to_value_map(const ValueToValueMap& value_ptr_map,
     }
 }
 
+/*
+ * Collects mapping from instructions and blocks of extracted function to original ones.
+ * Values in value_ptr_map are mapped to argument handling instructions, not to their clones, hence are skipped.
+ */
+void collect_extracted_values(const llvm::ValueToValueMapTy& value_to_value_map,
+                              const ValueToValueMap& value_ptr_map,
+                              Snippet::ValueMap& extracted_values)
+{
+    extracted_values.clear();
+    for (const auto& entry : value_to_value_map) {
+        llvm::Value* original = const_cast<llvm::Value*>(entry.first);
+        llvm::Value* clone = entry.second;
+        if (!clone || value_ptr_map.find(original) != value_ptr_map.end()) {
+            continue;
+        }
+        if (llvm::isa<llvm::Instruction>(clone) || llvm::isa<llvm::BasicBlock>(clone)) {
+            extracted_values[clone] = original;
+        }
+    }
+}
+
 void remap_value_in_instruction(llvm::Instruction* instr, llvm::Value* old_value, llvm::Value* new_value)
 {
     for (llvm::Use& op : instr->operands()) {
@@ -584,8 +610,14 @@ llvm::FunctionType* create_function_type(llvm::LLVMContext& Ctx,
 
 }
 
+void set_snippet_debug_output(bool enable)
+{
+    snippet_debug_output = enable;
+}
+
 InstructionsSnippet::InstructionsSnippet()
     : m_block(nullptr)
+    , m_numbering(nullptr)
     , m_begin_idx(-1)
     , m_end_idx(-1)
 {
@@ -593,8 +625,10 @@ InstructionsSnippet::InstructionsSnippet()
 
 InstructionsSnippet::InstructionsSnippet(llvm::BasicBlock* block,
                                          iterator begin,
-                                         iterator end)
+                                         iterator end,
+                                         const input_dependency::FunctionNumbering* numbering)
     : m_block(block)
+    , m_numbering(numbering)
     , m_begin(begin)
     , m_end(end)
     , m_begin_idx(-1)
@@ -623,8 +657,8 @@ bool InstructionsSnippet::contains_instruction(llvm::Instruction* instr) const
     if (instr->getParent() != m_block) {
         return false;
     }
-    int instr_idx = Utils::get_instruction_index(instr);
-    return m_begin_idx <= instr_idx  && instr_idx <= m_end_idx;
+    int instr_idx = get_instruction_ordinal(instr);
+    return instr_idx != -1 && m_begin_idx <= instr_idx  && instr_idx <= m_end_idx;
 }
 
 bool InstructionsSnippet::contains_block(llvm::BasicBlock* block) const
@@ -653,8 +687,7 @@ bool InstructionsSnippet::intersects(const Snippet& snippet) const
 
 void InstructionsSnippet::expand()
 {
-    InstructionSet instructions;
-    snippet_instructions(instructions);
+    ClosureBits instructions(m_end_idx - m_begin_idx + 1, true);
     auto it = m_end;
     do {
         llvm::Instruction* instr = &*it;
@@ -684,19 +717,23 @@ void InstructionsSnippet::adjust_end()
 void InstructionsSnippet::collect_used_values(const Snippet* parent_snippet)
 {
     m_used_values.clear();
+    compute_used_values(parent_snippet, m_used_values);
+}
+
+void InstructionsSnippet::compute_used_values(const Snippet* parent_snippet, ValueSet& used_values) const
+{
     if (m_end == m_block->end()) {
-        collect_values(m_begin, m_end, !parent_snippet ? *this : *parent_snippet, m_used_values);
+        collect_values(m_begin, m_end, !parent_snippet ? *this : *parent_snippet, used_values);
     } else {
         // not to increment actual end
         auto end = m_end;
-        collect_values(m_begin, ++end, !parent_snippet ? *this : *parent_snippet, m_used_values);
+        collect_values(m_begin, ++end, !parent_snippet ? *this : *parent_snippet, used_values);
     }
 }
 
 bool InstructionsSnippet::merge(const Snippet& snippet)
 {
     if (!intersects(snippet)) {
-        llvm::dbgs() << "Snippets do not intersect. Will not merge\n";
         return false;
     }
     //if (m_block->getParent()->getName() == "") {
@@ -735,7 +772,7 @@ bool InstructionsSnippet::can_erase_snippet() const
         for (const auto& user : it->users()) {
             if (auto* instr = llvm::dyn_cast<llvm::Instruction>(user)) {
                 if (!contains_instruction(instr)) {
-                    llvm::dbgs() << "does not contain use of instruction " << *it << "  " << *instr << "\n";
+                    SNIPPET_DEBUG(llvm::dbgs() << "does not contain use of instruction " << *it << "  " << *instr << "\n");
                     return false;
                 }
             }
@@ -745,17 +782,17 @@ bool InstructionsSnippet::can_erase_snippet() const
                 if (!contains_instruction(instr)
                         && m_used_values.find(instr) == m_used_values.end()
                         && m_allocas_to_extract.find(instr) == m_allocas_to_extract.end()) {
-                    llvm::dbgs() << "does not contain operand of " << *it << "  " << *instr << "\n";
+                    SNIPPET_DEBUG(llvm::dbgs() << "does not contain operand of " << *it << "  " << *instr << "\n");
                     return false;
                 }
                 if (auto* phi = llvm::dyn_cast<llvm::PHINode>(instr)) {
                     // phi node incomming blocks can not be m_block anyway
-                    llvm::dbgs() << "Phi node, can not extract " << *it << "\n";
+                    SNIPPET_DEBUG(llvm::dbgs() << "Phi node, can not extract " << *it << "\n");
                     return false;
                 }
             } else if (auto* bb = llvm::dyn_cast<llvm::BasicBlock>(op)) {
                 if (m_block != bb) {
-                    llvm::dbgs() << "does not contain block operand of " << *it << "  " << bb->getName() << "\n";
+                    SNIPPET_DEBUG(llvm::dbgs() << "does not contain block operand of " << *it << "  " << bb->getName() << "\n");
                     return false;
                 }
             }
@@ -815,6 +852,7 @@ llvm::Function* InstructionsSnippet::to_function()
         entry_block->getInstList().push_back(retInst);
     }
     create_return_stores(entry_block, value_map);
+    collect_extracted_values(value_to_value_map, value_ptr_map, m_extracted_values);
 
     auto insert_before = m_begin;
     auto callInst = create_call_to_snippet_function(new_F, &*insert_before, true, arg_index_to_value, value_ptr_map);
@@ -839,6 +877,23 @@ llvm::Function* InstructionsSnippet::to_function()
     return new_F;
 }
 
+void InstructionsSnippet::collect_contained_values(InstructionList& instructions, BlockList& blocks) const
+{
+    if (!is_valid_snippet()) {
+        return;
+    }
+    // instructions after the snippet end have greater ordinals, instructions created by extraction have none
+    for (auto it = m_begin; it != m_begin->getParent()->end(); ++it) {
+        int instr_idx = get_instruction_ordinal(&*it);
+        if (instr_idx > m_end_idx) {
+            break;
+        }
+        if (contains_instruction(&*it)) {
+            instructions.push_back(&*it);
+        }
+    }
+}
+
 void InstructionsSnippet::dump() const
 {
     llvm::dbgs() << "****Instructions snippet****\n";
@@ -893,6 +948,11 @@ bool InstructionsSnippet::is_block() const
     return (m_begin == m_block->begin() && m_end == --m_block->end());
 }
 
+bool InstructionsSnippet::starts_block() const
+{
+    return m_begin == m_block->begin();
+}
+
 llvm::BasicBlock* InstructionsSnippet::get_block() const
 {
     return m_block;
@@ -951,23 +1011,32 @@ bool InstructionsSnippet::is_function() const
 
 void InstructionsSnippet::compute_indices()
 {
-    m_begin_idx = Utils::get_instruction_index(&*m_begin);
-    m_end_idx = Utils::get_instruction_index(&*m_end);
+    m_begin_idx = get_instruction_ordinal(&*m_begin);
+    if (m_end != m_block->end()) {
+        m_end_idx = get_instruction_ordinal(&*m_end);
+    } else {
+        // end of the block is one past its last numbered instruction
+        auto last = m_end;
+        do {
+            --last;
+            m_end_idx = get_instruction_ordinal(&*last) + 1;
+        } while (m_end_idx == 0 && last != m_begin);
+    }
     m_instruction_number = m_end_idx - m_begin_idx;
 }
 
-void InstructionsSnippet::snippet_instructions(InstructionSet& instrs) const
+int InstructionsSnippet::get_instruction_ordinal(const llvm::Instruction* instr) const
 {
-    std::for_each(m_begin, m_end, [&instrs] (llvm::Instruction& instr) { instrs.insert(&instr); });
-    instrs.insert(&*m_end);
+    assert(m_numbering);
+    return m_numbering->getInstructionIndex(instr);
 }
 
 void InstructionsSnippet::expand_for_instruction(llvm::Instruction* instr,
-                                                 InstructionSet& instructions)
+                                                 ClosureBits& instructions)
 {
     //llvm::dbgs() << "expand for instr " << *instr << "\n";
     if (auto load = llvm::dyn_cast<llvm::LoadInst>(instr)) {
-        assert(instructions.find(instr) != instructions.end());
+        assert(instructions[m_end_idx - get_instruction_ordinal(instr)]);
         if (auto alloca = llvm::dyn_cast<llvm::AllocaInst>(load->getPointerOperand())) {
         } else if (auto loaded_inst = llvm::dyn_cast<llvm::Instruction>(load->getPointerOperand())) {
             expand_for_instruction_operand(loaded_inst, instructions);
@@ -998,7 +1067,7 @@ void InstructionsSnippet::expand_for_instruction(llvm::Instruction* instr,
 }
 
 void InstructionsSnippet::expand_for_instruction_operand(llvm::Value* val,
-                                                         InstructionSet& instructions)
+                                                         ClosureBits& instructions)
 {
     auto instr = llvm::dyn_cast<llvm::Instruction>(val);
     if (!instr) {
@@ -1007,19 +1076,28 @@ void InstructionsSnippet::expand_for_instruction_operand(llvm::Value* val,
     if (llvm::dyn_cast<llvm::AllocaInst>(val)) {
         return;
     }
+    // operands in other blocks are not expanded to
     if (instr->getParent() != m_block) {
-        llvm::dbgs() << "Operand is in a different block " << *val << ". Do not expand\n";
+        return;
     }
     auto new_begin = instr->getIterator();
-    auto new_begin_idx = Utils::get_instruction_index(&*new_begin);
-    if (m_begin_idx > new_begin_idx + 1) {
+    int new_begin_idx = get_instruction_ordinal(instr);
+    if (new_begin_idx == -1 || m_begin_idx > new_begin_idx + 1) {
         //llvm::dbgs() << "More than one instruction to expand to " << *val << ". Do not expand\n";
         return;
     }
-    auto res = instructions.insert(instr);
-    if (!res.second) {
+    if (new_begin_idx > m_end_idx) {
+        // e.g. incoming value of a phi node, snippet is not expanded forward
         return;
     }
+    const unsigned bit = m_end_idx - new_begin_idx;
+    if (bit >= instructions.size()) {
+        instructions.resize(bit + 1, false);
+    }
+    if (instructions[bit]) {
+        return;
+    }
+    instructions[bit] = true;
     //llvm::dbgs() << "Expand: add " << *instr << "\n";
     if (m_begin_idx > new_begin_idx) {
         m_begin = new_begin;
@@ -1129,7 +1207,7 @@ bool BasicBlocksSnippet::intersects(const Snippet& snippet) const
     if (contains_block(instr_snippet->get_block())) {
         return true;
     }
-    if (instr_snippet->get_begin_index() == 0 && is_predecessing_block_snippet(*this, *instr_snippet)) {
+    if (instr_snippet->starts_block() && is_predecessing_block_snippet(*this, *instr_snippet)) {
         return true;
     }
     return false;
@@ -1137,6 +1215,9 @@ bool BasicBlocksSnippet::intersects(const Snippet& snippet) const
 
 void BasicBlocksSnippet::expand()
 {
+    if (!m_start.is_valid_snippet()) {
+        return;
+    }
     m_start.expand();
     // can include block in snippet
     if (m_start.is_block()) {
@@ -1156,34 +1237,34 @@ void BasicBlocksSnippet::collect_used_values(const Snippet* parent_snippet)
     //if (!m_used_values.empty()) {
     //    return;
     //}
-    // ignoring parent_snippet
     m_used_values.clear();
+    compute_used_values(parent_snippet, m_used_values);
+}
+
+void BasicBlocksSnippet::compute_used_values(const Snippet* parent_snippet, ValueSet& used_values) const
+{
+    // ignoring parent_snippet
     if (m_start.is_valid_snippet()) {
-        m_start.collect_used_values(this);
-        auto used_in_start = m_start.get_used_values();
-        m_used_values.insert(used_in_start.begin(), used_in_start.end());
+        m_start.compute_used_values(this, used_values);
     }
 
     for (const auto& block : m_blocks) {
         if (m_start.is_valid_snippet() && block == m_start.get_block()) {
             continue;
         }
-        collect_values(block->begin(), block->end(), *this, m_used_values);
+        collect_values(block->begin(), block->end(), *this, used_values);
     }
     if (m_blocks.find(&*m_begin) == m_blocks.end()) {
-        collect_values(m_begin->begin(), m_begin->end(), *this, m_used_values);
+        collect_values(m_begin->begin(), m_begin->end(), *this, used_values);
     }
    if (m_tail.is_valid_snippet()) {
-        m_tail.collect_used_values(this);
-        auto used_in_start = m_tail.get_used_values();
-        m_used_values.insert(used_in_start.begin(), used_in_start.end());
+        m_tail.compute_used_values(this, used_values);
     }
 }
 
 bool BasicBlocksSnippet::merge(const Snippet& snippet)
 {
     if (!intersects(snippet)) {
-        llvm::dbgs() << "Snippets do not intersect. Will not merge\n";
         return false;
     }
     //if (m_function->getName() == "") {
@@ -1194,7 +1275,7 @@ bool BasicBlocksSnippet::merge(const Snippet& snippet)
     //}
     auto instr_snippet = const_cast<Snippet&>(snippet).to_instrSnippet();
     if (instr_snippet) {
-        if (instr_snippet->get_begin_index() == 0 && is_predecessing_block_snippet(*this, *instr_snippet)) {
+        if (instr_snippet->starts_block() && is_predecessing_block_snippet(*this, *instr_snippet)) {
             if (instr_snippet->is_block()) {
                 m_end = Utils::get_block_pos(instr_snippet->get_block());
                 m_blocks.insert(&*m_end);
@@ -1269,12 +1350,12 @@ bool BasicBlocksSnippet::can_erase_instruction_range(llvm::BasicBlock::iterator
         for (const auto& user : it->users()) {
             if (auto* instr = llvm::dyn_cast<llvm::Instruction>(user)) {
                 if (!contains_instruction(instr)) {
-                    llvm::dbgs() << "does not contain use of instruction " << *it << "  " << *instr << "\n";
+                    SNIPPET_DEBUG(llvm::dbgs() << "does not contain use of instruction " << *it << "  " << *instr << "\n");
                     return false;
                 }
             } else if (auto* b = llvm::dyn_cast<llvm::BasicBlock>(user)) {
                 if (!contains_block(b)) {
-                    llvm::dbgs() << "does not contain block use of instruction " << *it << "  " << b->getName() << "\n";
+                    SNIPPET_DEBUG(llvm::dbgs() << "does not contain block use of instruction " << *it << "  " << b->getName() << "\n");
                     return false;
                 }
             }
@@ -1285,12 +1366,12 @@ bool BasicBlocksSnippet::can_erase_instruction_range(llvm::BasicBlock::iterator
         for (const auto& user : end->users()) {
             if (auto* instr = llvm::dyn_cast<llvm::Instruction>(user)) {
                 if (!contains_instruction(instr)) {
-                    llvm::dbgs() << "does not contain use of instruction " << *it << "  " << *instr << "\n";
+                    SNIPPET_DEBUG(llvm::dbgs() << "does not contain use of instruction " << *it << "  " << *instr << "\n");
                     return false;
                 }
             } else if (auto* b = llvm::dyn_cast<llvm::BasicBlock>(user)) {
                 if (!contains_block(b)) {
-                    llvm::dbgs() << "does not contain block use of instruction " << *it << "  " << b->getName() << "\n";
+                    SNIPPET_DEBUG(llvm::dbgs() << "does not contain block use of instruction " << *it << "  " << b->getName() << "\n");
                     return false;
                 }
             }
@@ -1304,12 +1385,12 @@ bool BasicBlocksSnippet::can_erase_block(llvm::BasicBlock* block) const
     for (const auto& user : block->users()) {
         if (auto* instr = llvm::dyn_cast<llvm::Instruction>(user)) {
             if (!contains_instruction(instr)) {
-                llvm::dbgs() << "does not contain use of block " << block->getName() << "  " << *instr << "\n";
+                SNIPPET_DEBUG(llvm::dbgs() << "does not contain use of block " << block->getName() << "  " << *instr << "\n");
                 return false;
             }
         } else if (auto* b = llvm::dyn_cast<llvm::BasicBlock>(user)) {
             if (!contains_block(b)) {
-                llvm::dbgs() << "does not contain block use of block " << block->getName() << "  " << b->getName() << "\n";
+                SNIPPET_DEBUG(llvm::dbgs() << "does not contain block use of block " << block->getName() << "  " << b->getName() << "\n");
                 return false;
             }
         }
@@ -1493,6 +1574,7 @@ llvm::Function* BasicBlocksSnippet::to_function()
         new_function_exit_block = llvm::dyn_cast<llvm::BasicBlock>(&*end_pos->second);
     }
     //create_return_stores(new_function_exit_block, value_map);
+    collect_extracted_values(value_to_value_map, value_ptr_map, m_extracted_values);
 
     llvm::CallInst* call;
     if (has_start_snippet) {
@@ -1609,6 +1691,24 @@ BasicBlocksSnippet* BasicBlocksSnippet::to_blockSnippet()
     return this;
 }
 
+void BasicBlocksSnippet::collect_contained_values(InstructionList& instructions, BlockList& blocks) const
+{
+    m_start.collect_contained_values(instructions, blocks);
+    m_tail.collect_contained_values(instructions, blocks);
+    for (auto block : m_blocks) {
+        if (!contains_block(block)) {
+            continue;
+        }
+        blocks.push_back(block);
+        if (m_tail.is_valid_snippet() && block == m_tail.get_block()) {
+            continue;
+        }
+        for (auto& I : *block) {
+            instructions.push_back(&I);
+        }
+    }
+}
+
 void BasicBlocksSnippet::dump() const
 {
     llvm::dbgs() << "****Block snippet*****\n";
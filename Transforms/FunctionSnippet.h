@@ -3,13 +3,19 @@
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Function.h"
 
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace llvm {
 class LLVMContext;
 class ReturnInst;
 }
 
+namespace input_dependency {
+class FunctionNumbering;
+}
+
 namespace oh
 {
 
@@ -26,6 +32,9 @@ class Snippet
 public:
     using ValueSet = std::unordered_set<llvm::Value*>;
     using InstructionSet = std::unordered_set<llvm::Instruction*>;
+    using ValueMap = std::unordered_map<llvm::Value*, llvm::Value*>;
+    using InstructionList = std::vector<const llvm::Instruction*>;
+    using BlockList = std::vector<const llvm::BasicBlock*>;
 
 public:
     Snippet()
@@ -52,7 +61,11 @@ public:
     virtual void expand() = 0;
     virtual void adjust_end() = 0;
     virtual void collect_used_values(const Snippet* parent_snippet) = 0;
+    /// Adds values used by the snippet to \p used_values, without changing the snippet.
+    virtual void compute_used_values(const Snippet* parent_snippet, ValueSet& used_values) const = 0;
     virtual bool merge(const Snippet& snippet) = 0;
+    /// Adds instructions and blocks the snippet contains, visiting only the snippet itself.
+    virtual void collect_contained_values(InstructionList& instructions, BlockList& blocks) const = 0;
     virtual llvm::Function* to_function() = 0;
     virtual void dump() const = 0;
 
@@ -61,6 +74,13 @@ public:
         return m_used_values;
     }
 
+    /// Maps instructions and blocks of the function created by to_function to their originals.
+    /// Originals are erased by extraction, hence should be used only as keys, never dereferenced.
+    const ValueMap& get_extracted_values_map() const
+    {
+        return m_extracted_values;
+    }
+
     virtual InstructionsSnippet* to_instrSnippet()
     {
         return nullptr;
@@ -74,9 +94,18 @@ public:
 protected:
     ValueSet m_used_values; 
     InstructionSet m_allocas_to_extract;
+    ValueMap m_extracted_values;
     unsigned m_instruction_number;
 };
 
+/**
+* \class InstructionsSnippet
+* \brief Snippet of consecutive instructions of a block.
+* The snippet is kept as an interval of instruction ordinals of a numbering of the function taken before extraction.
+* Ordinals of remaining instructions stay valid while other snippets are extracted. Ordinals of extracted
+* instructions are dropped from the numbering after each extraction (\see FunctionNumbering::forgetInstruction),
+* thus instructions created by extraction, even at addresses of erased ones, are never contained in the snippet.
+*/
 class InstructionsSnippet : public Snippet
 {
 public:
@@ -84,7 +113,10 @@ public:
 
 public:
     InstructionsSnippet();
-    InstructionsSnippet(llvm::BasicBlock* block, iterator begin, iterator end);
+    InstructionsSnippet(llvm::BasicBlock* block,
+                        iterator begin,
+                        iterator end,
+                        const input_dependency::FunctionNumbering* numbering);
 
 public:
     bool is_valid_snippet() const override;
@@ -99,7 +131,9 @@ public:
     void expand() override;
     void adjust_end() override;
     void collect_used_values(const Snippet* parent_snippet) override;
+    void compute_used_values(const Snippet* parent_snippet, ValueSet& used_values) const override;
     bool merge(const Snippet& snippet) override;
+    void collect_contained_values(InstructionList& instructions, BlockList& blocks) const override;
     llvm::Function* to_function() override;
     void dump() const override;
     virtual InstructionsSnippet* to_instrSnippet() override;
@@ -112,6 +146,7 @@ public:
     llvm::Instruction* get_begin_instr() const;
     llvm::Instruction* get_end_instr() const;
     bool is_block() const;
+    bool starts_block() const;
     llvm::BasicBlock* get_block() const;
     void compute_indices();
     void clear();
@@ -120,15 +155,19 @@ public:
     static bool is_valid_snippet(iterator begin, iterator end, llvm::BasicBlock* B);
 
 private:
-    void snippet_instructions(InstructionSet& instrs) const;
+    // bits of instructions in operand closure of the snippet, indexed by distance of ordinal from the snippet end
+    using ClosureBits = std::vector<bool>;
+
+    int get_instruction_ordinal(const llvm::Instruction* instr) const;
     void expand_for_instruction(llvm::Instruction* instr,
-                                InstructionSet& instructions);
+                                ClosureBits& instructions);
     void expand_for_instruction_operand(llvm::Value* val,
-                                        InstructionSet& instructions);
+                                        ClosureBits& instructions);
     bool can_erase_snippet() const;
 
 private:
     llvm::BasicBlock* m_block;
+    const input_dependency::FunctionNumbering* m_numbering;
     llvm::ReturnInst* m_returnInst;
     iterator m_begin;
     iterator m_end;
@@ -162,7 +201,9 @@ public:
     void expand() override;
     void adjust_end() override;
     void collect_used_values(const Snippet* parent_snippet) override;
+    void compute_used_values(const Snippet* parent_snippet, ValueSet& used_values) const override;
     bool merge(const Snippet& snippet) override;
+    void collect_contained_values(InstructionList& instructions, BlockList& blocks) const override;
     llvm::Function* to_function() override;
     void dump() const override;
     virtual BasicBlocksSnippet* to_blockSnippet() override;
@@ -192,5 +233,9 @@ private:
     BlockSet m_blocks;
 };
 
+/// Enables debug output of snippets on the calling thread.
+/// Threads collecting snippets in parallel disable it, as llvm::dbgs() is not synchronized.
+void set_snippet_debug_output(bool enable);
+
 } // namespace oh
 
@@ -1,8 +1,52 @@
 #include <stdio.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+// Hash of a thread, updated by modules compiled with threads.
+// Only the owning thread writes it, other threads read it at exit.
+// Aligned to a cache line, so that hashes of different threads are not written to the same line.
+struct thread_hash {
+	_Alignas(64) atomic_ulong hash;
+	struct thread_hash* next;
+};
+
+// Lock-free list of hashes of all threads. Hashes are never removed, to keep values of exited threads.
+static struct thread_hash* _Atomic thread_hashes = NULL;
+static _Thread_local struct thread_hash* local_hash = NULL;
+
+long hash =0;
+
+// Threads are combined with addition, thus the result does not depend on their scheduling
+static void logThreadsHash(void) {
+	unsigned long combined = hash;
+	for (struct thread_hash* local = atomic_load_explicit(&thread_hashes, memory_order_acquire);
+	     local; local = local->next) {
+		combined += atomic_load_explicit(&local->hash, memory_order_relaxed);
+	}
+	printf("final hash of all threads: %lu\n", combined);
+}
+
+static void add_thread_hash(unsigned long i) {
+	if (!local_hash) {
+		local_hash = aligned_alloc(_Alignof(struct thread_hash), sizeof(struct thread_hash));
+		atomic_init(&local_hash->hash, 0);
+		local_hash->next = atomic_load_explicit(&thread_hashes, memory_order_relaxed);
+		while (!atomic_compare_exchange_weak_explicit(&thread_hashes, &local_hash->next, local_hash,
+		                                              memory_order_release, memory_order_relaxed)) {
+		}
+		// the first registered thread hash aggregates all of them at exit
+		if (!local_hash->next) {
+			atexit(logThreadsHash);
+		}
+	}
+	atomic_store_explicit(&local_hash->hash,
+	                      atomic_load_explicit(&local_hash->hash, memory_order_relaxed) + i,
+	                      memory_order_relaxed);
+}
+
 void logop(int i) {
 	//printf("computed: %i\n", i);
 }
-long hash =0;
 void hashMeInt(int i) {
 	//printf("adding hash %i\n", i);
 	hash +=i;
@@ -11,12 +55,20 @@ void hashMeLong(long i) {
 	//printf("adding hash %ld\n", i);
 	hash +=i;
 }
+void hashMeIntMT(int i) {
+	add_thread_hash(i);
+}
+void hashMeLongMT(long i) {
+	add_thread_hash(i);
+}
 
 
 //void dbghashMe(int i, std::string valueName){
 //	printf("adding hash %s %i\n",valueName, i);
 //        hash +=i;
 //} 
+// Check points see only the hash of the calling thread, other threads may be anywhere
 void logHash() {
-	printf("final hash: %ld\n", hash);
+	unsigned long local = local_hash ? atomic_load_explicit(&local_hash->hash, memory_order_relaxed) : 0;
+	printf("final hash: %lu\n", hash + local);
 }
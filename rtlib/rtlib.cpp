@@ -1,5 +1,7 @@
 #include <stdio.h>
-#include <vector>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
 
 class hash_logger
 {
@@ -11,31 +13,89 @@ public:
     }
 
 public:
+    // check points of different threads may log at the same time
     void log(unsigned number, unsigned long long hash)
     {
-        if (log_counts[number] >= max_log_count) {
+        if (log_counts[number].fetch_add(1, std::memory_order_relaxed) >= max_log_count) {
             return;
         }
         printf("%llu\n", hash);
-        ++log_counts[number];
     }
 
 private:
     hash_logger(int log_count)
         : max_log_count(log_count)
-        , log_counts(1000)
     {
+        for (auto& count : log_counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
     }
 
 private:
+    static const unsigned max_functions = 1000;
     unsigned max_log_count;
-    std::vector<unsigned> log_counts;
+    std::atomic<unsigned> log_counts[max_functions];
+};
+
+// Hash of a thread, updated by modules compiled with threads.
+// Only the owning thread writes it, other threads read it at exit.
+// Aligned to a cache line, so that hashes of different threads are not written to the same line.
+struct alignas(64) thread_hash
+{
+    std::atomic<unsigned long> hash;
+    thread_hash* next;
 };
 
+// Lock-free list of hashes of all threads. Hashes are never removed, to keep values of exited threads.
+static std::atomic<thread_hash*> thread_hashes(nullptr);
+static thread_local thread_hash* local_hash = nullptr;
+
 extern "C" {
 long hash =0;
+}
+
+// Threads are combined with addition, thus the result does not depend on their scheduling
+static void log_threads_hash()
+{
+    unsigned long combined = hash;
+    for (auto* local = thread_hashes.load(std::memory_order_acquire); local; local = local->next) {
+        combined += local->hash.load(std::memory_order_relaxed);
+    }
+    printf("final hash of all threads: %lu\n", combined);
+}
+
+static thread_hash& get_thread_hash()
+{
+    if (local_hash) {
+        return *local_hash;
+    }
+    void* memory = aligned_alloc(alignof(thread_hash), sizeof(thread_hash));
+    local_hash = new (memory) thread_hash();
+    local_hash->hash.store(0, std::memory_order_relaxed);
+    local_hash->next = thread_hashes.load(std::memory_order_relaxed);
+    while (!thread_hashes.compare_exchange_weak(local_hash->next, local_hash,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+    }
+    // the first registered thread hash aggregates all of them at exit
+    if (!local_hash->next) {
+        atexit(log_threads_hash);
+    }
+    return *local_hash;
+}
+
+static void add_thread_hash(unsigned long i)
+{
+    auto& local = get_thread_hash().hash;
+    local.store(local.load(std::memory_order_relaxed) + i, std::memory_order_relaxed);
+}
+
+extern "C" {
+
+// Check points see only the hash of the calling thread, other threads may be anywhere
 void logHash(unsigned number) {
-    hash_logger::get().log(number, hash);
+    const unsigned long local = local_hash ? local_hash->hash.load(std::memory_order_relaxed) : 0;
+    hash_logger::get().log(number, hash + local);
 }
 
 void logop(int i) {
@@ -49,6 +109,12 @@ void hashMeLong(long i) {
 	//printf("adding hash %ld\n", i);
 	hash +=i;
 }
+void hashMeIntMT(int i) {
+	add_thread_hash(i);
+}
+void hashMeLongMT(long i) {
+	add_thread_hash(i);
+}
 
 
 }
@@ -0,0 +1,484 @@
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Generates modules with controlled shapes for scaling tests of input dependency analysis.
+ * All generated functions have signature i32 (i32, i32*). The first argument carries input from main's argc,
+ * the second points either to a caller's local or to a field of a global composite, depending on aliasing density.
+ * Functions are distributed over call graph levels, each function calling functions of the next level. Consecutive
+ * functions of a level are grouped into call cycles of the requested SCC size.
+ * Virtual calls follow the pattern of clang's -fwhole-program-vtables, i.e. a vtable load guarded with
+ * llvm.type.test, so they are resolved by virtual call sites analysis.
+ */
+
+static llvm::cl::opt<std::string> output_file(
+    "o",
+    llvm::cl::desc("Output bitcode file"),
+    llvm::cl::value_desc("file name"),
+    llvm::cl::init("synthetic.bc"));
+
+static llvm::cl::opt<unsigned> functions_count(
+    "functions",
+    llvm::cl::desc("Number of generated functions, excluding main"),
+    llvm::cl::init(100));
+
+static llvm::cl::opt<unsigned> call_depth(
+    "call-depth",
+    llvm::cl::desc("Number of call graph levels below main"),
+    llvm::cl::init(5));
+
+static llvm::cl::opt<unsigned> scc_size(
+    "scc-size",
+    llvm::cl::desc("Number of functions in each call graph cycle, 1 for no recursion"),
+    llvm::cl::init(1));
+
+static llvm::cl::opt<unsigned> calls_per_function(
+    "calls",
+    llvm::cl::desc("Number of calls of next level functions in each function"),
+    llvm::cl::init(2));
+
+static llvm::cl::opt<unsigned> blocks_count(
+    "blocks",
+    llvm::cl::desc("Number of body blocks in each function"),
+    llvm::cl::init(10));
+
+static llvm::cl::opt<unsigned> loop_depth(
+    "loop-depth",
+    llvm::cl::desc("Nesting depth of loops around function bodies"),
+    llvm::cl::init(1));
+
+static llvm::cl::opt<unsigned> goto_regions(
+    "goto-regions",
+    llvm::cl::desc("Number of irreducible regions, cycles with two entries, in each function"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned> alias_density(
+    "alias-density",
+    llvm::cl::desc("Percent of memory accesses through the pointer argument, which may alias globals"),
+    llvm::cl::init(20));
+
+static llvm::cl::opt<unsigned> composite_size(
+    "composite-size",
+    llvm::cl::desc("Number of fields of the composite type of locals and globals"),
+    llvm::cl::init(4));
+
+static llvm::cl::opt<unsigned> indirect_calls(
+    "indirect-calls",
+    llvm::cl::desc("Percent of calls through function pointers"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned> virtual_calls(
+    "virtual-calls",
+    llvm::cl::desc("Percent of calls through vtables"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned> seed(
+    "seed",
+    llvm::cl::desc("Random seed"),
+    llvm::cl::init(0));
+
+namespace {
+
+class IRGenerator
+{
+public:
+    IRGenerator(llvm::LLVMContext& context)
+        : m_context(context)
+        , m_module(new llvm::Module("synthetic", context))
+        , m_random(seed)
+        , m_int(llvm::Type::getInt32Ty(context))
+        , m_intPtr(llvm::Type::getInt32PtrTy(context))
+        , m_bytePtr(llvm::Type::getInt8PtrTy(context))
+    {
+    }
+
+public:
+    std::unique_ptr<llvm::Module> generate();
+
+private:
+    void createTypes();
+    void createFunctions();
+    void createCallTables();
+    void createVTable(unsigned index);
+    void createMain();
+    void createBody(unsigned index);
+
+    llvm::BasicBlock* createBodyBlocks(llvm::Function* F,
+                                       llvm::BasicBlock* entry,
+                                       const std::vector<unsigned>& callees,
+                                       llvm::Value* composite);
+    llvm::BasicBlock* createGotoRegion(llvm::Function* F, llvm::BasicBlock* entry, llvm::Value* composite);
+    void createMemoryAccesses(llvm::IRBuilder<>& builder, llvm::Value* composite);
+    llvm::Value* createLocal(llvm::Function* F, llvm::Type* type, const std::string& name);
+    llvm::Value* createCall(llvm::IRBuilder<>& builder, unsigned callee, llvm::Value* composite);
+    llvm::Value* getAccessedPointer(llvm::IRBuilder<>& builder, llvm::Value* composite);
+    llvm::Value* getField(llvm::IRBuilder<>& builder, llvm::Value* composite, unsigned field);
+    llvm::Value* loadValue(llvm::IRBuilder<>& builder);
+    std::vector<unsigned> getCallees(unsigned index) const;
+    bool chance(unsigned percent);
+
+private:
+    llvm::LLVMContext& m_context;
+    std::unique_ptr<llvm::Module> m_module;
+    std::mt19937 m_random;
+    llvm::IntegerType* m_int;
+    llvm::PointerType* m_intPtr;
+    llvm::PointerType* m_bytePtr;
+    llvm::StructType* m_composite;
+    llvm::FunctionType* m_functionType;
+    llvm::GlobalVariable* m_sharedComposite;
+    llvm::GlobalVariable* m_functionTable;
+    std::vector<llvm::Function*> m_functions;
+    // levels of functions, function at index i belongs to level m_levels[i]
+    std::vector<unsigned> m_levels;
+    std::vector<unsigned> m_levelStarts;
+    // vtable and object of each function, used by its virtual call sites
+    std::vector<llvm::GlobalVariable*> m_vtables;
+    std::vector<llvm::GlobalVariable*> m_objects;
+    // arguments of the function body being generated
+    llvm::Value* m_input;
+    llvm::Value* m_pointer;
+    llvm::Value* m_result;
+};
+
+std::unique_ptr<llvm::Module> IRGenerator::generate()
+{
+    createTypes();
+    createFunctions();
+    createCallTables();
+    for (unsigned i = 0; i < m_functions.size(); ++i) {
+        createBody(i);
+    }
+    createMain();
+    return std::move(m_module);
+}
+
+void IRGenerator::createTypes()
+{
+    std::vector<llvm::Type*> fields(std::max(composite_size.getValue(), 1u), m_int);
+    m_composite = llvm::StructType::create(m_context, fields, "struct.composite");
+    m_functionType = llvm::FunctionType::get(m_int, {m_int, m_intPtr}, false);
+    m_sharedComposite = new llvm::GlobalVariable(*m_module, m_composite, false, llvm::GlobalValue::InternalLinkage,
+                                                 llvm::ConstantAggregateZero::get(m_composite), "shared");
+}
+
+void IRGenerator::createFunctions()
+{
+    const unsigned levels = std::max(call_depth.getValue(), 1u);
+    const unsigned per_level = std::max(functions_count / levels, 1u);
+    for (unsigned i = 0; i < functions_count; ++i) {
+        auto* F = llvm::Function::Create(m_functionType, llvm::GlobalValue::InternalLinkage,
+                                         "f" + std::to_string(i), m_module.get());
+        m_functions.push_back(F);
+        const unsigned level = std::min(i / per_level, levels - 1);
+        if (m_levelStarts.size() == level) {
+            m_levelStarts.push_back(i);
+        }
+        m_levels.push_back(level);
+    }
+    m_levelStarts.push_back(m_functions.size());
+}
+
+void IRGenerator::createCallTables()
+{
+    std::vector<llvm::Constant*> pointers(m_functions.begin(), m_functions.end());
+    auto* tableType = llvm::ArrayType::get(m_functionType->getPointerTo(), pointers.size());
+    // not constant, so that indirect call targets are not known from the initializer alone
+    m_functionTable = new llvm::GlobalVariable(*m_module, tableType, false, llvm::GlobalValue::InternalLinkage,
+                                               llvm::ConstantArray::get(tableType, pointers), "function_table");
+    if (virtual_calls == 0) {
+        return;
+    }
+    for (unsigned i = 0; i < m_functions.size(); ++i) {
+        createVTable(i);
+    }
+}
+
+void IRGenerator::createVTable(unsigned index)
+{
+    const std::string name = std::to_string(index);
+    auto* vtableType = llvm::ArrayType::get(m_bytePtr, 1);
+    auto* entry = llvm::ConstantExpr::getBitCast(m_functions[index], m_bytePtr);
+    auto* vtable = new llvm::GlobalVariable(*m_module, vtableType, true, llvm::GlobalValue::InternalLinkage,
+                                            llvm::ConstantArray::get(vtableType, {entry}), "vtable" + name);
+    auto* typeId = llvm::MDString::get(m_context, "class" + name);
+    vtable->addMetadata(llvm::LLVMContext::MD_type,
+                        *llvm::MDNode::get(m_context, {llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(
+                                                           llvm::Type::getInt64Ty(m_context), 0)),
+                                                       typeId}));
+    auto* vptrType = m_bytePtr->getPointerTo();
+    // braced single element would convert to the isPacked flag of StructType::get
+    auto* objectType = llvm::StructType::get(m_context, llvm::ArrayRef<llvm::Type*>(vptrType));
+    llvm::Constant* vptr = llvm::ConstantExpr::getBitCast(vtable, vptrType);
+    auto* object = new llvm::GlobalVariable(*m_module, objectType, false, llvm::GlobalValue::InternalLinkage,
+                                            llvm::ConstantStruct::get(objectType, llvm::ArrayRef<llvm::Constant*>(vptr)),
+                                            "object" + name);
+    m_vtables.push_back(vtable);
+    m_objects.push_back(object);
+}
+
+void IRGenerator::createMain()
+{
+    auto* mainType = llvm::FunctionType::get(m_int, {m_int, m_bytePtr->getPointerTo()}, false);
+    auto* main = llvm::Function::Create(mainType, llvm::GlobalValue::ExternalLinkage, "main", m_module.get());
+    auto* entry = llvm::BasicBlock::Create(m_context, "entry", main);
+    llvm::IRBuilder<> builder(entry);
+    llvm::Value* argc = &*main->arg_begin();
+    llvm::Value* result = llvm::ConstantInt::get(m_int, 0);
+    const unsigned first_level_end = m_levelStarts.size() > 1 ? m_levelStarts[1] : 0;
+    for (unsigned i = 0; i < first_level_end; ++i) {
+        auto* call = builder.CreateCall(m_functions[i], {argc, getField(builder, m_sharedComposite, i)});
+        result = builder.CreateAdd(result, call);
+    }
+    builder.CreateRet(result);
+}
+
+void IRGenerator::createBody(unsigned index)
+{
+    auto* F = m_functions[index];
+    auto arg_it = F->arg_begin();
+    m_input = &*arg_it++;
+    m_pointer = &*arg_it;
+
+    auto* entry = llvm::BasicBlock::Create(m_context, "entry", F);
+    llvm::IRBuilder<> builder(entry);
+    auto* composite = builder.CreateAlloca(m_composite, nullptr, "local");
+    m_result = builder.CreateAlloca(m_int, nullptr, "result");
+    builder.CreateStore(m_input, m_result);
+
+    // loop headers, outermost first. Bounds depend on the input, so loops are input dependent
+    std::vector<llvm::BasicBlock*> headers;
+    std::vector<llvm::BasicBlock*> latches;
+    std::vector<llvm::Value*> counters;
+    llvm::BasicBlock* current = entry;
+    for (unsigned depth = 0; depth < loop_depth; ++depth) {
+        auto* counter = createLocal(F, m_int, "i" + std::to_string(depth));
+        builder.CreateStore(llvm::ConstantInt::get(m_int, 0), counter);
+        auto* header = llvm::BasicBlock::Create(m_context, "loop.header", F);
+        builder.CreateBr(header);
+        builder.SetInsertPoint(header);
+        auto* cond = builder.CreateICmpSLT(builder.CreateLoad(counter), m_input);
+        auto* body = llvm::BasicBlock::Create(m_context, "loop.body", F);
+        auto* latch = llvm::BasicBlock::Create(m_context, "loop.latch", F);
+        // exit branch target is set when the latch of the enclosing loop is known
+        headers.push_back(header);
+        latches.push_back(latch);
+        counters.push_back(counter);
+        builder.CreateCondBr(cond, body, body);
+        builder.SetInsertPoint(body);
+        current = body;
+    }
+
+    current = createBodyBlocks(F, current, getCallees(index), composite);
+
+    auto* exit = llvm::BasicBlock::Create(m_context, "exit", F);
+    llvm::BasicBlock* after_loops = exit;
+    if (goto_regions != 0) {
+        after_loops = llvm::BasicBlock::Create(m_context, "goto.entry", F);
+    }
+    builder.SetInsertPoint(current);
+    builder.CreateBr(latches.empty() ? after_loops : latches.back());
+    for (int depth = latches.size() - 1; depth >= 0; --depth) {
+        builder.SetInsertPoint(latches[depth]);
+        auto* counter = counters[depth];
+        builder.CreateStore(builder.CreateAdd(builder.CreateLoad(counter), llvm::ConstantInt::get(m_int, 1)), counter);
+        builder.CreateBr(headers[depth]);
+        auto* loop_exit = depth == 0 ? after_loops : latches[depth - 1];
+        llvm::cast<llvm::BranchInst>(headers[depth]->getTerminator())->setSuccessor(1, loop_exit);
+    }
+
+    if (goto_regions != 0) {
+        current = after_loops;
+        for (unsigned i = 0; i < goto_regions; ++i) {
+            current = createGotoRegion(F, current, composite);
+        }
+        builder.SetInsertPoint(current);
+        builder.CreateBr(exit);
+    }
+
+    builder.SetInsertPoint(exit);
+    builder.CreateRet(builder.CreateLoad(m_result));
+}
+
+llvm::BasicBlock* IRGenerator::createBodyBlocks(llvm::Function* F,
+                                                llvm::BasicBlock* entry,
+                                                const std::vector<unsigned>& callees,
+                                                llvm::Value* composite)
+{
+    llvm::IRBuilder<> builder(entry);
+    const unsigned blocks = std::max(blocks_count.getValue(), 1u);
+    unsigned next_callee = 0;
+    llvm::BasicBlock* current = entry;
+    // blocks form a chain of diamonds, odd blocks are conditional on the input
+    for (unsigned i = 0; i < blocks; ++i) {
+        createMemoryAccesses(builder, composite);
+        // calls are spread evenly over blocks
+        while (next_callee < callees.size() && next_callee * blocks <= i * callees.size()) {
+            auto* value = createCall(builder, callees[next_callee++], composite);
+            builder.CreateStore(builder.CreateAdd(builder.CreateLoad(m_result), value), m_result);
+        }
+        auto* next = llvm::BasicBlock::Create(m_context, "block", F);
+        if (i % 2 == 1) {
+            auto* then = llvm::BasicBlock::Create(m_context, "block.then", F);
+            auto* cond = builder.CreateICmpSGT(m_input, llvm::ConstantInt::get(m_int, i));
+            builder.CreateCondBr(cond, then, next);
+            builder.SetInsertPoint(then);
+            createMemoryAccesses(builder, composite);
+        }
+        builder.CreateBr(next);
+        builder.SetInsertPoint(next);
+        current = next;
+    }
+    while (next_callee < callees.size()) {
+        auto* value = createCall(builder, callees[next_callee++], composite);
+        builder.CreateStore(builder.CreateAdd(builder.CreateLoad(m_result), value), m_result);
+    }
+    return current;
+}
+
+llvm::BasicBlock* IRGenerator::createGotoRegion(llvm::Function* F, llvm::BasicBlock* entry, llvm::Value* composite)
+{
+    // entry jumps either to first or to second block of a cycle, making the cycle irreducible
+    auto* first = llvm::BasicBlock::Create(m_context, "goto.first", F);
+    auto* second = llvm::BasicBlock::Create(m_context, "goto.second", F);
+    auto* exit = llvm::BasicBlock::Create(m_context, "goto.exit", F);
+    llvm::IRBuilder<> builder(entry);
+    auto* counter = createLocal(F, m_int, "goto.counter");
+    builder.CreateStore(m_input, counter);
+    builder.CreateCondBr(builder.CreateICmpSGT(m_input, llvm::ConstantInt::get(m_int, 0)), first, second);
+
+    builder.SetInsertPoint(first);
+    createMemoryAccesses(builder, composite);
+    builder.CreateBr(second);
+
+    builder.SetInsertPoint(second);
+    createMemoryAccesses(builder, composite);
+    auto* value = builder.CreateSub(builder.CreateLoad(counter), llvm::ConstantInt::get(m_int, 1));
+    builder.CreateStore(value, counter);
+    builder.CreateCondBr(builder.CreateICmpSGT(value, llvm::ConstantInt::get(m_int, 0)), first, exit);
+    return exit;
+}
+
+void IRGenerator::createMemoryAccesses(llvm::IRBuilder<>& builder, llvm::Value* composite)
+{
+    auto* value = builder.CreateAdd(loadValue(builder), m_input);
+    builder.CreateStore(value, getAccessedPointer(builder, composite));
+}
+
+llvm::Value* IRGenerator::createLocal(llvm::Function* F, llvm::Type* type, const std::string& name)
+{
+    // locals are allocated in the entry block, as clang does
+    llvm::IRBuilder<> builder(&F->getEntryBlock(), F->getEntryBlock().begin());
+    return builder.CreateAlloca(type, nullptr, name);
+}
+
+llvm::Value* IRGenerator::createCall(llvm::IRBuilder<>& builder, unsigned callee, llvm::Value* composite)
+{
+    llvm::Value* argument = getAccessedPointer(builder, composite);
+    llvm::Value* called = m_functions[callee];
+    const unsigned kind = m_random() % 100;
+    if (kind < virtual_calls && !m_vtables.empty()) {
+        auto* vptrAddr = builder.CreateStructGEP(nullptr, m_objects[callee], 0);
+        auto* vtable = builder.CreateLoad(vptrAddr);
+        auto* typeTest = llvm::Intrinsic::getDeclaration(m_module.get(), llvm::Intrinsic::type_test);
+        auto* assume = llvm::Intrinsic::getDeclaration(m_module.get(), llvm::Intrinsic::assume);
+        auto* typeId = llvm::MetadataAsValue::get(m_context,
+                                                  llvm::MDString::get(m_context, "class" + std::to_string(callee)));
+        auto* test = builder.CreateCall(typeTest, {builder.CreateBitCast(vtable, m_bytePtr), typeId});
+        builder.CreateCall(assume, {test});
+        auto* slot = builder.CreateLoad(vtable);
+        called = builder.CreateBitCast(slot, m_functionType->getPointerTo());
+    } else if (kind < virtual_calls + indirect_calls) {
+        auto* slot = builder.CreateConstGEP2_32(nullptr, m_functionTable, 0, callee);
+        called = builder.CreateLoad(slot);
+    }
+    return builder.CreateCall(called, {m_input, argument});
+}
+
+llvm::Value* IRGenerator::getAccessedPointer(llvm::IRBuilder<>& builder, llvm::Value* composite)
+{
+    if (chance(alias_density)) {
+        // may alias shared global, locals of callers and accesses of other functions
+        return chance(50) ? m_pointer : getField(builder, m_sharedComposite, m_random());
+    }
+    return getField(builder, composite, m_random());
+}
+
+llvm::Value* IRGenerator::getField(llvm::IRBuilder<>& builder, llvm::Value* composite, unsigned field)
+{
+    return builder.CreateStructGEP(nullptr, composite, field % m_composite->getNumElements());
+}
+
+llvm::Value* IRGenerator::loadValue(llvm::IRBuilder<>& builder)
+{
+    return builder.CreateLoad(chance(alias_density) ? m_pointer : getField(builder, m_sharedComposite, m_random()));
+}
+
+std::vector<unsigned> IRGenerator::getCallees(unsigned index) const
+{
+    std::vector<unsigned> callees;
+    const unsigned level = m_levels[index];
+    const unsigned level_start = m_levelStarts[level];
+    const unsigned level_size = m_levelStarts[level + 1] - level_start;
+    // next function in the same cycle, the last one closes it
+    const unsigned cycle_size = std::min(scc_size.getValue(), level_size);
+    if (cycle_size > 1) {
+        const unsigned cycle_start = level_start + (index - level_start) / cycle_size * cycle_size;
+        const unsigned cycle_end = std::min(cycle_start + cycle_size, level_start + level_size);
+        callees.push_back(index + 1 < cycle_end ? index + 1 : cycle_start);
+    }
+    if (level + 2 >= m_levelStarts.size()) {
+        return callees;
+    }
+    const unsigned next_start = m_levelStarts[level + 1];
+    const unsigned next_size = m_levelStarts[level + 2] - next_start;
+    for (unsigned i = 0; i < calls_per_function; ++i) {
+        callees.push_back(next_start + (index * calls_per_function + i) % next_size);
+    }
+    return callees;
+}
+
+bool IRGenerator::chance(unsigned percent)
+{
+    return m_random() % 100 < percent;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Generates LLVM bitcode with controlled shapes for scaling tests\n");
+    llvm::LLVMContext context;
+    IRGenerator generator(context);
+    auto module = generator.generate();
+    if (llvm::verifyModule(*module, &llvm::errs())) {
+        llvm::errs() << "Generated module is broken\n";
+        return 1;
+    }
+    std::error_code EC;
+    llvm::raw_fd_ostream ostream(output_file, EC, llvm::sys::fs::F_None);
+    if (EC) {
+        llvm::errs() << "Could not open " << output_file << ": " << EC.message() << "\n";
+        return 1;
+    }
+    llvm::WriteBitcodeToFile(module.get(), ostream);
+    return 0;
+}
@@ -0,0 +1,181 @@
+#!/bin/bash
+
+# Runs input dependency analysis over bundled test programs and given bitcode files, reporting wall time,
+# peak RSS and number of alias analysis queries of each run.
+#
+# Usage: ./run-benchmarks.sh [bitcode files or directories with synthetic corpora...]
+#
+# Environment:
+#   LOCAL_LIB_LOC  directory with libInputDependency.so (../../build/lib)
+#   REPEAT         number of runs of each input, the fastest is reported (3)
+#   RESULTS        csv file results are written to (results.csv)
+#   BASELINE       csv file of a previous run. Inputs slower or using more memory than THRESHOLD percent are reported
+#   THRESHOLD      allowed slowdown in percent (10)
+#   SYNTHETIC      if set, synthetic corpora of growing size and of each stressed shape are generated and benchmarked
+#   GENERATOR      ir-generator executable (../../build/tests/benchmarks/generator/ir-generator)
+#   OPT_FLAGS      additional flags of analysis runs, e.g. -goto-unsafe
+#   DEMAND_QUERIES comma separated functions, e.g. main,f42. If set, each input is also benchmarked in lazy mode,
+#                  querying each of these functions, and the number of functions analysed for the query is reported
+
+BENCH_DIR="$(cd "$(dirname "$0")" && pwd)"
+TESTS_DIR="$BENCH_DIR/.."
+
+LOCAL_LIB_LOC=${LOCAL_LIB_LOC:-$BENCH_DIR/../../build/lib}
+REPEAT=${REPEAT:-3}
+RESULTS=${RESULTS:-results.csv}
+THRESHOLD=${THRESHOLD:-10}
+GENERATOR=${GENERATOR:-$BENCH_DIR/../../build/tests/benchmarks/generator/ir-generator}
+
+WORK_DIR="$BENCH_DIR/work"
+mkdir -p "$WORK_DIR"
+
+# name, repository and source file of each bundled program which is cloned by its test
+clone_programs="tetris https://github.com/troglobit/tetris.git tetris.c
+                snake_c https://github.com/mnisjk/snake.git snake.c
+                micro_snake https://github.com/troglobit/snake.git snake.c
+                2048_game https://github.com/cuadue/2048_game.git 2048_game.c"
+
+# bundled programs with sources in tests
+local_programs="bubble_sort/bubble_sort.cpp
+                composite_types/array.c
+                composite_types/heap_allocated_array.c
+                composite_types/multidimensional_array.c
+                composite_types/structs.c
+                composite_types/classes.cpp
+                loop_controlflow/input_argument_dependents.cpp
+                loop_controlflow/input_dependents.cpp
+                loop_controlflow/input_independents.cpp
+                loop_controlflow/mixed_dependents.cpp"
+
+function compile_bundled_programs () {
+    echo "$clone_programs" | while read name repo source; do
+        if [ ! -d "$WORK_DIR/$name" ]; then
+            git clone -q $repo "$WORK_DIR/$name"
+        fi
+        clang "$WORK_DIR/$name/$source" -DVERSION=\"1.0.1\" -c -emit-llvm -o "$WORK_DIR/$name.bc"
+    done
+    for source in $local_programs; do
+        if [ ! -f "$TESTS_DIR/$source" ]; then
+            continue
+        fi
+        name=$(echo "${source%.*}" | tr '/' '_')
+        clang "$TESTS_DIR/$source" -c -emit-llvm -o "$WORK_DIR/$name.bc"
+    done
+}
+
+# name and ir-generator flags of each synthetic corpus
+synthetic_corpora="functions_100 -functions=100
+                   functions_400 -functions=400
+                   functions_1600 -functions=1600
+                   deep_calls -functions=400 -call-depth=40
+                   sccs -functions=400 -scc-size=16
+                   large_blocks -functions=100 -blocks=200
+                   nested_loops -functions=100 -loop-depth=4
+                   gotos -functions=100 -goto-regions=8
+                   dense_aliasing -functions=100 -alias-density=90
+                   composites -functions=100 -composite-size=64
+                   indirect_calls -functions=400 -indirect-calls=50
+                   virtual_calls -functions=400 -virtual-calls=50"
+
+function generate_synthetic_corpora () {
+    mkdir -p "$WORK_DIR/synthetic"
+    echo "$synthetic_corpora" | while read name flags; do
+        $GENERATOR $flags -o "$WORK_DIR/synthetic/$name.bc"
+    done
+}
+
+# prints seconds, peak RSS in KB and alias queries count of one analysis run, given additional flags
+function run_analysis () {
+    /usr/bin/time -f "%e %M" -o "$WORK_DIR/time.txt" \
+        opt -load $LOCAL_LIB_LOC/libInputDependency.so "$1" -input-dep \
+            -input-dep-profile="$WORK_DIR/profile.txt" -dependency-stats-format=text $OPT_FLAGS $2 \
+            -disable-output 2> "$WORK_DIR/log.txt"
+    if [ $? -ne 0 ]; then
+        return 1
+    fi
+    # module totals are reported first
+    aa_queries=$(grep -m 1 " counters aa_queries " "$WORK_DIR/profile.txt" | awk '{ print $NF }')
+    echo "$(tail -n 1 "$WORK_DIR/time.txt") ${aa_queries:-0}"
+}
+
+# benchmarks given input with optional additional flags, reported under given name
+function benchmark () {
+    name=${3:-$(basename "${1%.bc}")}
+    best_time=""
+    max_rss=0
+    for i in $(seq $REPEAT); do
+        result=$(run_analysis "$1" "$2")
+        if [ $? -ne 0 ]; then
+            echo "$name FAILED"
+            return
+        fi
+        read seconds rss aa_queries <<< "$result"
+        if [ -z "$best_time" ] || awk "BEGIN { exit !($seconds < $best_time) }"; then
+            best_time=$seconds
+        fi
+        if [ $rss -gt $max_rss ]; then
+            max_rss=$rss
+        fi
+    done
+    echo "$name,$best_time,$max_rss,$aa_queries" >> "$RESULTS"
+    printf "%-45s %10s s %10s KB %12s AA queries\n" $name $best_time $max_rss $aa_queries
+}
+
+# benchmarks on demand queries of each function in DEMAND_QUERIES, compared to the full run of the input
+function benchmark_demand_queries () {
+    name=$(basename "${1%.bc}")
+    for query in ${DEMAND_QUERIES//,/ }; do
+        benchmark "$1" "-input-dep-lazy -input-dep-query=$query" "$name@$query"
+        grep "Input dependency on demand for $query:" "$WORK_DIR/log.txt"
+    done
+}
+
+function compare_with_baseline () {
+    tail -n +2 "$RESULTS" | while IFS=, read name seconds rss aa_queries; do
+        baseline=$(grep "^$name," "$BASELINE")
+        if [ -z "$baseline" ]; then
+            continue
+        fi
+        IFS=, read base_name base_seconds base_rss base_aa_queries <<< "$baseline"
+        if awk "BEGIN { exit !($seconds > $base_seconds * (100 + $THRESHOLD) / 100) }"; then
+            echo "REGRESSION $name time $base_seconds s -> $seconds s"
+        fi
+        if awk "BEGIN { exit !($rss > $base_rss * (100 + $THRESHOLD) / 100) }"; then
+            echo "REGRESSION $name peak RSS $base_rss KB -> $rss KB"
+        fi
+        if [ "$aa_queries" -gt "$base_aa_queries" ]; then
+            echo "REGRESSION $name AA queries $base_aa_queries -> $aa_queries"
+        fi
+    done
+}
+
+echo "Compile bundled programs"
+compile_bundled_programs
+
+inputs="$WORK_DIR/*.bc"
+if [ -n "$SYNTHETIC" ]; then
+    echo "Generate synthetic corpora"
+    generate_synthetic_corpora
+    inputs="$inputs $WORK_DIR/synthetic/*.bc"
+fi
+for arg in "$@"; do
+    if [ -d "$arg" ]; then
+        inputs="$inputs $arg/*.bc"
+    else
+        inputs="$inputs $arg"
+    fi
+done
+
+echo "name,seconds,peak_rss_kb,aa_queries" > "$RESULTS"
+for input in $inputs; do
+    if [ -f "$input" ]; then
+        benchmark "$input"
+        if [ -n "$DEMAND_QUERIES" ]; then
+            benchmark_demand_queries "$input"
+        fi
+    fi
+done
+
+if [ -n "$BASELINE" ]; then
+    compare_with_baseline
+fi
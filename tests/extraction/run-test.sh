@@ -0,0 +1,29 @@
+#!/bin/bash
+
+echo "Run extraction tests"
+
+LIB_LOC=/usr/local/lib
+LOCAL_LIB_LOC=../../build/lib
+
+rm *.bc
+
+echo "Two snippets of the same block test"
+
+clang same_block_snippets.c -c -emit-llvm
+
+opt -load $LOCAL_LIB_LOC/libInputDependency.so -load $LOCAL_LIB_LOC/libTransforms.so same_block_snippets.bc -extract-functions -verify -o extract.bc
+
+clang same_block_snippets.bc -o same_block_snippets
+clang extract.bc -o extract
+
+extracted=`llvm-dis extract.bc -o - | grep -c "^define.*@two_snippets[0-9]"`
+if [ "$extracted" -ge 2 ] \
+    && [ "`./same_block_snippets 7`" = "`./extract 7`" ] \
+    && [ "`./same_block_snippets -3`" = "`./extract -3`" ]; then
+    echo "PASS"
+else
+    echo "FAIL"
+fi
+
+rm *.bc
+rm same_block_snippets extract
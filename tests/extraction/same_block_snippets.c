@@ -0,0 +1,24 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+// input dependent computations separated by input independent ones are extracted as two snippets of one block
+int two_snippets(int input)
+{
+    int first = input * 3 + 1;
+    int second = first * input;
+    printf("first %d %d\n", first, second);
+    int constant = 42;
+    int doubled = constant * 2;
+    printf("constant %d\n", doubled);
+    int third = input - doubled;
+    int fourth = third * third;
+    printf("second %d %d\n", third, fourth);
+    return fourth;
+}
+
+int main(int argc, char* argv[])
+{
+    int input = argc > 1 ? atoi(argv[1]) : 5;
+    printf("result %d\n", two_snippets(input));
+    return 0;
+}
@@ -0,0 +1,22 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+// called with different input dependent arguments, thus cloned for each call site
+int scale(int value, int factor)
+{
+    int result = value * factor;
+    if (result > 100) {
+        result -= 100;
+    }
+    return result;
+}
+
+// calls of main are changed to call clones, thus main is analysed again when next pass queries its results
+int main(int argc, char* argv[])
+{
+    int input = argc > 1 ? atoi(argv[1]) : 5;
+    int dependent = scale(input, 3);
+    int independent = scale(4, 5);
+    printf("result %d %d\n", dependent, independent);
+    return 0;
+}
@@ -0,0 +1,29 @@
+#!/bin/bash
+
+echo "Run invalidation tests"
+
+LIB_LOC=/usr/local/lib
+LOCAL_LIB_LOC=../../build/lib
+
+rm *.bc
+
+echo "Callers of clones are re-analysed test"
+
+clang cloned_calls.c -c -emit-llvm
+
+# extraction queries results after cloning, which re-analyses functions invalidated by the clone pass
+opt -load $LOCAL_LIB_LOC/libInputDependency.so -load $LOCAL_LIB_LOC/libTransforms.so cloned_calls.bc -clone-functions -extract-functions -verify -o transformed.bc 2> log.txt
+
+clang cloned_calls.bc -o cloned_calls
+clang transformed.bc -o transformed
+
+if grep -q "Re-analysing invalidated function main" log.txt \
+    && [ "`./cloned_calls 7`" = "`./transformed 7`" ] \
+    && [ "`./cloned_calls 60`" = "`./transformed 60`" ]; then
+    echo "PASS"
+else
+    echo "FAIL"
+fi
+
+rm *.bc log.txt
+rm cloned_calls transformed
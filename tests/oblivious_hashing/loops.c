@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+// input independent loop, hashed by all modes of OH
+int sum_squares(int count)
+{
+    int sum = 0;
+    for (int i = 0; i < count; ++i) {
+        int step = count * 2;
+        sum += i * i + step;
+    }
+    return sum;
+}
+
+// nested input independent loops, the inner one is sampled with -oh-loop-stride
+unsigned table_checksum()
+{
+    unsigned checksum = 1;
+    for (int i = 1; i < 8; ++i) {
+        for (int j = 1; j < 16; ++j) {
+            checksum = checksum * 31 + i * j;
+        }
+    }
+    return checksum;
+}
+
+// loop bound depends on input
+int scaled(int input)
+{
+    int result = 0;
+    for (int i = 0; i < abs(input); ++i) {
+        result += i * input;
+    }
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    int input = argc > 1 ? atoi(argv[1]) : 5;
+    printf("result %d\n", sum_squares(10));
+    printf("result %u\n", table_checksum());
+    printf("result %d\n", scaled(input));
+    return 0;
+}
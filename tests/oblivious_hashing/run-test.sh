@@ -0,0 +1,79 @@
+#!/bin/bash
+
+echo "Run oblivious hashing tests"
+
+LIB_LOC=/usr/local/lib
+LOCAL_LIB_LOC=../../build/lib
+
+rm *.bc
+
+clang loops.c -c -emit-llvm
+clang loops.bc -o loops
+
+# protects loops.bc with OH run with given flags, and links it with rtlib to the program named protected
+protect() {
+    opt -load $LOCAL_LIB_LOC/libInputDependency.so -load $LOCAL_LIB_LOC/libOHPass.so loops.bc -oh $1 -verify -o oh.bc \
+        && llvm-link oh.bc $LOCAL_LIB_LOC/rtlib.bc -o protected.bc \
+        && clang++ protected.bc -o protected
+}
+
+# hashes logged by check points are printed as numbers, output of the program itself as results
+results() {
+    echo "$1" | grep "^result"
+}
+
+status=PASS
+for input in 7 -3
+do
+    expected=`./loops $input`
+
+    protect "" || status=FAIL
+    default=`./protected $input`
+
+    echo "Inline hash test"
+    protect "-oh-inline-hash" || status=FAIL
+    inline=`./protected $input`
+    # local hashes are added to the global hash before check points, so these log the same hashes
+    if [ "$inline" != "$default" ]; then
+        status=FAIL
+    fi
+
+    echo "Thread local hash test"
+    protect "-oh-threads" || status=FAIL
+    threads=`./protected $input`
+    # check points of the only thread see the same hashes, the sum of all threads is printed at exit
+    if [ "`echo "$threads" | grep -v "^final hash of all threads"`" != "$default" ]; then
+        status=FAIL
+    fi
+
+    echo "Loop hash test"
+    protect "-oh-loop-hash" || status=FAIL
+    loop=`./protected $input`
+    protect "-oh-loop-hash -oh-inline-hash" || status=FAIL
+    loop_inline=`./protected $input`
+    if [ "$loop_inline" != "$loop" ]; then
+        status=FAIL
+    fi
+
+    echo "Loop stride test"
+    protect "-oh-loop-hash -oh-loop-stride=4" || status=FAIL
+    stride=`./protected $input`
+    # sampled updates are branches around hashMe calls, or selects with -oh-inline-hash
+    protect "-oh-loop-hash -oh-loop-stride=4 -oh-inline-hash" || status=FAIL
+    stride_inline=`./protected $input`
+    if [ "$stride_inline" != "$stride" ]; then
+        status=FAIL
+    fi
+
+    # hashing does not change what the program computes
+    for output in "$default" "$inline" "$threads" "$loop" "$loop_inline" "$stride" "$stride_inline"
+    do
+        if [ "`results "$output"`" != "`results "$expected"`" ]; then
+            status=FAIL
+        fi
+    done
+done
+echo $status
+
+rm *.bc
+rm loops protected
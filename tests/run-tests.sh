@@ -6,7 +6,10 @@ directories="2048_game
              tetris
              bubble_sort
              control_flow
-             loop_controlflow"
+             loop_controlflow
+             extraction
+             oblivious_hashing
+             invalidation"
 
 
 for dir in $directories